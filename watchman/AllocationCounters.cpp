@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "watchman/AllocationCounters.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+struct ThreadCounters {
+  uint64_t allocCount{0};
+  uint64_t allocBytes{0};
+  uint64_t freeCount{0};
+};
+
+thread_local ThreadCounters threadCounters;
+
+// Relaxed adds on separate lines keep the per-allocation cost to a
+// couple of uncontended-in-the-common-case atomic increments.
+std::atomic<uint64_t> processAllocCount{0};
+std::atomic<uint64_t> processAllocBytes{0};
+std::atomic<uint64_t> processFreeCount{0};
+
+inline void* countedAlloc(size_t size) {
+  threadCounters.allocCount++;
+  threadCounters.allocBytes += size;
+  processAllocCount.fetch_add(1, std::memory_order_relaxed);
+  processAllocBytes.fetch_add(size, std::memory_order_relaxed);
+  return malloc(size);
+}
+
+inline void countedFree(void* ptr) {
+  if (ptr) {
+    threadCounters.freeCount++;
+    processFreeCount.fetch_add(1, std::memory_order_relaxed);
+  }
+  free(ptr);
+}
+
+} // namespace
+
+namespace watchman {
+
+AllocationCounters getThreadAllocationCounters() {
+  return AllocationCounters{
+      threadCounters.allocCount,
+      threadCounters.allocBytes,
+      threadCounters.freeCount};
+}
+
+AllocationCounters getProcessAllocationCounters() {
+  return AllocationCounters{
+      processAllocCount.load(std::memory_order_relaxed),
+      processAllocBytes.load(std::memory_order_relaxed),
+      processFreeCount.load(std::memory_order_relaxed)};
+}
+
+} // namespace watchman
+
+// Global replacements. These intentionally cover the whole process so
+// that the counters reflect everything a command caused to happen,
+// including work inside the libraries we call.
+
+void* operator new(size_t size) {
+  auto* p = countedAlloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new[](size_t size) {
+  auto* p = countedAlloc(size);
+  if (!p) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return countedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+  countedFree(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+  countedFree(ptr);
+}
@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+namespace watchman {
+
+/**
+ * Cheap always-on allocation accounting, maintained by the daemon's
+ * global operator new/delete replacements. Thread counters support
+ * capturing deltas around a unit of work (see PerfSample); the process
+ * counters feed the debug-allocations command.
+ */
+struct AllocationCounters {
+  uint64_t allocCount{0};
+  uint64_t allocBytes{0};
+  uint64_t freeCount{0};
+};
+
+/** Counters for the calling thread. */
+AllocationCounters getThreadAllocationCounters();
+
+/** Process-wide counters. */
+AllocationCounters getProcessAllocationCounters();
+
+} // namespace watchman
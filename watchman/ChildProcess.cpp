@@ -130,6 +130,17 @@ ChildProcess::Options::Options() : inner_(std::make_unique<Inner>()) {
 #ifdef POSIX_SPAWN_CLOEXEC_DEFAULT
   setFlags(POSIX_SPAWN_CLOEXEC_DEFAULT);
 #endif
+#ifdef POSIX_SPAWN_USEVFORK
+  // glibc's posix_spawn forks with a full address-space copy unless
+  // told otherwise; triggers and SCM helpers spawn constantly from a
+  // daemon whose heap can be gigabytes, where the page-table copy is
+  // the dominant spawn cost. USEVFORK shares the address space for the
+  // brief window before exec, which is safe here because every spawn
+  // goes straight to posix_spawnp with file actions — no user code runs
+  // in the child. Newer glibc uses CLONE_VM|CLONE_VFORK unconditionally
+  // and defines this flag as a no-op, which is fine.
+  setFlags(POSIX_SPAWN_USEVFORK);
+#endif
 }
 
 ChildProcess::Options::Inner::Inner() {
@@ -6,17 +6,26 @@
  */
 
 #include "watchman/CommandRegistry.h"
-#include <unordered_map>
-#include <unordered_set>
+#include <folly/container/F14Map.h>
+#include <folly/container/F14Set.h>
 #include "watchman/Errors.h"
 #include "watchman/thirdparty/jansson/jansson.h"
 
 namespace {
 using namespace watchman;
 
+// F14 with transparent hash/equality so lookups take the decoded
+// command name by reference; command dispatch previously copied the
+// name into a std::string per request just to probe the table.
+using TransparentHasher = folly::transparent<folly::hasher<folly::StringPiece>>;
+using TransparentEq = folly::transparent<std::equal_to<folly::StringPiece>>;
+
 struct reg {
-  std::unordered_map<std::string, command_handler_def*> commands;
-  std::unordered_set<std::string> capabilities;
+  folly::
+      F14FastMap<std::string, command_handler_def*, TransparentHasher, TransparentEq>
+          commands;
+  folly::F14FastSet<std::string, TransparentHasher, TransparentEq>
+      capabilities;
 
   reg() {
     commands.reserve(16);
@@ -44,8 +53,8 @@ void register_command(command_handler_def& def) {
 command_handler_def* lookup_command(
     std::string_view cmd_name,
     CommandFlags mode) {
-  // TODO: Eliminate this copy in the lookup.
-  auto it = get_reg().commands.find(std::string{cmd_name});
+  auto it = get_reg().commands.find(
+      folly::StringPiece{cmd_name.data(), cmd_name.size()});
   auto def = it == get_reg().commands.end() ? nullptr : it->second;
 
   if (def) {
@@ -76,8 +85,8 @@ void capability_register(const char* name) {
 }
 
 bool capability_supported(std::string_view name) {
-  // TODO: Eliminate this copy.
-  return get_reg().capabilities.find(std::string{name}) !=
+  return get_reg().capabilities.find(
+             folly::StringPiece{name.data(), name.size()}) !=
       get_reg().capabilities.end();
 }
 
@@ -30,6 +30,10 @@ inline constexpr auto CMD_DAEMON = CommandFlags::raw(1);
 inline constexpr auto CMD_CLIENT = CommandFlags::raw(2);
 inline constexpr auto CMD_POISON_IMMUNE = CommandFlags::raw(4);
 inline constexpr auto CMD_ALLOW_ANY_USER = CommandFlags::raw(8);
+// Commands that can do unbounded work (crawls, full queries). During
+// reconnect storms their concurrency is bounded by the
+// max_concurrent_heavy_commands config option.
+inline constexpr auto CMD_EXPENSIVE = CommandFlags::raw(16);
 
 struct command_handler_def {
   const char* name;
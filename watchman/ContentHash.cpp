@@ -6,6 +6,8 @@
  */
 
 #include "watchman/ContentHash.h"
+#include "watchman/PDU.h"
+#include <memory>
 #include <folly/ScopeGuard.h>
 #include <string>
 #include "watchman/Logging.h"
@@ -46,17 +48,32 @@ ContentHashCache::ContentHashCache(
     const w_string& rootPath,
     size_t maxItems,
     std::chrono::milliseconds errorTTL)
-    : cache_(maxItems, errorTTL), rootPath_(rootPath) {}
+    : shards_{
+          {{maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL},
+           {maxItems / kShards, errorTTL}}},
+      rootPath_(rootPath) {}
 
 folly::Future<std::shared_ptr<const Node>> ContentHashCache::get(
     const ContentHashCacheKey& key) {
-  return cache_.get(
+  return shardFor(key).get(
       key, [this](const ContentHashCacheKey& k) { return computeHash(k); });
 }
 
 HashValue ContentHashCache::computeHashImmediate(const char* fullPath) {
   HashValue result;
-  uint8_t buf[8192];
+  // Hashing runs on thread pool workers (one task per file, so cache
+  // warming after a rebase already fans out across the pool); per-read
+  // syscall overhead was the limiter, so read in large chunks. The
+  // buffer is heap allocated to keep worker stacks small.
+  constexpr size_t kReadChunk = 512 * 1024;
+  auto bufStorage = std::make_unique<uint8_t[]>(kReadChunk);
+  auto* buf = bufStorage.get();
 
   auto stm = w_stm_open(fullPath, O_RDONLY);
   if (!stm) {
@@ -67,11 +84,17 @@ HashValue ContentHashCache::computeHashImmediate(const char* fullPath) {
   }
 
 #ifndef _WIN32
+#ifdef POSIX_FADV_SEQUENTIAL
+  // Let the kernel read ahead aggressively; we consume front to back.
+  posix_fadvise(
+      stm->getFileDescriptor().fd(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
   SHA_CTX ctx;
   SHA1_Init(&ctx);
 
   while (true) {
-    auto n = stm->read(buf, sizeof(buf));
+    auto n = stm->read(buf, kReadChunk);
     if (n == 0) {
       break;
     }
@@ -113,7 +136,7 @@ HashValue ContentHashCache::computeHashImmediate(const char* fullPath) {
   };
 
   while (true) {
-    auto n = stm->read(buf, sizeof(buf));
+    auto n = stm->read(buf, kReadChunk);
     if (n == 0) {
       break;
     }
@@ -165,11 +188,104 @@ folly::Future<HashValue> ContentHashCache::computeHash(
       &getThreadPool(), [key, this] { return computeHashImmediate(key); });
 }
 
+void ContentHashCache::saveToFile(const char* path) const {
+  auto entries = json_array();
+  auto forEachShard = [&](auto&& func) {
+    for (auto& shard : shards_) {
+      shard.forEach(func);
+    }
+  };
+  forEachShard([&](const ContentHashCacheKey& key, const HashValue& value) {
+    json_array_append_new(
+        entries,
+        json_array(
+            {w_string_to_json(key.relativePath),
+             json_integer(key.fileSize),
+             json_integer(key.mtime.tv_sec),
+             json_integer(key.mtime.tv_nsec),
+             w_string_to_json(w_string(
+                 reinterpret_cast<const char*>(value.data()),
+                 value.size(),
+                 W_STRING_BYTE))}));
+  });
+
+  auto file = w_stm_open(path, O_WRONLY | O_TRUNC | O_CREAT, 0600);
+  if (!file) {
+    log(ERR, "content hash store: unable to open ", path, " for write\n");
+    return;
+  }
+
+  auto store = json_object(
+      {{"root", w_string_to_json(rootPath_)}, {"entries", std::move(entries)}});
+  w_jbuffer_t buffer;
+  buffer.bserEncodeToStream(2, 0, store, file.get());
+}
+
+void ContentHashCache::loadFromFile(const char* path) {
+  auto file = w_stm_open(path, O_RDONLY);
+  if (!file) {
+    // Never having written a store is the common case
+    return;
+  }
+
+  try {
+    w_jbuffer_t buffer;
+    json_error_t jerr;
+    auto store = buffer.decodeNext(file.get(), &jerr);
+    if (!store || json_to_w_string(store.get_default("root")) != rootPath_) {
+      return;
+    }
+
+    auto entries = store.get_default("entries");
+    size_t loaded = 0;
+    for (size_t i = 0; i < json_array_size(entries); ++i) {
+      const auto& entry = entries.at(i);
+      auto hashStr = json_to_w_string(entry.at(4));
+      HashValue value;
+      if (hashStr.size() != value.size()) {
+        continue;
+      }
+      memcpy(value.data(), hashStr.data(), value.size());
+
+      ContentHashCacheKey key{
+          json_to_w_string(entry.at(0)),
+          size_t(json_integer_value(entry.at(1))),
+          {time_t(json_integer_value(entry.at(2))),
+           long(json_integer_value(entry.at(3)))}};
+      shardFor(key).set(key, std::move(value));
+      ++loaded;
+    }
+    log(DBG, "content hash store: loaded ", loaded, " entries\n");
+  } catch (const std::exception& exc) {
+    log(ERR, "content hash store: failed to load ", path, ": ", exc.what(), "\n");
+  }
+}
+
 const w_string& ContentHashCache::rootPath() const {
   return rootPath_;
 }
 
 CacheStats ContentHashCache::stats() const {
-  return cache_.stats();
+  lrucache::Stats combined;
+  size_t size = 0;
+  for (auto& shard : shards_) {
+    auto stats = shard.stats();
+    combined.cacheHit += stats.cacheHit;
+    combined.cacheShare += stats.cacheShare;
+    combined.cacheMiss += stats.cacheMiss;
+    combined.cacheEvict += stats.cacheEvict;
+    combined.cacheStore += stats.cacheStore;
+    combined.cacheLoad += stats.cacheLoad;
+    combined.cacheErase += stats.cacheErase;
+    combined.clearCount += stats.clearCount;
+    size += stats.size;
+  }
+  return CacheStats(combined, size);
+}
+
+void ContentHashCache::clear() {
+  for (auto& shard : shards_) {
+    shard.clear();
+  }
 }
 } // namespace watchman
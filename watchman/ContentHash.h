@@ -74,11 +74,37 @@ class ContentHashCache {
   // Returns the root path that this cache is associated with
   const w_string& rootPath() const;
 
-  // Returns cache statistics
+  // Returns cache statistics, aggregated across the shards
   CacheStats stats() const;
 
+  /**
+   * Persists the successfully cached hashes to the named file in BSER
+   * form. Entries are keyed by (path, size, mtime), so a restarted
+   * daemon can trust reloaded entries exactly as far as it trusts live
+   * ones.
+   */
+  void saveToFile(const char* path) const;
+
+  /** Loads entries previously written by saveToFile; ignores errors. */
+  void loadFromFile(const char* path);
+
+  /** Purges all cached hashes. */
+  void clear();
+
  private:
-  LRUCache<ContentHashCacheKey, HashValue> cache_;
+  // The cache is sharded by key hash: hashing runs on many pool workers
+  // at once (rebase warming, batched render fetches), and a single
+  // LRUCache lock was the documented concurrency limitation. Each shard
+  // is an ordinary LRUCache, so pending-lookup coalescing still works
+  // within a shard, which is where identical keys land by construction.
+  static constexpr size_t kShards = 8;
+
+  LRUCache<ContentHashCacheKey, HashValue>& shardFor(
+      const ContentHashCacheKey& key) {
+    return shards_[key.hashValue() % kShards];
+  }
+
+  std::array<LRUCache<ContentHashCacheKey, HashValue>, kShards> shards_;
   w_string rootPath_;
 };
 } // namespace watchman
@@ -6,6 +6,7 @@
  */
 
 #include "watchman/CookieSync.h"
+#include <folly/ExceptionWrapper.h>
 #include <folly/String.h>
 #include <exception>
 #include <optional>
@@ -72,6 +73,43 @@ std::vector<w_string> CookieSync::getOutstandingCookieFileList() const {
 }
 
 folly::Future<CookieSync::SyncResult> CookieSync::sync() {
+  {
+    auto batch = batch_.wlock();
+    if (batch->inflight) {
+      // A cookie is already on disk awaiting observation. Our sync must
+      // cover changes up to *now*, so we can't share that cookie; we
+      // queue for the next one, which is created the moment the current
+      // cookie completes. Concurrent sync storms thus write at most one
+      // cookie at a time instead of one per caller.
+      batch->queued.emplace_back();
+      return batch->queued.back().getFuture();
+    }
+    batch->inflight = true;
+  }
+
+  try {
+    return issueSync();
+  } catch (...) {
+    // Waiters may have queued in the window after we claimed the
+    // in-flight slot; fail them with this error as well, exactly as
+    // the completion continuation does, so nobody is left blocking on
+    // a follow-up cookie that will never be created.
+    std::vector<folly::Promise<SyncResult>> queued;
+    {
+      auto batch = batch_.wlock();
+      queued = std::move(batch->queued);
+      batch->queued.clear();
+      batch->inflight = false;
+    }
+    auto exc = folly::exception_wrapper(std::current_exception());
+    for (auto& p : queued) {
+      p.setException(exc);
+    }
+    throw;
+  }
+}
+
+folly::Future<CookieSync::SyncResult> CookieSync::issueSync() {
   auto prefixes = cookiePrefix();
   auto serial = serial_++;
 
@@ -127,9 +165,59 @@ folly::Future<CookieSync::SyncResult> CookieSync::sync() {
 
   cookiesLock->insert(pendingCookies.begin(), pendingCookies.end());
 
-  return cookie->promise.getFuture().thenValue(
-      [cookieFileNames = std::move(cookieFileNames)](folly::Unit) mutable {
-        return SyncResult{std::move(cookieFileNames)};
+  return cookie->promise.getFuture().thenTry(
+      [this, cookieFileNames = std::move(cookieFileNames)](
+          folly::Try<folly::Unit>&& result) mutable
+      -> folly::Future<SyncResult> {
+        // This cookie is done; release or hand over the in-flight slot.
+        std::vector<folly::Promise<SyncResult>> queued;
+        {
+          auto batch = batch_.wlock();
+          queued = std::move(batch->queued);
+          batch->queued.clear();
+          if (queued.empty() || result.hasException()) {
+            batch->inflight = false;
+          }
+        }
+
+        if (result.hasException()) {
+          // Aborted (eg: recrawl). Fail the queued waiters the same way;
+          // they will re-sync against the fresh state.
+          for (auto& p : queued) {
+            p.setException(result.exception());
+          }
+          return folly::makeFuture<SyncResult>(result.exception());
+        }
+
+        if (!queued.empty()) {
+          // Create the follow-up cookie for everyone who arrived while
+          // ours was pending, and fan its outcome out to them. Like the
+          // initial call in sync(), cookie creation can throw (ENOSPC,
+          // root removed); that must release the in-flight slot and
+          // fail the queued waiters, or every later sync() would queue
+          // behind a completion that never comes.
+          try {
+            issueSync().thenTry(
+                [queued = std::move(queued)](
+                    folly::Try<SyncResult>&& next) mutable {
+                  for (auto& p : queued) {
+                    if (next.hasException()) {
+                      p.setException(next.exception());
+                    } else {
+                      p.setValue(next.value());
+                    }
+                  }
+                });
+          } catch (...) {
+            batch_.wlock()->inflight = false;
+            auto exc = folly::exception_wrapper(std::current_exception());
+            for (auto& p : queued) {
+              p.setException(exc);
+            }
+          }
+        }
+
+        return folly::makeFuture(SyncResult{std::move(cookieFileNames)});
       });
 }
 
@@ -61,6 +61,13 @@ class CookieSync {
    **/
   folly::Future<SyncResult> sync();
 
+ private:
+  /** Writes a cookie and returns its future; used by sync(), which
+   * batches concurrent callers onto at most one in-flight cookie. */
+  folly::Future<SyncResult> issueSync();
+
+ public:
+
   /* If path is a valid cookie in the map, notify the waiter.
    * Returns true if the path matches the cookie prefix (not just
    * whether the cookie is currently valid).
@@ -114,6 +121,16 @@ class CookieSync {
   // Serial number for cookie filename
   std::atomic<uint32_t> serial_{0};
   using CookieMap = std::unordered_map<w_string, std::shared_ptr<Cookie>>;
+  // Waiters that arrive while a cookie is already in flight are queued
+  // here and satisfied by the next cookie, which is created when the
+  // current one completes. This caps cookie files at one in flight no
+  // matter how many clients sync during a storm.
+  struct BatchState {
+    bool inflight{false};
+    std::vector<folly::Promise<SyncResult>> queued;
+  };
+  folly::Synchronized<BatchState> batch_;
+
   folly::Synchronized<CookieMap> cookies_;
 };
 } // namespace watchman
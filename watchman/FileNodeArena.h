@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+#include "watchman/watchman_system.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+namespace watchman {
+
+/**
+ * Carves small variable-sized allocations out of large contiguous blocks.
+ *
+ * watchman_file nodes are small and extremely numerous; allocating each one
+ * individually fragments the heap and scatters the recency-index walk across
+ * it. The arena packs them into kBlockSize chunks instead, and releases those
+ * chunks wholesale when the owning ViewDatabase is destroyed (eg: when a root
+ * is reaped).
+ *
+ * Freed allocations are recycled through per-size free lists, so a tree whose
+ * file population is stable reuses the same storage indefinitely.
+ *
+ * This class performs no locking of its own: the owning ViewDatabase is
+ * always mutated with the view lock held, and that same lock covers the
+ * arena.
+ *
+ * A periodic compaction pass that rewrites the recency-list head segment
+ * into traversal order was evaluated and declined: nodes are referenced
+ * by raw pointer from dir->files (whose keys alias the node's own name
+ * storage), the recency links, and the tick checkpoints, so relocation
+ * means a stop-the-world fixup of every edge for a cache-locality gain
+ * that the explicit next-node prefetch in the generators already
+ * largely recovers. Churned nodes also recycle through the size-class
+ * free lists, which keeps the hot population clustered in practice.
+ */
+class FileNodeArena {
+ public:
+  // Sized and advised for transparent huge pages: a 4M-file view holds
+  // gigabytes of nodes, and 2MB mappings cut the TLB pressure that
+  // shows up in query scan profiles.
+  static constexpr size_t kBlockSize = 2 * 1024 * 1024;
+
+  // Allocations this large don't pack usefully into blocks, so they fall
+  // back to the general purpose heap.
+  static constexpr size_t kMaxArenaAllocSize = kBlockSize / 8;
+
+  FileNodeArena() = default;
+  FileNodeArena(const FileNodeArena&) = delete;
+  FileNodeArena& operator=(const FileNodeArena&) = delete;
+
+  ~FileNodeArena() {
+    for (auto* block : blocks_) {
+      freeBlock(block);
+    }
+  }
+
+  /**
+   * Returns size bytes of zeroed storage.
+   */
+  void* allocate(size_t size) {
+    size = roundUp(size);
+    liveBytes_ += size;
+    if (size > kMaxArenaAllocSize) {
+      return calloc(1, size);
+    }
+
+    auto idx = binIndex(size);
+    if (idx < freeLists_.size() && freeLists_[idx]) {
+      auto* node = freeLists_[idx];
+      freeLists_[idx] = node->next;
+      memset(node, 0, size);
+      return node;
+    }
+
+    if (bumpRemaining_ < size) {
+      // The unusable tail of the previous block is at most
+      // kMaxArenaAllocSize; with 8 bins that bounds internal waste to
+      // 12.5% in the worst case and far less in practice, since file
+      // nodes are much smaller than the threshold.
+      auto* block = allocateBlock();
+      blocks_.push_back(block);
+      bumpPtr_ = block;
+      bumpRemaining_ = kBlockSize;
+    }
+
+    auto* result = bumpPtr_;
+    bumpPtr_ += size;
+    bumpRemaining_ -= size;
+    return result;
+  }
+
+  /**
+   * Returns an allocation made by allocate() to the arena. size must be the
+   * same value that was passed to allocate().
+   */
+  void release(void* ptr, size_t size) {
+    size = roundUp(size);
+    liveBytes_ -= size;
+    if (size > kMaxArenaAllocSize) {
+      free(ptr);
+      return;
+    }
+
+    auto idx = binIndex(size);
+    if (idx >= freeLists_.size()) {
+      freeLists_.resize(idx + 1, nullptr);
+    }
+    auto* node = static_cast<FreeNode*>(ptr);
+    node->next = freeLists_[idx];
+    freeLists_[idx] = node;
+  }
+
+  /**
+   * Number of blocks currently backing the arena; exposed for debug
+   * reporting and tests.
+   */
+  size_t blockCount() const {
+    return blocks_.size();
+  }
+
+  /** Bytes in allocations that have not yet been released. */
+  size_t liveBytes() const {
+    return liveBytes_;
+  }
+
+  /** Bytes of block storage retained by the arena. */
+  size_t capacityBytes() const {
+    return blocks_.size() * kBlockSize;
+  }
+
+ private:
+  struct FreeNode {
+    FreeNode* next;
+  };
+
+  static char* allocateBlock() {
+#ifndef _WIN32
+    // Anonymous mappings arrive zeroed and lazily backed, so a small
+    // root doesn't pay for a whole block up front; MADV_HUGEPAGE lets
+    // the kernel back the interior with 2MB pages where it can, and
+    // quietly degrades to base pages under fragmentation.
+    void* p = mmap(
+        nullptr,
+        kBlockSize,
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0);
+    if (p == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(p, kBlockSize, MADV_HUGEPAGE);
+#endif
+    return static_cast<char*>(p);
+#else
+    auto* p = static_cast<char*>(calloc(1, kBlockSize));
+    if (!p) {
+      throw std::bad_alloc();
+    }
+    return p;
+#endif
+  }
+
+  static void freeBlock(char* block) {
+#ifndef _WIN32
+    munmap(block, kBlockSize);
+#else
+    free(block);
+#endif
+  }
+
+  static size_t roundUp(size_t size) {
+    // Keep allocations pointer-aligned and no smaller than a free list
+    // node.
+    return (std::max(size, sizeof(FreeNode)) + alignof(std::max_align_t) - 1) &
+        ~(alignof(std::max_align_t) - 1);
+  }
+
+  static size_t binIndex(size_t roundedSize) {
+    return roundedSize / alignof(std::max_align_t);
+  }
+
+  std::vector<char*> blocks_;
+  size_t liveBytes_{0};
+  std::vector<FreeNode*> freeLists_;
+  char* bumpPtr_{nullptr};
+  size_t bumpRemaining_{0};
+};
+
+} // namespace watchman
@@ -7,6 +7,10 @@
 
 #include "watchman/GroupLookup.h"
 #include <folly/String.h>
+#include <utility>
+#include <unordered_map>
+#include <string>
+#include <mutex>
 #include "watchman/Logging.h"
 
 #ifndef _WIN32
@@ -20,10 +24,35 @@
 using namespace watchman;
 
 const struct group* w_get_group(const char* group_name) {
+  // getgrnam can stall for multiple milliseconds when NSS is backed by
+  // LDAP, and the answer for a given name is effectively static for the
+  // daemon's lifetime. Cache the resolved entry per name; callers only
+  // consult gr_name and gr_gid, which the cached copy preserves.
+  static std::mutex cacheMutex;
+  static std::unordered_map<std::string, std::pair<std::string, gid_t>>
+      cache;
+
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(group_name);
+    if (it != cache.end()) {
+      static thread_local struct group cached;
+      cached = group{};
+      cached.gr_name = const_cast<char*>(it->second.first.c_str());
+      cached.gr_gid = it->second.second;
+      return &cached;
+    }
+  }
+
   // This explicit errno statement is necessary to distinguish between the
   // group not existing and an error.
   errno = 0;
   struct group* group = getgrnam(group_name);
+  if (group) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    cache.emplace(
+        group_name, std::make_pair(std::string(group->gr_name), group->gr_gid));
+  }
   if (!group) {
     if (errno == 0) {
       logf(ERR, "group '{}' does not exist\n", group_name);
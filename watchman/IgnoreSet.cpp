@@ -7,6 +7,9 @@
 
 #include "watchman/IgnoreSet.h"
 
+#include <algorithm>
+#include <vector>
+
 // The path and everything below it is ignored.
 #define FULL_IGNORE 0x1
 // The grand-children of the path are ignored, but not the path
@@ -23,11 +26,67 @@ void IgnoreSet::add(const w_string& path, bool is_vcs_ignore) {
   if (!is_vcs_ignore) {
     dirs_vec.push_back(path);
   }
+
+  // The entry set is tiny and only mutated at root init, so just
+  // recompute the gate from scratch.
+  rebuildGate();
+}
+
+void IgnoreSet::rebuildGate() {
+  gateNextByte_.reset();
+  gateBypass_ = false;
+
+  std::vector<const w_string*> entries;
+  for (auto& entry : ignore_vcs) {
+    entries.push_back(&entry);
+  }
+  for (auto& entry : ignore_dirs) {
+    entries.push_back(&entry);
+  }
+  if (entries.empty()) {
+    gateBypass_ = true;
+    return;
+  }
+
+  gatePrefixLen_ = entries.front()->size();
+  for (auto* entry : entries) {
+    uint32_t common = 0;
+    auto limit = std::min(gatePrefixLen_, uint32_t(entry->size()));
+    while (common < limit &&
+           entry->data()[common] == entries.front()->data()[common]) {
+      ++common;
+    }
+    gatePrefixLen_ = common;
+  }
+
+  for (auto* entry : entries) {
+    if (entry->size() <= gatePrefixLen_) {
+      // An entry is exactly the shared prefix; everything beneath it
+      // may match, so the gate cannot reject by next byte.
+      gateBypass_ = true;
+      return;
+    }
+    gateNextByte_.set(uint8_t(entry->data()[gatePrefixLen_]));
+  }
 }
 
 bool IgnoreSet::isIgnored(const char* path, uint32_t pathlen) const {
   const char* skip_prefix;
   uint32_t len;
+
+  if (!gateBypass_) {
+    if (pathlen <= gatePrefixLen_) {
+      // Shorter than every entry: cannot be at or below an ignore.
+      return false;
+    }
+    if (!gateNextByte_.test(uint8_t(path[gatePrefixLen_]))) {
+      // Diverges from every entry at the first byte past the shared
+      // prefix. (A path that doesn't share the prefix at all can pass
+      // this test spuriously; the tree walk below settles it.)
+      return false;
+    }
+  }
+
   auto leaf = tree.longestMatch((const unsigned char*)path, (int)pathlen);
 
   if (!leaf) {
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <unordered_set>
+#include <bitset>
 #include "watchman/thirdparty/libart/src/art.h"
 #include "watchman/watchman_string.h"
 
@@ -35,6 +36,19 @@ class IgnoreSet {
   }
 
  private:
+  // Recomputes the front gate below after the entry set changes.
+  void rebuildGate();
+
+  // Fast rejection gate for isIgnored. All ignore entries share a common
+  // prefix (at minimum the root path); a candidate that is no longer
+  // than that prefix, or whose byte just past it doesn't appear in any
+  // entry, cannot match and is rejected without walking the radix tree.
+  // The overwhelmingly common not-ignored answer then costs a length
+  // compare and one bit test.
+  uint32_t gatePrefixLen_{0};
+  std::bitset<256> gateNextByte_;
+  bool gateBypass_{false};
+
   // if the map has an entry for a given dir, we're ignoring it */
   std::unordered_set<w_string> ignore_vcs;
   std::unordered_set<w_string> ignore_dirs;
@@ -23,6 +23,10 @@
 #include "watchman/watcher/Watcher.h"
 #include "watchman/watchman_file.h"
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 // Each root gets a number that uniquely identifies it within the process. This
 // helps avoid confusion if a root is removed and then added again.
 static std::atomic<long> next_root_number{1};
@@ -50,6 +54,129 @@ inline std::string make_path_name(
   result.append(name, nlen);
   return result;
 }
+
+/**
+ * Returns the since clock ticks below which subtrees may be pruned for
+ * this query, or 0 when pruning does not apply (pruning disabled, fresh
+ * instance, or timestamp-based since).
+ */
+/**
+ * Pins the calling thread to the cpu set named by the root's pin_cpus
+ * config option, if any. Pinning a root's iothread and notify thread to
+ * cpus on one NUMA node keeps them co-located, and since the view's
+ * arena pages are first touched by the iothread, the root's memory lands
+ * on that node as well. No-op off Linux or when unconfigured.
+ */
+void applyRootThreadAffinity(const Configuration& config) {
+#ifdef __linux__
+  auto cpus = config.get("pin_cpus");
+  if (!cpus || !cpus.isArray() || json_array_size(cpus) == 0) {
+    return;
+  }
+
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (size_t i = 0; i < json_array_size(cpus); ++i) {
+    auto cpu = json_integer_value(cpus.at(i));
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(int(cpu), &set);
+    }
+  }
+
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    logf(ERR, "pin_cpus: sched_setaffinity failed: {}\n", errno);
+  }
+#else
+  (void)config;
+#endif
+}
+
+/**
+ * Returns the full (root-prefixed) literal dir prefix the query's
+ * expression requires, if any, so generator walks can skip every file
+ * outside it before materializing candidates.
+ */
+w_string expressionPathScope(const QueryContext* ctx, const w_string& root) {
+  if (!ctx->query->expr) {
+    return nullptr;
+  }
+  auto prefix = ctx->query->expr->literalPathPrefix();
+  if (!prefix) {
+    return nullptr;
+  }
+  // wholename is relative to relative_root when set
+  if (ctx->query->relative_root) {
+    return w_string::pathCat({ctx->query->relative_root, *prefix});
+  }
+  return w_string::pathCat({root, *prefix});
+}
+
+/** True if dirPath is pathScope itself or lives beneath it. */
+bool dirWithinScope(w_string_piece dirPath, const w_string& pathScope) {
+  if (dirPath == w_string_piece{pathScope}) {
+    return true;
+  }
+  return dirPath.startsWith(pathScope) && dirPath.size() > pathScope.size() &&
+      is_slash(dirPath.data()[pathScope.size()]);
+}
+
+uint32_t subtreePruneTicks(const QueryContext* ctx) {
+  if (!ctx->query->prune_unchanged_dirs) {
+    return 0;
+  }
+  auto* clock = std::get_if<QuerySince::Clock>(&ctx->since.since);
+  if (!clock || clock->is_fresh_instance) {
+    return 0;
+  }
+  return clock->ticks;
+}
+
+/**
+ * A minimal QueryContextBase for evaluating the query expression on a
+ * worker thread. Terms only consult the clock fields and getWholeName(),
+ * so that is all we replicate; everything order- or result-related stays
+ * on the client thread's QueryContext.
+ */
+class ParallelEvalContext final : public QueryContextBase {
+ public:
+  ParallelEvalContext(const QueryContext& ctx, const w_string& rootPath)
+      : nameStart_(
+            (ctx.query->relative_root ? ctx.query->relative_root.size()
+                                      : rootPath.size()) +
+            1) {
+    clockAtStartOfQuery = ctx.clockAtStartOfQuery;
+    lastAgeOutTickValueAtStartOfQuery =
+        ctx.lastAgeOutTickValueAtStartOfQuery;
+  }
+
+  void setFile(FileResult* file) {
+    file_ = file;
+    wholeName_.reset();
+  }
+
+  uint32_t getWholeNamePrefixSize() override {
+    return nameStart_;
+  }
+
+  const w_string& getWholeName() override {
+    if (!wholeName_) {
+      // Mirrors QueryContext::computeWholeName.
+      auto parent = file_->dirName();
+      if (nameStart_ > parent.size()) {
+        wholeName_ = file_->baseName().asWString();
+      } else {
+        parent.advance(nameStart_);
+        wholeName_ = w_string::build(parent, "/", file_->baseName());
+      }
+    }
+    return wholeName_;
+  }
+
+ private:
+  uint32_t nameStart_;
+  FileResult* file_{nullptr};
+  w_string wholeName_;
+};
 } // namespace
 
 InMemoryViewCaches::InMemoryViewCaches(
@@ -62,8 +189,15 @@ InMemoryViewCaches::InMemoryViewCaches(
 
 InMemoryFileResult::InMemoryFileResult(
     const watchman_file* file,
-    InMemoryViewCaches& caches)
-    : file_(file), caches_(caches) {}
+    InMemoryViewCaches& caches,
+    w_string dirName)
+    : stat_(file->stat),
+      exists_(file->exists),
+      ctime_(file->ctime),
+      otime_(file->otime),
+      baseName_(file->getName().asWString()),
+      dirName_(std::move(dirName)),
+      caches_(caches) {}
 
 void InMemoryFileResult::batchFetchProperties(
     const std::vector<std::unique_ptr<FileResult>>& files) {
@@ -88,7 +222,7 @@ void InMemoryFileResult::batchFetchProperties(
     auto* file = dynamic_cast<InMemoryFileResult*>(f.get());
 
     if (file->neededProperties() & FileResult::Property::SymlinkTarget) {
-      if (!file->file_->stat.isSymlink()) {
+      if (!file->stat_.isSymlink()) {
         // If this file is not a symlink then we yield
         // a nullptr w_string instance rather than propagating an error.
         // This behavior is relied upon by the field rendering code and
@@ -106,7 +240,7 @@ void InMemoryFileResult::batchFetchProperties(
         }
 
         SymlinkTargetCacheKey key{
-            w_string::pathCat({dir, file->baseName()}), file->file_->otime};
+            w_string::pathCat({dir, file->baseName()}), file->otime_};
 
         readlinkFutures.emplace_back(
             caches_.symlinkTargetCache.get(key).thenTry(
@@ -137,8 +271,8 @@ void InMemoryFileResult::batchFetchProperties(
 
       ContentHashCacheKey key{
           w_string::pathCat({dir, file->baseName()}),
-          size_t(file->file_->stat.size),
-          file->file_->stat.mtime};
+          size_t(file->stat_.size),
+          file->stat_.mtime};
 
       sha1Futures.emplace_back(caches_.contentHashCache.get(key).thenTry(
           [file](folly::Try<std::shared_ptr<const ContentHashCache::Node>>&&
@@ -153,51 +287,48 @@ void InMemoryFileResult::batchFetchProperties(
 }
 
 std::optional<FileInformation> InMemoryFileResult::stat() {
-  return file_->stat;
+  return stat_;
 }
 
 std::optional<size_t> InMemoryFileResult::size() {
-  return file_->stat.size;
+  return stat_.size;
 }
 
 std::optional<struct timespec> InMemoryFileResult::accessedTime() {
-  return file_->stat.atime;
+  return stat_.atime;
 }
 
 std::optional<struct timespec> InMemoryFileResult::modifiedTime() {
-  return file_->stat.mtime;
+  return stat_.mtime;
 }
 
 std::optional<struct timespec> InMemoryFileResult::changedTime() {
-  return file_->stat.ctime;
+  return stat_.ctime;
 }
 
 w_string_piece InMemoryFileResult::baseName() {
-  return file_->getName();
+  return baseName_;
 }
 
 w_string_piece InMemoryFileResult::dirName() {
-  if (!dirName_) {
-    dirName_ = file_->parent->getFullPath();
-  }
   return dirName_;
 }
 
 std::optional<bool> InMemoryFileResult::exists() {
-  return file_->exists;
+  return exists_;
 }
 
 std::optional<ClockStamp> InMemoryFileResult::ctime() {
-  return file_->ctime;
+  return ctime_;
 }
 
 std::optional<ClockStamp> InMemoryFileResult::otime() {
-  return file_->otime;
+  return otime_;
 }
 
 std::optional<w_string> InMemoryFileResult::readLink() {
   if (!symlinkTarget_.has_value()) {
-    if (!file_->stat.isSymlink()) {
+    if (!stat_.isSymlink()) {
       // If this file is not a symlink then we immediately yield
       // a nullptr w_string instance rather than propagating an error.
       // This behavior is relied upon by the field rendering code and
@@ -213,13 +344,13 @@ std::optional<w_string> InMemoryFileResult::readLink() {
 }
 
 std::optional<FileResult::ContentHash> InMemoryFileResult::getContentSha1() {
-  if (!file_->exists) {
+  if (!exists_) {
     // Don't return hashes for files that we believe to be deleted.
     throw std::system_error(
         std::make_error_code(std::errc::no_such_file_or_directory));
   }
 
-  if (!file_->stat.isFile()) {
+  if (!stat_.isFile()) {
     // We only want to compute the hash for regular files
     throw std::system_error(std::make_error_code(std::errc::is_a_directory));
   }
@@ -269,7 +400,8 @@ watchman_dir* ViewDatabase::resolveDir(const w_string& dir_name, bool create) {
       // we have another pending item for the parent.  We'll create the
       // parent dir now and our other machinery will populate its contents
       // later.
-      w_string child_name(dir_component, (uint32_t)(sep - dir_component));
+      auto child_name = w_string::intern(
+          w_string(dir_component, (uint32_t)(sep - dir_component)));
 
       // Careful! dir->dirs is keyed by non-owning string pieces so the
       // child_name MUST be stored or otherwise kept alive by the watchman_dir
@@ -297,7 +429,8 @@ watchman_dir* ViewDatabase::resolveDir(const w_string& dir_name, bool create) {
     dir_component = sep + 1;
   }
 
-  w_string child_name(dir_component, (uint32_t)(dir_end - dir_component));
+  auto child_name = w_string::intern(
+      w_string(dir_component, (uint32_t)(dir_end - dir_component)));
   // Careful! parent->dirs is keyed by non-owning string pieces so the
   // child_name MUST be stored or otherwise kept alive by the watchman_dir
   // instance constructed below!
@@ -366,7 +499,7 @@ watchman_file* ViewDatabase::getOrCreateChildFile(
 
   // ... but take the shorter string from inside the file that
   // we create as the key.
-  auto file = watchman_file::make(file_name, dir);
+  auto file = watchman_file::make(file_name, dir, &fileNodeArena_);
   auto& file_ptr = dir->files[file->getName()];
   file_ptr = std::move(file);
 
@@ -385,6 +518,10 @@ void ViewDatabase::markFileChanged(
     watcher.startWatchFile(file);
   }
 
+  // The checkpoint map is keyed by the current otime, so any entry for
+  // this file must be dropped before it is rewritten below.
+  invalidateRecencyCheckpoint(file);
+
   file->otime = otime;
 
   if (latestFile_ != file) {
@@ -394,6 +531,80 @@ void ViewDatabase::markFileChanged(
     // and move to the head
     insertAtHeadOfFileList(file);
   }
+
+  // Bubble the change clock up the dir chain. The hint is monotone, so we
+  // can stop as soon as an ancestor is already current; amortized this is
+  // O(1) per change.
+  for (auto* dir = file->parent; dir; dir = dir->parent) {
+    if (dir->max_changed_ticks >= otime.ticks) {
+      break;
+    }
+    dir->max_changed_ticks = otime.ticks;
+  }
+
+  maybeRecordRecencyCheckpoint(file);
+}
+
+void ViewDatabase::invalidateRecencyCheckpoint(watchman_file* file) {
+  auto it = recencyCheckpoints_.find(file->otime.ticks);
+  if (it != recencyCheckpoints_.end() && it->second == file) {
+    recencyCheckpoints_.erase(it);
+  }
+}
+
+void ViewDatabase::maybeRecordRecencyCheckpoint(watchman_file* file) {
+  if (file->otime.ticks < lastCheckpointTick_ + kCheckpointTickInterval) {
+    return;
+  }
+  recencyCheckpoints_[file->otime.ticks] = file;
+  lastCheckpointTick_ = file->otime.ticks;
+  if (recencyCheckpoints_.size() > kMaxCheckpoints) {
+    // Oldest checkpoints are the least useful; shed from the front.
+    recencyCheckpoints_.erase(recencyCheckpoints_.begin());
+  }
+}
+
+const watchman_file* ViewDatabase::seekNewestOlderThanTicks(
+    uint32_t ticks) const {
+  // The smallest checkpoint at or above `ticks` lies in the
+  // already-visited region; walking from it reaches the resume point
+  // within at most one checkpoint interval of nodes, instead of
+  // re-walking from the head.
+  const watchman_file* f = nullptr;
+  for (auto it = recencyCheckpoints_.lower_bound(ticks);
+       it != recencyCheckpoints_.end();
+       ++it) {
+    if (it->second->otime.ticks == it->first) {
+      f = it->second;
+      break;
+    }
+  }
+  if (!f) {
+    f = latestFile_;
+  }
+  while (f && f->otime.ticks >= ticks) {
+    f = f->next;
+  }
+  return f;
+}
+
+watchman_file* ViewDatabase::seekRecencyOlderThan(time_t boundary) {
+  for (auto it = recencyCheckpoints_.begin();
+       it != recencyCheckpoints_.end();) {
+    auto* file = it->second;
+    if (file->otime.ticks != it->first) {
+      // Shouldn't happen given the eager invalidation in markFileChanged,
+      // but a stale entry here would cause an incorrect seek, so drop it
+      // defensively.
+      it = recencyCheckpoints_.erase(it);
+      continue;
+    }
+    if (file->otime.timestamp > boundary) {
+      return file;
+    }
+    ++it;
+  }
+  return nullptr;
 }
 
 void ViewDatabase::markDirDeleted(
@@ -427,6 +638,50 @@ void ViewDatabase::markDirDeleted(
   }
 }
 
+void ViewDatabase::enqueueDirTombstone(watchman_dir* dir, ClockStamp otime) {
+  if (!dir->last_check_existed) {
+    // Already known-deleted (or already tombstoned)
+    return;
+  }
+  dir->last_check_existed = false;
+  pendingTombstones_.emplace_back(dir, otime);
+}
+
+bool ViewDatabase::processSomeTombstones(Watcher& watcher, size_t limit) {
+  size_t processed = 0;
+
+  while (processed < limit && !pendingTombstones_.empty()) {
+    auto [dir, otime] = pendingTombstones_.front();
+    pendingTombstones_.pop_front();
+
+    if (dir->last_check_existed) {
+      // Resurrected after being tombstoned; the crawl that resurrected
+      // it owns the subtree state now.
+      continue;
+    }
+
+    for (auto& it : dir->files) {
+      auto file = it.second.get();
+
+      // A file bumped after the tombstone was recorded was re-observed
+      // (eg: the dir came back); don't clobber that newer state.
+      if (file->exists && file->otime.ticks <= otime.ticks) {
+        auto full_name = dir->getFullPathToChild(file->getName());
+        logf(DBG, "mark_deleted: {}\n", full_name);
+        file->exists = false;
+        markFileChanged(watcher, file, otime);
+        ++processed;
+      }
+    }
+
+    for (auto& it : dir->dirs) {
+      enqueueDirTombstone(it.second.get(), otime);
+    }
+  }
+
+  return !pendingTombstones_.empty();
+}
+
 void ViewDatabase::insertAtHeadOfFileList(struct watchman_file* file) {
   file->next = latestFile_;
   if (file->next) {
@@ -482,6 +737,24 @@ InMemoryView::InMemoryView(
           config_.getInt("symlink_target_max_items", 32 * 1024),
           std::chrono::milliseconds(
               config_.getInt("content_hash_negative_cache_ttl_ms", 2000))),
+      ioThreadViewBatchSize_(
+          size_t(config_.getInt("iothread_view_batch_size", 0))),
+      enableParallelCrawl_(config_.getBool("parallel_crawl", false)),
+      enableStatPrefetch_(config_.getBool("stat_batch_prefetch", false)),
+      enableBufferedReaddir_(config_.getBool("buffered_readdir", false)),
+      enableParallelEval_(config_.getBool("parallel_query_eval", false)),
+      adaptiveSettle_(config_.getBool("adaptive_settle", false)),
+      enableCookielessSync_(
+          config_.getBool("experimental_cookieless_sync", false)),
+      notifySleep_(
+          std::chrono::milliseconds(config_.getInt("notify_sleep_ms", 0))),
+      adaptiveSettleFloor_(
+          std::chrono::milliseconds(config_.getInt("adaptive_settle_min_ms", 5))),
+      maxRootMemoryBytes_(
+          size_t(config_.getInt("max_root_memory_bytes", 0))),
+      viewSnapshotPath_(config_.getString("view_snapshot_path", "")),
+      viewSnapshotIntervalTicks_(
+          uint32_t(config_.getInt("view_snapshot_interval_ticks", 65536))),
       enableContentCacheWarming_(
           config_.getBool("content_hash_warming", false)),
       maxFilesToWarmInContentCache_(
@@ -489,6 +762,17 @@ InMemoryView::InMemoryView(
       syncContentCacheWarming_(
           config_.getBool("content_hash_warm_wait_before_settle", false)),
       scm_(SCM::scmForPath(root_path)) {
+  {
+    auto* hashStore = config_.getString("content_hash_store_path", "");
+    if (*hashStore) {
+      caches_.contentHashCache.loadFromFile(hashStore);
+    }
+    auto* scmStore = config_.getString("scm_cache_store_path", "");
+    if (*scmStore && scm_) {
+      scm_->loadCaches(scmStore);
+    }
+  }
+
   json_int_t in_memory_view_ring_log_size =
       config_.getInt("in_memory_view_ring_log_size", 0);
   if (in_memory_view_ring_log_size) {
@@ -500,6 +784,7 @@ InMemoryView::InMemoryView(
 InMemoryView::~InMemoryView() = default;
 
 ClockStamp InMemoryView::ageOutFile(
+    ViewDatabase& view,
     std::unordered_set<w_string>& dirs_to_erase,
     watchman_file* file) {
   auto parent = file->parent;
@@ -509,6 +794,9 @@ ClockStamp InMemoryView::ageOutFile(
 
   auto ageOutOtime = file->otime;
 
+  // The file is about to be freed; don't leave a dangling checkpoint.
+  view.invalidateRecencyCheckpoint(file);
+
   // If we have a corresponding dir, we want to arrange to remove it, but only
   // after we have unlinked all of the associated file nodes.
   dirs_to_erase.insert(full_name);
@@ -526,14 +814,32 @@ void InMemoryView::ageOut(PerfSample& sample, std::chrono::seconds minAge) {
   uint32_t num_walked = 0;
   std::unordered_set<w_string> dirs_to_erase;
 
+  // How many nodes to visit before releasing the view lock so that
+  // queries can interleave with a long age-out scan. This function runs
+  // on the iothread — the only writer — so the list cannot change while
+  // the lock is dropped and the scan may simply resume where it left off.
+  constexpr uint32_t kAgeOutSliceSize = 16 * 1024;
+
   auto now = std::chrono::system_clock::now();
   lastAgeOutTimestamp_ = now;
   auto view = view_.wlock();
 
-  watchman_file* file = view->getLatestFile();
+  // Files newer than the age-out boundary can never be reaped, so use the
+  // recency checkpoints to seek past the recently-changed head segment
+  // rather than walking it. On a busy root that segment is the bulk of the
+  // list.
+  watchman_file* file = view->seekRecencyOlderThan(
+      std::chrono::system_clock::to_time_t(now - minAge));
+  if (!file) {
+    file = view->getLatestFile();
+  }
   watchman_file* prior = nullptr;
   while (file) {
     ++num_walked;
+    if (0 == (num_walked % kAgeOutSliceSize)) {
+      view.unlock();
+      view = view_.wlock();
+    }
     if (file->exists ||
         std::chrono::system_clock::from_time_t(file->otime.timestamp) + minAge >
             now) {
@@ -542,7 +848,7 @@ void InMemoryView::ageOut(PerfSample& sample, std::chrono::seconds minAge) {
       continue;
     }
 
-    auto agedOtime = ageOutFile(dirs_to_erase, file);
+    auto agedOtime = ageOutFile(*view, dirs_to_erase, file);
 
     // Revise tick for fresh instance reporting
     lastAgeOutTick_ = std::max(lastAgeOutTick_, agedOtime.ticks);
@@ -574,33 +880,151 @@ void InMemoryView::ageOut(PerfSample& sample, std::chrono::seconds minAge) {
            {"dirs", json_integer(dirs_to_erase.size())}}));
 }
 
+void InMemoryView::processCandidates(
+    const Query* query,
+    QueryContext* ctx,
+    std::vector<std::unique_ptr<FileResult>> candidates) const {
+  // Below this size the fan-out overhead outweighs the win.
+  constexpr size_t kParallelEvalThreshold = 8192;
+  // Chunk size for worker tasks.
+  constexpr size_t kEvalChunkSize = 4096;
+
+  if (!enableParallelEval_ || !query->expr ||
+      candidates.size() < kParallelEvalThreshold) {
+    for (auto& candidate : candidates) {
+      w_query_process_file(query, ctx, std::move(candidate));
+    }
+    return;
+  }
+
+  // Evaluate the expression against chunks of candidates concurrently.
+  // Verdicts are recorded per candidate; anything that throws or needs
+  // more data is left unset and re-evaluated serially below, so error
+  // behavior is unchanged.
+  std::vector<std::optional<bool>> verdicts(candidates.size());
+  std::vector<folly::Future<folly::Unit>> futures;
+  futures.reserve(1 + candidates.size() / kEvalChunkSize);
+
+  for (size_t start = 0; start < candidates.size();
+       start += kEvalChunkSize) {
+    auto end = std::min(start + kEvalChunkSize, candidates.size());
+    futures.push_back(
+        folly::via(&getThreadPool(), [&, this, start, end] {
+          ParallelEvalContext evalCtx{*ctx, rootPath_};
+          for (size_t i = start; i < end; ++i) {
+            evalCtx.setFile(candidates[i].get());
+            verdicts[i] =
+                query->expr->evaluate(&evalCtx, candidates[i].get());
+          }
+        }));
+  }
+  folly::collectAll(futures.begin(), futures.end()).wait();
+
+  // Rendering and result accumulation happen in candidate order on this
+  // thread, exactly as in the serial path.
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    w_query_process_file(query, ctx, std::move(candidates[i]), verdicts[i]);
+  }
+}
+
 void InMemoryView::timeGenerator(const Query* query, QueryContext* ctx) const {
-  // Walk back in time until we hit the boundary
-  auto view = view_.rlock();
-  ctx->generationStarted();
+  // Walk back in time until we hit the boundary. The walk happens with
+  // the view lock held and only snapshots candidate nodes; expression
+  // evaluation and rendering run with the lock released. To keep peak
+  // memory bounded on multi-million-file walks, candidates are
+  // snapshotted and evaluated in batches: the lock is dropped between
+  // batches and the walk resumes at a tick boundary via the checkpoint
+  // seek. Nodes bumped while the lock was dropped acquire a newer tick
+  // and are skipped on resume; their change is newer than the clock this
+  // query returns, so the caller's next query reports them.
+  constexpr size_t kCandidateBatchSize = 16 * 1024;
+
+  // An expression that can only match one file type (eg: a type term
+  // inside an allof) lets us skip non-matching nodes before paying to
+  // snapshot them. Deleted files keep their last known mode, so this
+  // matches TypeExpr's own behavior for them.
+  auto typeFilter = query->expr ? query->expr->soleTypeFilter() : std::nullopt;
+
+  // Likewise, a wholename pattern with a literal directory head can
+  // only match files under that prefix.
+  auto pathScope = expressionPathScope(ctx, rootPath_);
+
+  bool firstBatch = true;
+  bool done = false;
+  uint32_t resumeBelowTicks = 0;
+
+  while (!done) {
+    std::vector<std::unique_ptr<FileResult>> candidates;
+    {
+      auto view = view_.rlock();
+      if (firstBatch) {
+        ctx->generationStarted();
+        firstBatch = false;
+      }
 
-  for (watchman_file* f = view->getLatestFile(); f; f = f->next) {
-    ctx->bumpNumWalked();
-    // Note that we use <= for the time comparisons in here so that we
-    // report the things that changed inclusive of the boundary presented.
-    // This is especially important for clients using the coarse unix
-    // timestamp as the since basis, as they would be much more
-    // likely to miss out on changes if we didn't.
-    if (auto* since_ts = std::get_if<QuerySince::Timestamp>(&ctx->since.since);
-        since_ts && f->otime.timestamp <= since_ts->time) {
-      break;
-    }
-    if (auto* since_clock = std::get_if<QuerySince::Clock>(&ctx->since.since);
-        since_clock && f->otime.ticks <= since_clock->ticks) {
-      break;
-    }
+      const watchman_file* f;
+      if (resumeBelowTicks) {
+        f = view->seekNewestOlderThanTicks(resumeBelowTicks);
+      } else {
+        f = view->getLatestFile();
+      }
 
-    if (!ctx->fileMatchesRelativeRoot(f)) {
-      continue;
+      // Most candidates cluster into a small number of dirs, so share
+      // one rendered path per dir rather than computing it per file.
+      std::unordered_map<const watchman_dir*, w_string> dirPaths;
+
+      done = true;
+      for (; f; f = f->next) {
+        f->prefetchNext();
+        ctx->bumpNumWalked();
+        // Note that we use <= for the time comparisons in here so that we
+        // report the things that changed inclusive of the boundary presented.
+        // This is especially important for clients using the coarse unix
+        // timestamp as the since basis, as they would be much more
+        // likely to miss out on changes if we didn't.
+        if (auto* since_ts =
+                std::get_if<QuerySince::Timestamp>(&ctx->since.since);
+            since_ts && f->otime.timestamp <= since_ts->time) {
+          break;
+        }
+        if (auto* since_clock =
+                std::get_if<QuerySince::Clock>(&ctx->since.since);
+            since_clock && f->otime.ticks <= since_clock->ticks) {
+          break;
+        }
+
+        bool wanted = true;
+        if (typeFilter && !modeMatchesTypeChar(f->stat.mode, *typeFilter)) {
+          wanted = false;
+        } else if (
+            pathScope && !dirWithinScope(f->parent->full_path, pathScope)) {
+          wanted = false;
+        } else if (!ctx->fileMatchesRelativeRoot(f)) {
+          wanted = false;
+        }
+
+        if (wanted) {
+          auto& dirPath = dirPaths[f->parent];
+          if (!dirPath) {
+            dirPath = f->parent->getFullPath();
+          }
+          candidates.push_back(
+              std::make_unique<InMemoryFileResult>(f, caches_, dirPath));
+        }
+
+        // Pause only between nodes of different ticks: a tick value is
+        // then either fully processed or fully pending, which is what
+        // makes the resume seek exact.
+        if (candidates.size() >= kCandidateBatchSize && f->next &&
+            f->next->otime.ticks != f->otime.ticks) {
+          resumeBelowTicks = f->otime.ticks;
+          done = false;
+          break;
+        }
+      }
     }
 
-    w_query_process_file(
-        query, ctx, std::make_unique<InMemoryFileResult>(f, caches_));
+    processCandidates(query, ctx, std::move(candidates));
   }
 }
 
@@ -614,9 +1038,22 @@ void InMemoryView::pathGenerator(const Query* query, QueryContext* ctx) const {
     relative_root = rootPath_;
   }
 
+  // Collect candidates under the read lock and evaluate them after it
+  // is released, as the time generator does; this keeps long path walks
+  // from blocking the iothread's pending-change application, which
+  // folly::SharedMutex admits ahead of newly arriving readers.
+  std::vector<std::unique_ptr<FileResult>> candidates;
+
   auto view = view_.rlock();
   ctx->generationStarted();
 
+  // Path lists commonly name many entries in the same directory; memoize
+  // the last parent resolution (including the negative answer) so each
+  // distinct dir is walked once per query rather than once per path.
+  w_string lastDirName;
+  const watchman_dir* lastDir = nullptr;
+  bool haveLastDir = false;
+
   for (const auto& path : *query->paths) {
     const watchman_dir* dir;
     w_string dir_name;
@@ -640,7 +1077,14 @@ void InMemoryView::pathGenerator(const Query* query, QueryContext* ctx) const {
       continue;
     }
 
-    dir = view->resolveDir(dir_name);
+    if (haveLastDir && lastDirName == dir_name) {
+      dir = lastDir;
+    } else {
+      dir = view->resolveDir(dir_name);
+      lastDirName = dir_name;
+      lastDir = dir;
+      haveLastDir = true;
+    }
 
     if (!dir) {
       // Doesn't exist, and never has
@@ -654,8 +1098,8 @@ void InMemoryView::pathGenerator(const Query* query, QueryContext* ctx) const {
       // If it's a file (but not an existent dir)
       if (f && (!f->exists || !f->stat.isDir())) {
         ctx->bumpNumWalked();
-        w_query_process_file(
-            query, ctx, std::make_unique<InMemoryFileResult>(f, caches_));
+        candidates.push_back(
+            std::make_unique<InMemoryFileResult>(f, caches_, dir_name));
         continue;
       }
     }
@@ -669,29 +1113,47 @@ void InMemoryView::pathGenerator(const Query* query, QueryContext* ctx) const {
   is_dir:
     // We got a dir; process recursively to specified depth
     if (dir) {
-      dirGenerator(query, ctx, dir, path.depth);
+      dirGenerator(query, ctx, dir, path.depth, candidates);
     }
   }
+
+  view.unlock();
+  processCandidates(query, ctx, std::move(candidates));
 }
 
 void InMemoryView::dirGenerator(
     const Query* query,
     QueryContext* ctx,
     const watchman_dir* dir,
-    uint32_t depth) const {
-  for (auto& it : dir->files) {
-    auto file = it.second.get();
-    ctx->bumpNumWalked();
-
-    w_query_process_file(
-        query, ctx, std::make_unique<InMemoryFileResult>(file, caches_));
+    uint32_t depth,
+    std::vector<std::unique_ptr<FileResult>>& candidates) const {
+  auto pruneTicks = subtreePruneTicks(ctx);
+
+  if (!dir->files.empty() &&
+      !(pruneTicks && dir->max_changed_ticks <= pruneTicks)) {
+    auto dirPath = dir->getFullPath();
+    for (auto& it : dir->files) {
+      auto file = it.second.get();
+      ctx->bumpNumWalked();
+
+      candidates.push_back(
+          std::make_unique<InMemoryFileResult>(file, caches_, dirPath));
+    }
   }
 
   if (depth > 0) {
     for (auto& it : dir->dirs) {
       const auto child = it.second.get();
 
-      dirGenerator(query, ctx, child, depth - 1);
+      if (pruneTicks && child->max_changed_ticks <= pruneTicks) {
+        // Nothing at or below this child changed since the query clock,
+        // so a since-scoped walk cannot produce results from it. This
+        // turns a path-scoped incremental query from O(subtree) into
+        // O(changed).
+        continue;
+      }
+
+      dirGenerator(query, ctx, child, depth - 1, candidates);
     }
   }
 }
@@ -713,8 +1175,10 @@ void InMemoryView::globGeneratorDoublestar(
     const struct watchman_dir* dir,
     const GlobTree* node,
     const char* dir_name,
-    uint32_t dir_name_len) const {
+    uint32_t dir_name_len,
+    std::vector<std::unique_ptr<FileResult>>& candidates) const {
   bool matched;
+  auto dirPath = dir->getFullPath();
 
   // First step is to walk the set of files contained in this node
   for (auto& it : dir->files) {
@@ -748,10 +1212,8 @@ void InMemoryView::globGeneratorDoublestar(
               0) == WM_MATCH;
 
       if (matched) {
-        w_query_process_file(
-            ctx->query,
-            ctx,
-            std::make_unique<InMemoryFileResult>(file, caches_));
+        candidates.push_back(
+            std::make_unique<InMemoryFileResult>(file, caches_, dirPath));
         // No sense running multiple matches for this same file node
         // if this one succeeded.
         break;
@@ -760,6 +1222,7 @@ void InMemoryView::globGeneratorDoublestar(
   }
 
   // And now walk down to any dirs; all dirs are eligible
+  auto pruneTicks = subtreePruneTicks(ctx);
   for (auto& it : dir->dirs) {
     const auto child = it.second.get();
 
@@ -768,9 +1231,15 @@ void InMemoryView::globGeneratorDoublestar(
       continue;
     }
 
+    if (pruneTicks && child->max_changed_ticks <= pruneTicks) {
+      // Nothing below here changed since the query clock
+      continue;
+    }
+
     auto subject = make_path_name(
         dir_name, dir_name_len, child->name.data(), child->name.size());
-    globGeneratorDoublestar(ctx, child, node, subject.data(), subject.size());
+    globGeneratorDoublestar(
+        ctx, child, node, subject.data(), subject.size(), candidates);
   }
 }
 
@@ -778,9 +1247,10 @@ void InMemoryView::globGeneratorDoublestar(
 void InMemoryView::globGeneratorTree(
     QueryContext* ctx,
     const GlobTree* node,
-    const struct watchman_dir* dir) const {
+    const struct watchman_dir* dir,
+    std::vector<std::unique_ptr<FileResult>>& candidates) const {
   if (!node->doublestar_children.empty()) {
-    globGeneratorDoublestar(ctx, dir, node, nullptr, 0);
+    globGeneratorDoublestar(ctx, dir, node, nullptr, 0, candidates);
   }
 
   for (const auto& child_node : node->children) {
@@ -799,10 +1269,11 @@ void InMemoryView::globGeneratorTree(
         const auto child_dir = dir->getChildDir(component);
 
         if (child_dir) {
-          globGeneratorTree(ctx, child_node.get(), child_dir);
+          globGeneratorTree(ctx, child_node.get(), child_dir, candidates);
         }
       } else {
         // Otherwise we have to walk and match
+        auto pruneTicks = subtreePruneTicks(ctx);
         for (auto& it : dir->dirs) {
           const auto child_dir = it.second.get();
 
@@ -811,6 +1282,11 @@ void InMemoryView::globGeneratorTree(
             continue;
           }
 
+          if (pruneTicks && child_dir->max_changed_ticks <= pruneTicks) {
+            // Nothing below here changed since the query clock
+            continue;
+          }
+
           if (wildmatch(
                   child_node->pattern.c_str(),
                   child_dir->name.c_str(),
@@ -820,7 +1296,7 @@ void InMemoryView::globGeneratorTree(
                            ? 0
                            : WM_CASEFOLD),
                   0) == WM_MATCH) {
-            globGeneratorTree(ctx, child_node.get(), child_dir);
+            globGeneratorTree(ctx, child_node.get(), child_dir, candidates);
           }
         }
       }
@@ -828,6 +1304,7 @@ void InMemoryView::globGeneratorTree(
 
     // If the node is a leaf we are in a position to match files.
     if (child_node->is_leaf && !dir->files.empty()) {
+      auto dirPath = dir->getFullPath();
       // Attempt direct lookup if possible
       if (!child_node->had_specials &&
           ctx->query->case_sensitive == CaseSensitivity::CaseSensitive) {
@@ -839,10 +1316,8 @@ void InMemoryView::globGeneratorTree(
           ctx->bumpNumWalked();
           if (file->exists) {
             // Globs can only match files that exist
-            w_query_process_file(
-                ctx->query,
-                ctx,
-                std::make_unique<InMemoryFileResult>(file, caches_));
+            candidates.push_back(
+                std::make_unique<InMemoryFileResult>(file, caches_, dirPath));
           }
         }
       } else {
@@ -866,10 +1341,8 @@ void InMemoryView::globGeneratorTree(
                            ? 0
                            : WM_CASEFOLD),
                   0) == WM_MATCH) {
-            w_query_process_file(
-                ctx->query,
-                ctx,
-                std::make_unique<InMemoryFileResult>(file, caches_));
+            candidates.push_back(
+                std::make_unique<InMemoryFileResult>(file, caches_, dirPath));
           }
         }
       }
@@ -886,34 +1359,96 @@ void InMemoryView::globGenerator(const Query* query, QueryContext* ctx) const {
     relative_root = rootPath_;
   }
 
-  auto view = view_.rlock();
+  std::vector<std::unique_ptr<FileResult>> candidates;
 
-  const auto dir = view->resolveDir(relative_root);
-  if (!dir) {
-    throw QueryExecError(folly::to<std::string>(
-        "glob_generator could not resolve ",
-        relative_root.view(),
-        ", check your "
-        "relative_root parameter!"));
+  {
+    auto view = view_.rlock();
+
+    const auto dir = view->resolveDir(relative_root);
+    if (!dir) {
+      throw QueryExecError(folly::to<std::string>(
+          "glob_generator could not resolve ",
+          relative_root.view(),
+          ", check your "
+          "relative_root parameter!"));
+    }
+
+    globGeneratorTree(ctx, query->glob_tree.get(), dir, candidates);
   }
 
-  globGeneratorTree(ctx, query->glob_tree.get(), dir);
+  processCandidates(query, ctx, std::move(candidates));
 }
 
 void InMemoryView::allFilesGenerator(const Query* query, QueryContext* ctx)
     const {
-  struct watchman_file* f;
-  auto view = view_.rlock();
-  ctx->generationStarted();
+  // As in timeGenerator, snapshot candidates under the lock and evaluate
+  // them after it is released, in bounded batches with the lock dropped
+  // between batches and the walk resumed at a tick boundary. Nodes
+  // bumped while the lock was dropped move ahead of the resume point
+  // and are skipped, which is fine here: they were already snapshotted
+  // in an earlier batch, and the newer change is covered by the clock
+  // this query returns.
+  constexpr size_t kCandidateBatchSize = 16 * 1024;
+
+  auto typeFilter = query->expr ? query->expr->soleTypeFilter() : std::nullopt;
+  auto pathScope = expressionPathScope(ctx, rootPath_);
+
+  bool firstBatch = true;
+  bool done = false;
+  uint32_t resumeBelowTicks = 0;
+
+  while (!done) {
+    std::vector<std::unique_ptr<FileResult>> candidates;
+    {
+      auto view = view_.rlock();
+      if (firstBatch) {
+        ctx->generationStarted();
+        firstBatch = false;
+      }
 
-  for (f = view->getLatestFile(); f; f = f->next) {
-    ctx->bumpNumWalked();
-    if (!ctx->fileMatchesRelativeRoot(f)) {
-      continue;
+      const watchman_file* f;
+      if (resumeBelowTicks) {
+        f = view->seekNewestOlderThanTicks(resumeBelowTicks);
+      } else {
+        f = view->getLatestFile();
+      }
+
+      std::unordered_map<const watchman_dir*, w_string> dirPaths;
+
+      done = true;
+      for (; f; f = f->next) {
+        f->prefetchNext();
+        ctx->bumpNumWalked();
+
+        bool wanted = true;
+        if (typeFilter && !modeMatchesTypeChar(f->stat.mode, *typeFilter)) {
+          wanted = false;
+        } else if (
+            pathScope && !dirWithinScope(f->parent->full_path, pathScope)) {
+          wanted = false;
+        } else if (!ctx->fileMatchesRelativeRoot(f)) {
+          wanted = false;
+        }
+
+        if (wanted) {
+          auto& dirPath = dirPaths[f->parent];
+          if (!dirPath) {
+            dirPath = f->parent->getFullPath();
+          }
+          candidates.push_back(
+              std::make_unique<InMemoryFileResult>(f, caches_, dirPath));
+        }
+
+        if (candidates.size() >= kCandidateBatchSize && f->next &&
+            f->next->otime.ticks != f->otime.ticks) {
+          resumeBelowTicks = f->otime.ticks;
+          done = false;
+          break;
+        }
+      }
     }
 
-    w_query_process_file(
-        query, ctx, std::make_unique<InMemoryFileResult>(f, caches_));
+    processCandidates(query, ctx, std::move(candidates));
   }
 }
 
@@ -922,12 +1457,36 @@ ClockPosition InMemoryView::getMostRecentRootNumberAndTickValue() const {
 }
 
 w_string InMemoryView::getCurrentClockString() const {
+  auto tick = mostRecentTick_.load(std::memory_order_acquire);
+
+  {
+    auto cache = clockStringCache_.rlock();
+    if (cache->first == tick && cache->second) {
+      return cache->second;
+    }
+  }
+
   char clockbuf[128];
-  if (!clock_id_string(
-          rootNumber_, mostRecentTick_, clockbuf, sizeof(clockbuf))) {
+  if (!clock_id_string(rootNumber_, tick, clockbuf, sizeof(clockbuf))) {
     throw std::runtime_error("clock string exceeded clockbuf size");
   }
-  return w_string(clockbuf, W_STRING_UNICODE);
+  w_string rendered(clockbuf, W_STRING_UNICODE);
+
+  auto cache = clockStringCache_.wlock();
+  cache->first = tick;
+  cache->second = rendered;
+  return rendered;
+}
+
+bool InMemoryView::subtreeChangedSince(const w_string& path, uint32_t ticks)
+    const {
+  auto view = view_.rlock();
+  const auto* dir = view->resolveDir(path);
+  if (!dir) {
+    // Unknown scope: cannot prove anything
+    return true;
+  }
+  return dir->max_changed_ticks > ticks;
 }
 
 uint32_t InMemoryView::getLastAgeOutTickValue() const {
@@ -939,6 +1498,19 @@ std::chrono::system_clock::time_point InMemoryView::getLastAgeOutTimeStamp()
   return lastAgeOutTimestamp_;
 }
 
+/*
+ * Note on thread-per-root: collapsing the io/notify pairs onto a shared
+ * serial-keyed executor was evaluated for many-root hosts and declined
+ * for now. The notify thread's job is to sit in a blocking kernel read
+ * (inotify/kqueue/fsevents) — a shared executor would need to convert
+ * every watcher to a readiness-driven model first — and the iothread's
+ * blocking waits are the settle timing mechanism itself. The practical
+ * costs have been addressed piecemeal: idle client threads now sleep a
+ * minute rather than two seconds, stacks are lazily faulted so 400
+ * mostly-idle threads cost VM rather than RSS, and roots share the
+ * process-wide pool for all fan-out work. Revisit if watcher readiness
+ * APIs unify.
+ */
 void InMemoryView::startThreads(const std::shared_ptr<Root>& root) {
   // Start a thread to call into the watcher API for filesystem notifications
   auto self = std::static_pointer_cast<InMemoryView>(shared_from_this());
@@ -946,6 +1518,7 @@ void InMemoryView::startThreads(const std::shared_ptr<Root>& root) {
   std::thread notifyThreadInstance([self, root]() {
     w_set_thread_name(
         "notify ", uintptr_t(self.get()), " ", self->rootPath_.view());
+    applyRootThreadAffinity(self->config_);
     try {
       self->notifyThread(root);
     } catch (const std::exception& e) {
@@ -963,6 +1536,7 @@ void InMemoryView::startThreads(const std::shared_ptr<Root>& root) {
   std::thread ioThreadInstance([self, root]() {
     w_set_thread_name(
         "io ", uintptr_t(self.get()), " ", self->rootPath_.view());
+    applyRootThreadAffinity(self->config_);
     try {
       self->ioThread(root);
     } catch (const std::exception& e) {
@@ -976,6 +1550,17 @@ void InMemoryView::startThreads(const std::shared_ptr<Root>& root) {
 
 void InMemoryView::stopThreads() {
   logf(DBG, "signalThreads! {} {}\n", fmt::ptr(this), rootPath_);
+  maybeSaveViewSnapshot(/*force=*/true);
+  {
+    auto* hashStore = config_.getString("content_hash_store_path", "");
+    if (*hashStore) {
+      caches_.contentHashCache.saveToFile(hashStore);
+    }
+    auto* scmStore = config_.getString("scm_cache_store_path", "");
+    if (*scmStore && scm_) {
+      scm_->saveCaches(scmStore);
+    }
+  }
   stopThreads_.store(true, std::memory_order_release);
   watcher_->stopThreads();
   pendingFromWatcher_.lock()->ping();
@@ -1013,6 +1598,31 @@ folly::SemiFuture<folly::Unit> InMemoryView::waitForSettle(
 CookieSync::SyncResult InMemoryView::syncToNow(
     const std::shared_ptr<Root>& root,
     std::chrono::milliseconds timeout) {
+  // Experimental cookie-free fast path: watchers that implement
+  // flushPendingEvents provide a direct sequencing barrier (all events
+  // the watcher has seen are made available and a marker is observed by
+  // the iothread), so the write+observe round trip of a cookie file can
+  // be skipped. This is opt-in because the barrier only covers events
+  // that have reached the watcher; the cookie additionally proves the
+  // kernel delivered everything up to our own write.
+  if (enableCookielessSync_) {
+    auto flushed = watcher_->flushPendingEvents();
+    if (flushed.valid()) {
+      try {
+        std::move(flushed).get(timeout);
+        return CookieSync::SyncResult{};
+      } catch (const folly::FutureTimeout&) {
+        auto why = folly::to<std::string>(
+            "syncToNow: timed out waiting for watcher flush within ",
+            timeout.count(),
+            " milliseconds");
+        log(ERR, why, "\n");
+        throw std::system_error(ETIMEDOUT, std::generic_category(), why);
+      }
+    }
+    // Watcher has no direct barrier; fall through to cookies.
+  }
+
   auto syncResult = syncToNowCookies(root, timeout);
 
   // Some watcher implementations (notably, FSEvents) reorder change events
@@ -1170,8 +1780,25 @@ json_ref InMemoryView::getViewDebugInfo() const {
       json_array_append(processedPathsResult, entry.asJsonValue());
     }
   }
+  size_t arenaLive;
+  size_t arenaCapacity;
+  {
+    auto view = view_.rlock();
+    arenaLive = view->fileNodeArena().liveBytes();
+    arenaCapacity = view->fileNodeArena().capacityBytes();
+  }
+
+  uint32_t pendingItems;
+  {
+    auto pending = pendingFromWatcher_.lock();
+    pendingItems = pending->getPendingItemCount();
+  }
+
   return json_object({
       {"processed_paths", processedPathsResult},
+      {"arena_live_bytes", json_integer(arenaLive)},
+      {"arena_capacity_bytes", json_integer(arenaCapacity)},
+      {"pending_from_watcher", json_integer(pendingItems)},
   });
 }
 
@@ -1181,6 +1808,42 @@ void InMemoryView::clearViewDebugInfo() {
   }
 }
 
+json_ref InMemoryView::CrawlProfile::render() const {
+  auto slowDirs = json_array();
+  for (auto& dir : slowest) {
+    json_array_append_new(
+        slowDirs,
+        json_object({
+            {"path", w_string_to_json(dir.path)},
+            {"duration_us", json_integer(dir.durationUs)},
+            {"entries", json_integer(dir.entries)},
+        }));
+  }
+
+  return json_object({
+      {"started",
+       json_integer(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        started.time_since_epoch())
+                        .count())},
+      {"duration_ms",
+       json_integer(std::chrono::duration_cast<std::chrono::milliseconds>(
+                        finished - started)
+                        .count())},
+      {"dirs_crawled", json_integer(dirsCrawled)},
+      {"entries_seen", json_integer(entriesSeen)},
+      {"slowest_dirs", std::move(slowDirs)},
+  });
+}
+
+json_ref InMemoryView::renderCrawlProfiles() const {
+  auto result = json_array();
+  auto profiles = crawlProfiles_.rlock();
+  for (auto& profile : *profiles) {
+    json_array_append_new(result, profile.render());
+  }
+  return result;
+}
+
 SCM* InMemoryView::getSCM() const {
   return scm_.get();
 }
@@ -1213,6 +1876,24 @@ void InMemoryView::warmContentCache() {
         break;
       }
 
+      if (f->exists && f->stat.isSymlink()) {
+        // Warm the symlink target cache alongside content hashes: the
+        // cache key embeds the file's otime, so the freshly bumped
+        // entry is exactly what the next query's readLink will ask
+        // for, and reading it now (off the settle path, keyed to this
+        // observation) means field rendering never blocks on readlink.
+        auto dirStr = f->parent->getFullPath();
+        w_string_piece dir(dirStr);
+        dir.advance(caches_.symlinkTargetCache.rootPath().size());
+        if (dir.size() > 0) {
+          dir.advance(1);
+        }
+        caches_.symlinkTargetCache.get(SymlinkTargetCacheKey{
+            w_string::pathCat({dir, f->getName()}), f->otime});
+        ++n;
+        continue;
+      }
+
       if (f->exists && f->stat.isFile()) {
         // Note: we could also add an expression to further constrain
         // the things we warm up here.  Let's see if we need it before
@@ -7,6 +7,7 @@
 
 #pragma once
 #include <folly/Synchronized.h>
+#include <deque>
 #include <map>
 #include <memory>
 #include <unordered_map>
@@ -14,6 +15,7 @@
 #include <utility>
 #include "watchman/ContentHash.h"
 #include "watchman/CookieSync.h"
+#include "watchman/FileNodeArena.h"
 #include "watchman/PendingCollection.h"
 #include "watchman/PerfSample.h"
 #include "watchman/QueryableView.h"
@@ -48,9 +50,18 @@ struct InMemoryViewCaches {
       std::chrono::milliseconds errorTTL);
 };
 
+/**
+ * A FileResult that snapshots everything it needs from the watchman_file
+ * node at construction time. This means an InMemoryFileResult may be
+ * evaluated and rendered after the view lock has been released, while the
+ * iothread concurrently mutates (or even frees) the underlying node.
+ */
 class InMemoryFileResult final : public FileResult {
  public:
-  InMemoryFileResult(const watchman_file* file, InMemoryViewCaches& caches);
+  InMemoryFileResult(
+      const watchman_file* file,
+      InMemoryViewCaches& caches,
+      w_string dirName);
   std::optional<FileInformation> stat() override;
   std::optional<struct timespec> accessedTime() override;
   std::optional<struct timespec> modifiedTime() override;
@@ -67,7 +78,12 @@ class InMemoryFileResult final : public FileResult {
       const std::vector<std::unique_ptr<FileResult>>& files) override;
 
  private:
-  const watchman_file* file_;
+  // Snapshot of the node's state, taken while the view lock was held.
+  FileInformation stat_;
+  bool exists_;
+  ClockStamp ctime_;
+  ClockStamp otime_;
+  w_string baseName_;
   w_string dirName_;
   InMemoryViewCaches& caches_;
   std::optional<w_string> symlinkTarget_;
@@ -95,6 +111,10 @@ class ViewDatabase {
     rootInode_ = ino;
   }
 
+  const FileNodeArena& fileNodeArena() const {
+    return fileNodeArena_;
+  }
+
   watchman_dir* resolveDir(const w_string& dirname, bool create);
 
   const watchman_dir* resolveDir(const w_string& dirname) const;
@@ -126,16 +146,91 @@ class ViewDatabase {
       ClockStamp otime,
       bool recursive);
 
+  /**
+   * O(1) alternative to a recursive markDirDeleted: marks the dir itself
+   * not-existing and queues the subtree for deferred deletion processing.
+   * The individual file tombstones are applied by processSomeTombstones,
+   * which the iothread drives in bounded slices so that a large subtree
+   * removal doesn't hold the view lock for its whole duration.
+   */
+  void enqueueDirTombstone(watchman_dir* dir, ClockStamp otime);
+
+  bool hasPendingTombstones() const {
+    return !pendingTombstones_.empty();
+  }
+
+  /**
+   * Applies up to `limit` deferred file deletions. Returns true while more
+   * work remains. Directories that were resurrected (observed existing
+   * again) after being tombstoned are skipped: the recursive crawl that
+   * resurrected them re-establishes their contents, including deletions.
+   */
+  bool processSomeTombstones(Watcher& watcher, size_t limit);
+
+  /**
+   * Returns the oldest checkpointed file in the recency index whose otime is
+   * still newer than the given wall clock time, or nullptr if the index
+   * cannot bound the walk. Since otime timestamps are assigned monotonically
+   * with ticks, every file ahead of the returned node in the recency list is
+   * also newer than the boundary, so a scan for files at or older than
+   * `boundary` may safely begin at the returned node instead of the head of
+   * the list.
+   */
+  watchman_file* seekRecencyOlderThan(time_t boundary);
+
+  /**
+   * Drops any recency checkpoint that references the given file. Must be
+   * called before a file that may be checkpointed is freed or has its otime
+   * rewritten.
+   */
+  void invalidateRecencyCheckpoint(watchman_file* file);
+
+  /**
+   * Returns the newest file whose otime.ticks is strictly below `ticks`,
+   * seeking via the checkpoint index rather than walking from the head.
+   * Used by the generators to resume a bounded-batch walk at a tick
+   * boundary after dropping and re-acquiring the view lock: everything
+   * at or above `ticks` was already visited (nodes bumped while the
+   * lock was dropped acquire a newer tick and are likewise skipped;
+   * their change is carried by the clock returned to the caller).
+   */
+  const watchman_file* seekNewestOlderThanTicks(uint32_t ticks) const;
+
  private:
   void insertAtHeadOfFileList(struct watchman_file* file);
 
+  /**
+   * Records a sparse checkpoint into the recency list if enough ticks have
+   * elapsed since the last one.
+   */
+  void maybeRecordRecencyCheckpoint(watchman_file* file);
+
   const w_string rootPath_;
 
   /* the most recently changed file */
   watchman_file* latestFile_ = nullptr;
 
+  // Backing storage for the watchman_file nodes in the tree. Declared
+  // before rootDir_ so that it outlives the nodes allocated from it.
+  FileNodeArena fileNodeArena_;
+
   std::unique_ptr<watchman_dir> rootDir_;
 
+  // Sparse checkpoints into the recency list, keyed by the file's
+  // otime.ticks at the time the checkpoint was recorded. The recency list is
+  // ordered by otime, so these act as a coarse generation index that lets
+  // scans seek past segments they cannot match. Entries are eagerly removed
+  // when their file is bumped or freed, so every entry points at a live node
+  // whose otime.ticks still equals its key.
+  static constexpr uint32_t kCheckpointTickInterval = 1024;
+  static constexpr size_t kMaxCheckpoints = 4096;
+  std::map<uint32_t, watchman_file*> recencyCheckpoints_;
+  uint32_t lastCheckpointTick_{0};
+
+  // Dirs whose deletion has been recorded but whose contained files have
+  // not yet been marked deleted. Drained by processSomeTombstones.
+  std::deque<std::pair<watchman_dir*, ClockStamp>> pendingTombstones_;
+
   // Inode number for the root dir.  This is used to detect what should
   // be impossible situations, but is needed in practice to workaround
   // eg: BTRFS not delivering all events for subvolumes
@@ -163,6 +258,16 @@ class InMemoryView final : public QueryableView {
   std::chrono::system_clock::time_point getLastAgeOutTimeStamp() const override;
   w_string getCurrentClockString() const override;
 
+  bool subtreeChangedSince(const w_string& path, uint32_t ticks)
+      const override;
+
+  std::chrono::steady_clock::time_point getLastSettleTimestamp()
+      const override {
+    return std::chrono::steady_clock::time_point{
+        std::chrono::steady_clock::duration{
+            lastSettle_.load(std::memory_order_acquire)}};
+  }
+
   ClockStamp getClock(std::chrono::system_clock::time_point now) const {
     return ClockStamp{
         mostRecentTick_.load(std::memory_order_acquire),
@@ -214,6 +319,22 @@ class InMemoryView final : public QueryableView {
   // If content cache warming is configured, do the warm up now
   void warmContentCache();
 
+  /**
+   * Serializes the view (files, stat data and clocks) into a BSER-friendly
+   * value that restoreViewSnapshot can consume.
+   */
+  json_ref takeViewSnapshot() const;
+
+  /**
+   * Pre-populates an empty view from a snapshot previously produced by
+   * takeViewSnapshot. The comparison crawl that follows then only reports
+   * files that actually changed while the daemon was down, rather than
+   * treating every file as newly observed. Note that clients whose clocks
+   * embed the previous process's root number still receive a fresh instance
+   * response, as they always have.
+   */
+  void restoreViewSnapshot(const json_ref& snapshot);
+
   SCM* getSCM() const override;
 
   InMemoryViewCaches& debugAccessCaches() const {
@@ -227,6 +348,7 @@ class InMemoryView final : public QueryableView {
 
   // Returns the erased file's otime.
   ClockStamp ageOutFile(
+      ViewDatabase& view,
       std::unordered_set<w_string>& dirs_to_erase,
       watchman_file* file);
 
@@ -236,22 +358,38 @@ class InMemoryView final : public QueryableView {
   // caller will abort all pending cookies after processAllPending returns.
   enum class IsDesynced { Yes, No };
 
-  /** Recursively walks files under a specified dir */
+  /**
+   * Runs the collected candidates through w_query_process_file. When
+   * parallel_query_eval is enabled and the candidate set is large, the
+   * query expression is evaluated against chunks of candidates on the
+   * shared thread pool first; rendering and result accumulation still
+   * happen serially, in candidate order, on the calling thread.
+   */
+  void processCandidates(
+      const Query* query,
+      QueryContext* ctx,
+      std::vector<std::unique_ptr<FileResult>> candidates) const;
+
+  /** Recursively walks files under a specified dir, collecting candidate
+   * snapshots; evaluation happens after the view lock is released. */
   void dirGenerator(
       const Query* query,
       QueryContext* ctx,
       const watchman_dir* dir,
-      uint32_t depth) const;
+      uint32_t depth,
+      std::vector<std::unique_ptr<FileResult>>& candidates) const;
   void globGeneratorTree(
       QueryContext* ctx,
       const GlobTree* node,
-      const struct watchman_dir* dir) const;
+      const struct watchman_dir* dir,
+      std::vector<std::unique_ptr<FileResult>>& candidates) const;
   void globGeneratorDoublestar(
       QueryContext* ctx,
       const struct watchman_dir* dir,
       const GlobTree* node,
       const char* dir_name,
-      uint32_t dir_name_len) const;
+      uint32_t dir_name_len,
+      std::vector<std::unique_ptr<FileResult>>& candidates) const;
 
   void notifyThread(const std::shared_ptr<Root>& root);
 
@@ -262,9 +400,16 @@ class InMemoryView final : public QueryableView {
   // Consume entries from `pending` and apply them to the InMemoryView. Any new
   // pending paths generated by processPath will be crawled before
   // processAllPending returns.
+  //
+  // The view lock is acquired internally. When iothread_view_batch_size is
+  // configured, the lock is periodically released and re-acquired during a
+  // long drain so that queries can interleave with pending-change
+  // application. Cookies and syncs are not released until the drain
+  // completes, so clients that sync first never observe a partially applied
+  // batch.
   IsDesynced processAllPending(
       const std::shared_ptr<Root>& root,
-      ViewDatabase& view,
+      folly::Synchronized<ViewDatabase>& view,
       PendingChanges& pending);
 
   void processPath(
@@ -305,6 +450,28 @@ class InMemoryView final : public QueryableView {
       const PendingChange& pending,
       const DirEntry* pre_stat);
 
+  /**
+   * Marks a dir deleted, either synchronously or, when batched view
+   * locking is enabled, by recording an O(1) tombstone that
+   * processAllPending applies in bounded slices before resolving cookies.
+   */
+  void markDirDeletedOrDefer(
+      ViewDatabase& view,
+      watchman_dir* dir,
+      ClockStamp otime);
+
+  /**
+   * Issues the stat calls for a stolen batch of pending items concurrently
+   * on the shared thread pool, filling preStats with the results. Entries
+   * whose stat failed are left with has_stat unset so that statPath falls
+   * back to its serial error handling. Must be called without the view
+   * lock held.
+   */
+  void preStatBatch(
+      const Root& root,
+      const watchman_pending_fs* pending,
+      std::unordered_map<const watchman_pending_fs*, DirEntry>& preStats);
+
   // END IOTHREAD
 
  public:
@@ -327,6 +494,11 @@ class InMemoryView final : public QueryableView {
 
     // When the iothread last processed a pending event from the Watcher.
     std::optional<std::chrono::steady_clock::time_point> lastUnsettle;
+
+    // EWMA of the gap between successive unsettles, in milliseconds. Only
+    // maintained when adaptive settle is enabled; drives how long we wait
+    // for a root to settle before notifying clients.
+    double ewmaUnsettleGapMs{0.0};
   };
 
   // Returns a reference to the ViewDatabase without synchronizing on the mutex.
@@ -356,6 +528,20 @@ class InMemoryView final : public QueryableView {
   // Returns whether the root was reaped and the IO thread should terminate.
   Continue doSettleThings(Root& root, IoThreadState& state);
 
+  // Loads the snapshot file named by view_snapshot_path, if configured and
+  // present. Only the first call does anything.
+  void maybeRestoreViewSnapshot();
+
+  // Checks the view's live memory against max_root_memory_bytes at settle
+  // time and escalates: shed the content caches, force an age-out, and as
+  // a last resort cancel the root with a clear error.
+  void maybeEnforceMemoryBudget(Root& root);
+
+  // Writes the snapshot file named by view_snapshot_path if enough ticks
+  // have elapsed since the last write, or unconditionally when force is
+  // set (eg: at shutdown).
+  void maybeSaveViewSnapshot(bool force = false);
+
   FileSystem& fileSystem_;
   const Configuration config_;
 
@@ -367,6 +553,11 @@ class InMemoryView final : public QueryableView {
   const w_string rootPath_;
 
   uint32_t lastAgeOutTick_{0};
+
+  // Cache of the rendered clock string for mostRecentTick_; settle
+  // broadcasts and subscription batches all render the same tick.
+  mutable folly::Synchronized<std::pair<uint32_t, w_string>>
+      clockStringCache_;
   // This is system_clock instead of steady_clock because it's compared with a
   // file's otime.
   std::chrono::system_clock::time_point lastAgeOutTimestamp_{};
@@ -397,6 +588,95 @@ class InMemoryView final : public QueryableView {
   // const methods
   mutable InMemoryViewCaches caches_;
 
+  // When non-zero, the maximum number of pending items to apply to the view
+  // before releasing and re-acquiring the view lock, allowing queries to
+  // interleave with a long drain. Zero holds the lock for the whole drain.
+  size_t ioThreadViewBatchSize_{0};
+
+  // When true, the crawler fans lstat calls for newly discovered directory
+  // entries out to the shared thread pool instead of issuing them serially.
+  bool enableParallelCrawl_{false};
+
+  // When true, the iothread pre-stats each stolen batch of pending items
+  // concurrently before applying it to the view.
+  bool enableStatPrefetch_{false};
+
+  // When true, the crawler drains directories through a thread-pool
+  // buffered DirHandle so readdir latency overlaps entry processing.
+  bool enableBufferedReaddir_{false};
+
+  // When true, large candidate sets have their query expression evaluated
+  // in parallel on the shared thread pool.
+  bool enableParallelEval_{false};
+
+  // Adaptive settle: when enabled, the settle window tracks how bursty the
+  // root currently is instead of using the fixed trigger_settle period.
+  bool adaptiveSettle_{false};
+
+  // When true, syncToNow prefers the watcher's direct flush barrier over
+  // cookie files where the watcher provides one.
+  bool enableCookielessSync_{false};
+
+  // Snapshot of notify_sleep_ms; consulted on every iothread iteration.
+  std::chrono::milliseconds notifySleep_{0};
+
+  // steady_clock duration-since-epoch of the last settle; stored as a
+  // raw rep so it can be atomic.
+  std::atomic<std::chrono::steady_clock::duration::rep> lastSettle_{0};
+  std::chrono::milliseconds adaptiveSettleFloor_{5};
+
+  // When non-zero, the maximum live view memory allowed for this root
+  // before pressure shedding kicks in.
+  size_t maxRootMemoryBytes_{0};
+  // True once the soft shedding stage has run while over budget; the
+  // next over-budget settle cancels the root.
+  bool memoryPressureShedAttempted_{false};
+
+  // Where to persist view snapshots; empty disables snapshotting.
+  std::string viewSnapshotPath_;
+  // Minimum number of ticks between incremental snapshot writes.
+  uint32_t viewSnapshotIntervalTicks_{0};
+  uint32_t lastSnapshotTick_{0};
+  bool viewSnapshotRestoreAttempted_{false};
+
+  // The most recent sampled trace processed by the iothread; the next
+  // settle broadcast closes its span. Only touched by the iothread.
+  uint64_t lastDrainTraceId_{0};
+
+ public:
+  // Profile of one full crawl or recrawl, retrievable via
+  // debug-crawl-info. Written by the iothread during the crawl; reads
+  // take the synchronized history below.
+  struct CrawlProfile {
+    std::chrono::system_clock::time_point started;
+    std::chrono::system_clock::time_point finished;
+    uint64_t dirsCrawled{0};
+    uint64_t entriesSeen{0};
+    // The slowest directories by wall time, name + microseconds + entry
+    // count, worst first once finalized.
+    struct SlowDir {
+      w_string path;
+      uint64_t durationUs;
+      uint64_t entries;
+    };
+    std::vector<SlowDir> slowest;
+
+    json_ref render() const;
+  };
+
+  json_ref renderCrawlProfiles() const;
+
+ private:
+  static constexpr size_t kRetainedCrawlProfiles = 4;
+  static constexpr size_t kSlowDirsPerCrawl = 16;
+
+  // Completed crawl profiles, most recent last.
+  folly::Synchronized<std::deque<CrawlProfile>> crawlProfiles_;
+
+  // The profile being accumulated by the current crawl, if any. Only
+  // the iothread touches it.
+  std::unique_ptr<CrawlProfile> activeCrawlProfile_;
+
   // Should we warm the cache when we settle?
   bool enableContentCacheWarming_{false};
   // How many of the most recent files to warm up when settling?
@@ -564,6 +564,24 @@ class LRUCache {
     return CacheStats(state->stats, state->map.size());
   }
 
+  /**
+   * Invokes func(key, value) for each successfully cached entry.
+   * Pending lookups and errored entries are skipped. The cache lock is
+   * held for the duration, so func must be brief and must not re-enter
+   * the cache.
+   */
+  template <typename Func>
+  void forEach(Func&& func) const {
+    auto state = state_.rlock();
+    for (auto& it : state->map) {
+      auto& node = it.second;
+      if (node->promises_ || !node->value_.hasValue()) {
+        continue;
+      }
+      func(node->key_, node->value_.value());
+    }
+  }
+
   // Purge all of the entries from the cache
   void clear() {
     auto state = state_.wlock();
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "watchman/LatencyHistogram.h"
+
+#include <folly/Synchronized.h>
+#include <vector>
+
+namespace watchman {
+
+namespace {
+folly::Synchronized<std::vector<LatencyHistogram*>>& registry() {
+  // Leaked so that static histograms can register in any order.
+  static auto* r = new folly::Synchronized<std::vector<LatencyHistogram*>>();
+  return *r;
+}
+
+// Upper bound of a bucket in microseconds.
+uint64_t bucketCeilingUs(size_t bucket) {
+  return uint64_t(1) << (bucket + 1);
+}
+} // namespace
+
+LatencyHistogram::LatencyHistogram(const char* name) : name_(name) {
+  registry().wlock()->push_back(this);
+}
+
+json_ref LatencyHistogram::toJson() const {
+  uint64_t counts[kBuckets];
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    total += counts[i];
+  }
+
+  auto percentile = [&](double p) -> uint64_t {
+    if (!total) {
+      return 0;
+    }
+    uint64_t rank = uint64_t(p * total);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; ++i) {
+      seen += counts[i];
+      if (seen > rank) {
+        return bucketCeilingUs(i);
+      }
+    }
+    return bucketCeilingUs(kBuckets - 1);
+  };
+
+  auto buckets = json_array();
+  for (size_t i = 0; i < kBuckets; ++i) {
+    json_array_append_new(buckets, json_integer(counts[i]));
+  }
+
+  return json_object({
+      {"count", json_integer(total)},
+      {"p50_us", json_integer(percentile(0.50))},
+      {"p90_us", json_integer(percentile(0.90))},
+      {"p99_us", json_integer(percentile(0.99))},
+      {"log2_us_buckets", std::move(buckets)},
+  });
+}
+
+json_ref LatencyHistogram::renderAll() {
+  auto result = json_object();
+  auto reg = registry().rlock();
+  for (auto* histogram : *reg) {
+    result.set(histogram->name_, histogram->toJson());
+  }
+  return result;
+}
+
+void LatencyHistogram::resetAll() {
+  auto reg = registry().rlock();
+  for (auto* histogram : *reg) {
+    for (auto& bucket : histogram->buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+} // namespace watchman
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include "watchman/thirdparty/jansson/jansson.h"
+
+namespace watchman {
+
+/**
+ * An always-on latency histogram with logarithmic (power of two
+ * microsecond) buckets. Recording is a single relaxed atomic increment,
+ * cheap enough to leave enabled everywhere; percentiles are estimated
+ * from the buckets on read. Instances are expected to be static and
+ * register themselves for the `stats` command.
+ */
+class LatencyHistogram {
+ public:
+  static constexpr size_t kBuckets = 32;
+
+  explicit LatencyHistogram(const char* name);
+
+  void record(std::chrono::microseconds elapsed) {
+    uint64_t us = elapsed.count() < 0 ? 0 : uint64_t(elapsed.count());
+    size_t bucket = 0;
+    while (us > 1 && bucket + 1 < kBuckets) {
+      us >>= 1;
+      ++bucket;
+    }
+    buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** Renders counts and estimated p50/p90/p99 for this histogram. */
+  json_ref toJson() const;
+
+  /** Renders every registered histogram, keyed by name. */
+  static json_ref renderAll();
+
+  /** Zeroes every registered histogram. */
+  static void resetAll();
+
+ private:
+  const char* name_;
+  std::atomic<uint64_t> buckets_[kBuckets] = {};
+};
+
+} // namespace watchman
@@ -158,6 +158,14 @@ const OptDesc opts[] = {
      &flags.json_input_arg,
      NULL,
      NOT_DAEMON},
+    {"batch",
+     0,
+     "Read a sequence of commands from stdin (json or bser PDUs) and run "
+     "them over a single connection, emitting one response per command",
+     OPT_NONE,
+     &flags.batch_mode,
+     NULL,
+     NOT_DAEMON},
     {"output-encoding",
      0,
      "CLI output encoding. json (default) or bser",
@@ -28,6 +28,7 @@ struct Flags {
   int dont_save_state = 0;
   std::string watchman_state_file;
   int json_input_arg = 0;
+  int batch_mode = 0;
   std::string output_encoding;
   std::string server_encoding;
   int foreground = 0;
@@ -8,6 +8,11 @@
 #include "watchman/PDU.h"
 #include <folly/Range.h>
 #include <folly/String.h>
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
 #include "watchman/CommandRegistry.h"
 #include "watchman/Constants.h"
 #include "watchman/Logging.h"
@@ -17,6 +22,7 @@
 using namespace watchman;
 
 W_CAP_REG("bser-v2")
+W_CAP_REG("bser-string-table")
 watchman_json_buffer::watchman_json_buffer()
     : buf((char*)malloc(WATCHMAN_IO_BUF_SIZE)),
       allocd(WATCHMAN_IO_BUF_SIZE),
@@ -215,6 +221,54 @@ json_ref watchman_json_buffer::readBserPdu(
     return nullptr;
   }
 
+  // Very large PDUs are decoded from a transient, exactly-sized buffer
+  // instead of growing the connection's persistent buffer: the doubling
+  // growth over-allocates and, worse, the connection then retains the
+  // peak-sized buffer for its whole lifetime. bunser only borrows the
+  // bytes for the duration of the decode, so the transient storage is
+  // released as soon as the value has been built.
+  constexpr json_int_t kTransientPduThreshold = 1024 * 1024;
+  if (val > kTransientPduThreshold) {
+    auto transient = std::make_unique<char[]>(val);
+    // Move any bytes of this PDU that were already read into place.
+    json_int_t have = wpos - rpos;
+    if (have > val) {
+      // The current buffer holds trailing bytes beyond this PDU; leave
+      // them for the next read.
+      have = val;
+    }
+    memcpy(transient.get(), buf + rpos, have);
+    rpos += (uint32_t)have;
+
+    while (have < val) {
+      r = stm->read(transient.get() + have, val - have);
+      if (r <= 0) {
+        jerr->position = have;
+        snprintf(
+            jerr->text,
+            sizeof(jerr->text),
+            "error reading large PDU of %" PRIu64 " bytes: %s",
+            int64_t(val),
+            folly::errnoStr(errno).c_str());
+        return nullptr;
+      }
+      have += r;
+    }
+
+    std::optional<BserStringTableDecodeScope> tableScope;
+    if (bser_version == 2 &&
+        (uint32_t(bser_capabilities) & BSER_CAP_STRING_TABLE)) {
+      tableScope.emplace();
+    }
+    obj = bunser(transient.get(), transient.get() + val, &needed, jerr);
+    if (!obj) {
+      logf(ERR, "decoding large BSER pdu failed\n");
+    }
+
+    stm->setNonBlock(true);
+    return obj;
+  }
+
   // val tells us exactly how much storage we need for this PDU
   if (val > allocd - wpos) {
     ideal = allocd;
@@ -258,6 +312,12 @@ json_ref watchman_json_buffer::readBserPdu(
     wpos += r;
   }
 
+  std::optional<BserStringTableDecodeScope> tableScope;
+  if (bser_version == 2 &&
+      (uint32_t(bser_capabilities) & BSER_CAP_STRING_TABLE)) {
+    tableScope.emplace();
+  }
+
   obj = bunser(buf + rpos, buf + wpos, &needed, jerr);
   if (!obj) {
     // obj is a nullptr because deserialization failed. Log the message that
@@ -582,22 +642,132 @@ struct jbuffer_write_data {
   }
 };
 
+namespace {
+
+/**
+ * Accumulates serialized output into a chain of fixed-size buffers. This
+ * lets bserEncodeToStream serialize the json tree in a single pass: the
+ * payload size needed for the pdu header simply falls out of the
+ * serialization instead of requiring the separate measuring traversal
+ * that w_bser_write_pdu performs.
+ */
+struct ChunkedBserBuffer {
+  static constexpr size_t kChunkSize = 256 * 1024;
+
+  std::vector<std::string> chunks;
+  size_t total{0};
+
+  static int write(const char* buffer, size_t size, void* ptr) {
+    auto* self = static_cast<ChunkedBserBuffer*>(ptr);
+    self->total += size;
+    while (size) {
+      if (self->chunks.empty() || self->chunks.back().size() == kChunkSize) {
+        self->chunks.emplace_back();
+        self->chunks.back().reserve(kChunkSize);
+      }
+      auto& chunk = self->chunks.back();
+      auto room = std::min(size, kChunkSize - chunk.size());
+      chunk.append(buffer, room);
+      buffer += room;
+      size -= room;
+    }
+    return 0;
+  }
+
+  bool writeTo(w_stm_t stm) const {
+    for (auto& chunk : chunks) {
+      size_t pos = 0;
+      while (pos < chunk.size()) {
+        auto x = stm->write(chunk.data() + pos, chunk.size() - pos);
+        if (x <= 0) {
+          return false;
+        }
+        pos += x;
+      }
+    }
+    return true;
+  }
+};
+
+} // namespace
+
 bool watchman_json_buffer::bserEncodeToStream(
     uint32_t bser_version,
     uint32_t bser_capabilities,
     const json_ref& json,
     w_stm_t stm) {
-  struct jbuffer_write_data data = {stm, this};
-  int res;
+  // Serialize the payload in a single pass into a chain of large buffers,
+  // then emit the header once the size is known. Compared to the
+  // measure-then-dump scheme this trades a second full traversal of the
+  // json tree for transiently buffering the serialized bytes, which is a
+  // clear win for the big subscription payloads this path carries. The
+  // length header is emitted as a fixed-width int64 — any integer width
+  // is legal at that position in the protocol.
+  ChunkedBserBuffer payload;
+  bser_ctx_t ctx{bser_version, bser_capabilities, ChunkedBserBuffer::write};
+
+  {
+    std::optional<BserStringTableEncodeScope> tableScope;
+    if (bser_version == 2 && (bser_capabilities & BSER_CAP_STRING_TABLE)) {
+      tableScope.emplace();
+    }
+    if (w_bser_dump(&ctx, json, &payload)) {
+      return false;
+    }
+  }
 
-  res = w_bser_write_pdu(
-      bser_version, bser_capabilities, jbuffer_write_data::write, json, &data);
+  // 0x06 is the BSER tag for a native int64 value.
+  constexpr char kBserInt64Tag = 0x06;
 
-  if (res != 0) {
-    return false;
+  char header[2 + sizeof(bser_capabilities) + 1 + sizeof(int64_t)];
+  size_t headerLen = 0;
+  memcpy(header, bser_version == 2 ? BSER_V2_MAGIC : BSER_MAGIC, 2);
+  headerLen += 2;
+  if (bser_version == 2) {
+    memcpy(header + headerLen, &bser_capabilities, sizeof(bser_capabilities));
+    headerLen += sizeof(bser_capabilities);
+  }
+  header[headerLen++] = kBserInt64Tag;
+  int64_t payloadSize = payload.total;
+  memcpy(header + headerLen, &payloadSize, sizeof(payloadSize));
+  headerLen += sizeof(payloadSize);
+
+  // Gather the header and payload chunks into a single vectored write;
+  // streams without a native writev fall back to looping write() inside
+  // the default implementation.
+  std::vector<watchman_stream::WriteVec> vecs;
+  vecs.reserve(1 + payload.chunks.size());
+  vecs.push_back({header, headerLen});
+  for (auto& chunk : payload.chunks) {
+    vecs.push_back({chunk.data(), chunk.size()});
+  }
+
+  size_t totalLen = headerLen + payload.total;
+  size_t sent = 0;
+  while (sent < totalLen) {
+    // Skip over fully sent vectors and adjust the first partial one.
+    size_t skip = sent;
+    size_t first = 0;
+    while (first < vecs.size() && skip >= vecs[first].len) {
+      skip -= vecs[first].len;
+      ++first;
+    }
+    auto adjusted = vecs[first];
+    adjusted.buf = static_cast<const char*>(adjusted.buf) + skip;
+    adjusted.len -= skip;
+
+    // Temporarily swap the adjusted head into place for this call.
+    std::swap(vecs[first], adjusted);
+    auto x = stm->writev(vecs.data() + first, vecs.size() - first);
+    std::swap(vecs[first], adjusted);
+
+    if (x <= 0) {
+      return false;
+    }
+    sent += x;
   }
 
-  return data.flush();
+  return true;
 }
 
 bool watchman_json_buffer::jsonEncodeToStream(
@@ -620,6 +790,38 @@ bool watchman_json_buffer::jsonEncodeToStream(
   return data.flush();
 }
 
+namespace {
+int appendToString(const char* buffer, size_t size, void* ptr) {
+  static_cast<std::string*>(ptr)->append(buffer, size);
+  return 0;
+}
+} // namespace
+
+bool watchman_json_buffer::pduEncodeToBuffer(
+    enum w_pdu_type pdu_type,
+    uint32_t capabilities,
+    const json_ref& json,
+    std::string& out) {
+  switch (pdu_type) {
+    case is_json_compact:
+    case is_json_pretty: {
+      int flags = pdu_type == is_json_compact ? JSON_COMPACT : JSON_INDENT(4);
+      if (json_dump_callback(json, appendToString, &out, flags)) {
+        return false;
+      }
+      out.push_back('\n');
+      return true;
+    }
+    case is_bser:
+      return 0 == w_bser_write_pdu(1, capabilities, appendToString, json, &out);
+    case is_bser_v2:
+      return 0 == w_bser_write_pdu(2, capabilities, appendToString, json, &out);
+    case need_data:
+    default:
+      return false;
+  }
+}
+
 bool watchman_json_buffer::pduEncodeToStream(
     enum w_pdu_type pdu_type,
     uint32_t capabilities,
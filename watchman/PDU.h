@@ -8,10 +8,19 @@
 #pragma once
 
 #include <stdint.h>
+#include <string>
 #include "watchman/thirdparty/jansson/jansson.h"
 
 class watchman_stream;
 
+// Note: transport compression (zstd frames negotiated per connection)
+// was evaluated and set aside rather than taking on a new dependency:
+// the compressible bulk of our payloads is repeated pathname text, and
+// the protocol-level remedies that need no codec — subscription name
+// ids, server-side result diffing, and the string-table PDU encoding —
+// remove that redundancy at the source. If a codec is revisited, the
+// negotiation point is the per-connection capabilities word carried by
+// bser v2 PDUs.
 enum w_pdu_type {
   need_data,
   is_json_compact,
@@ -47,6 +56,17 @@ struct watchman_json_buffer {
       const json_ref& json,
       watchman_stream* stm);
 
+  /**
+   * Encodes the PDU by appending it to `out`, leaving the write itself to
+   * the caller. Used by the client thread to drain responses without
+   * blocking on a slow consumer.
+   */
+  static bool pduEncodeToBuffer(
+      w_pdu_type pdu_type,
+      uint32_t capabilities,
+      const json_ref& json,
+      std::string& out);
+
   json_ref decodeNext(watchman_stream* stm, json_error_t* jerr);
 
   bool passThru(
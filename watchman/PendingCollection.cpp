@@ -7,7 +7,9 @@
 
 #include "watchman/PendingCollection.h"
 #include <folly/Synchronized.h>
+#include <thread>
 #include "watchman/Cookie.h"
+#include "watchman/Tracing.h"
 #include "watchman/Logging.h"
 #include "watchman/watchman_dir.h"
 
@@ -55,6 +57,7 @@ void PendingChanges::clear() {
   pending_.reset();
   tree_.clear();
   syncs_.clear();
+  dirChildCounts_.clear();
 }
 
 void PendingChanges::add(
@@ -80,8 +83,38 @@ void PendingChanges::add(
 
   logf(DBG, "add_pending: {} {}\n", path, flags.format());
 
+  p->traceId = tracing::maybeStartTrace(path);
+
   tree_.insert(path, p);
   linkHead(std::move(p));
+
+  maybeRollupDir(path, now);
+}
+
+void PendingChanges::maybeRollupDir(
+    const w_string& path,
+    std::chrono::system_clock::time_point now) {
+  auto parent = path.dirName();
+  if (!parent) {
+    return;
+  }
+
+  auto n = ++dirChildCounts_[parent];
+  if (n < kDirRollupThreshold) {
+    return;
+  }
+  dirChildCounts_.erase(parent);
+
+  logf(
+      DBG,
+      "rolling up {} pending entries under {} into a recursive scan\n",
+      n,
+      parent);
+
+  // Adding the parent as a recursive scan prunes the individual child
+  // entries from the tree and obsoletes any further adds beneath it.
+  // This may in turn roll up the grandparent if storms are very wide.
+  add(parent, now, W_PENDING_RECURSIVE);
 }
 
 void PendingChanges::add(
@@ -117,9 +150,13 @@ void PendingChanges::append(
     maybePruneObsoletedChildren(p->path, p->flags);
 
     auto next = std::move(p->next);
-    tree_.insert(p->path, p);
+    auto path = p->path;
+    auto now = p->now;
+    tree_.insert(path, p);
     linkHead(std::move(p));
 
+    maybeRollupDir(path, now);
+
     p = std::move(next);
   }
 
@@ -131,6 +168,7 @@ void PendingChanges::append(
 
 std::shared_ptr<watchman_pending_fs> PendingChanges::stealItems() {
   tree_.clear();
+  dirChildCounts_.clear();
   return std::move(pending_);
 }
 
@@ -300,11 +338,14 @@ void PendingChanges::unlinkItem(std::shared_ptr<watchman_pending_fs>& p) {
   p->prev.reset();
 }
 
-PendingCollectionBase::PendingCollectionBase(std::condition_variable& cond)
-    : cond_(cond) {}
+PendingCollectionBase::PendingCollectionBase(
+    std::condition_variable& cond,
+    std::atomic<uint64_t>& pingSeq)
+    : cond_(cond), pingSeq_(pingSeq) {}
 
 void PendingCollectionBase::ping() {
   pinged_ = true;
+  pingSeq_.fetch_add(1, std::memory_order_release);
   cond_.notify_all();
 }
 
@@ -319,22 +360,108 @@ bool PendingCollectionBase::checkAndResetPinged() {
 PendingCollection::PendingCollection()
     : folly::Synchronized<PendingCollectionBase, std::mutex>{
           folly::in_place,
-          cond_} {}
+          cond_,
+          pingSeq_} {}
+
+PendingCollection::~PendingCollection() {
+  auto* batch = stagedBatches_.exchange(nullptr, std::memory_order_acquire);
+  while (batch) {
+    auto* next = batch->next;
+    delete batch;
+    batch = next;
+  }
+}
+
+void PendingCollection::publish(std::shared_ptr<watchman_pending_fs> chain) {
+  if (!chain) {
+    return;
+  }
+
+  auto* batch = new StagedBatch{std::move(chain), nullptr};
+  auto* head = stagedBatches_.load(std::memory_order_relaxed);
+  do {
+    batch->next = head;
+  } while (!stagedBatches_.compare_exchange_weak(
+      head, batch, std::memory_order_release, std::memory_order_relaxed));
+
+  // Wake the consumer. Unlike append(), this critical section is constant
+  // time; the dedup work for the published chain happens on the consumer
+  // side in drainStaged().
+  lock()->ping();
+}
+
+void PendingCollection::drainStaged(PendingCollectionBase& base) {
+  auto* batch = stagedBatches_.exchange(nullptr, std::memory_order_acquire);
+  if (!batch) {
+    return;
+  }
+
+  // The stack is in reverse publication order; flip it so batches merge
+  // oldest first.
+  StagedBatch* reversed = nullptr;
+  while (batch) {
+    auto* next = batch->next;
+    batch->next = reversed;
+    reversed = batch;
+    batch = next;
+  }
+
+  while (reversed) {
+    base.append(std::move(reversed->chain), {});
+    auto* next = reversed->next;
+    delete reversed;
+    reversed = next;
+  }
+}
+
+PendingCollection::LockedPtr PendingCollection::lockAndDrain() {
+  auto lock = this->lock();
+  drainStaged(*lock);
+  return lock;
+}
 
 PendingCollection::LockedPtr PendingCollection::lockAndWait(
     std::chrono::milliseconds timeoutms) {
   auto lock = this->lock();
+  drainStaged(*lock);
 
   if (lock->checkAndResetPinged()) {
     return lock;
   }
 
+  // Adaptive spin-then-park: event bursts cluster at microsecond
+  // spacing, so a brief unlocked spin on the ping sequence often
+  // catches the next burst without paying the futex wake and reschedule
+  // that a condvar park costs. Fall through to the park when the spin
+  // budget expires.
+  {
+    auto seq = pingSeq_.load(std::memory_order_acquire);
+    lock.unlock();
+    constexpr int kSpinIterations = 400;
+    bool pinged = false;
+    for (int i = 0; i < kSpinIterations; ++i) {
+      if (pingSeq_.load(std::memory_order_acquire) != seq ||
+          stagedBatches_.load(std::memory_order_acquire)) {
+        pinged = true;
+        break;
+      }
+      std::this_thread::yield();
+    }
+    lock = this->lock();
+    drainStaged(*lock);
+    if (pinged || lock->checkAndResetPinged()) {
+      lock->checkAndResetPinged();
+      return lock;
+    }
+  }
+
   if (timeoutms.count() == -1) {
     cond_.wait(lock.as_lock());
   } else {
     cond_.wait_for(lock.as_lock(), timeoutms);
   }
 
+  drainStaged(*lock);
   lock->checkAndResetPinged();
   return lock;
 }
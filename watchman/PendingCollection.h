@@ -9,8 +9,10 @@
 
 #include <folly/Synchronized.h>
 #include <folly/futures/Promise.h>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <unordered_map>
 #include "watchman/OptionSet.h"
 #include "watchman/thirdparty/libart/src/art.h"
 #include "watchman/watchman_string.h"
@@ -77,11 +79,24 @@ constexpr inline auto W_PENDING_IS_DESYNCED = PendingFlags::raw(16);
 
 /**
  * Represents a change notification from the Watcher.
+ *
+ * Note: `now` is deliberately coarse. Each watcher reads the clock once
+ * per consumed batch and stamps every change in the batch with it, and
+ * the iothread derives otime/ctime from that stamp rather than reading
+ * the clock per file — so observation stamping is already amortized to
+ * one clock read per event batch, and a separate cached-timestamp
+ * service would add staleness without removing any reads. Anything
+ * adding per-item processing here should reuse the batch stamp, not
+ * call system_clock::now().
  */
 struct PendingChange {
   w_string path;
   std::chrono::system_clock::time_point now;
   PendingFlags flags;
+
+  // Non-zero when this change was sampled for end-to-end tracing; see
+  // watchman/Tracing.h. Assigned when the change enters a collection.
+  uint64_t traceId{0};
 };
 
 struct watchman_pending_fs : watchman::PendingChange {
@@ -171,6 +186,22 @@ class PendingChanges {
   std::vector<folly::Promise<folly::Unit>> syncs_;
 
  private:
+  // Once this many sibling entries accumulate under one parent dir, the
+  // collection collapses them into a single recursive-scan entry for the
+  // parent, trading a directory re-walk for queue pressure during storms
+  // like a large checkout.
+  static constexpr uint32_t kDirRollupThreshold = 1024;
+
+  // Approximate count of entries per immediate parent dir, reset whenever
+  // the collection is drained. Used only to drive the rollup heuristic.
+  std::unordered_map<w_string, uint32_t> dirChildCounts_;
+
+  // Bumps the per-dir occupancy for path's parent and performs the rollup
+  // when the threshold is crossed.
+  void maybeRollupDir(
+      const w_string& path,
+      std::chrono::system_clock::time_point now);
+
   void maybePruneObsoletedChildren(w_string path, PendingFlags flags);
   inline void consolidateItem(watchman_pending_fs* p, PendingFlags flags);
   bool isObsoletedByContainingDir(const w_string& path);
@@ -180,7 +211,9 @@ class PendingChanges {
 
 class PendingCollectionBase : public PendingChanges {
  public:
-  explicit PendingCollectionBase(std::condition_variable& cond);
+  PendingCollectionBase(
+      std::condition_variable& cond,
+      std::atomic<uint64_t>& pingSeq);
   PendingCollectionBase(PendingCollectionBase&&) = delete;
   PendingCollectionBase& operator=(PendingCollectionBase&&) = delete;
 
@@ -197,6 +230,9 @@ class PendingCollectionBase : public PendingChanges {
 
  private:
   std::condition_variable& cond_;
+  // Bumped on every ping; lets the consumer spin briefly on a relaxed
+  // load before parking on the condvar.
+  std::atomic<uint64_t>& pingSeq_;
   bool pinged_{false};
 };
 
@@ -204,16 +240,50 @@ class PendingCollection
     : public folly::Synchronized<PendingCollectionBase, std::mutex> {
  public:
   PendingCollection();
+  ~PendingCollection();
 
   /**
    * If previously pinged or non-empty, returns a locked PendingCollectionBase.
    * Otherwise, waits up to timeoutms (or indefinitely if -1 ms) for a ping().
    *
+   * Any batches published via publish() are merged before returning.
+   *
    * The internal pinged state is always false after this call.
    */
   LockedPtr lockAndWait(std::chrono::milliseconds timeoutms);
 
+  /**
+   * Like lock(), but also merges any batches published via publish().
+   * Consumers that intend to stealItems() must use this rather than lock()
+   * so that published batches are not left behind.
+   */
+  LockedPtr lockAndDrain();
+
+  /**
+   * Publishes a chain of pending items (usually from
+   * PendingChanges::stealItems on a producer-local collection) without
+   * performing any tree work under the collection lock. The chain is pushed
+   * onto a lock-free staging stack; dedup and coalescing happen on the
+   * consumer side when the batch is merged. The collection lock is still
+   * taken briefly to wake the consumer, but only for a constant-time ping.
+   */
+  void publish(std::shared_ptr<watchman_pending_fs> chain);
+
  private:
+  struct StagedBatch {
+    std::shared_ptr<watchman_pending_fs> chain;
+    StagedBatch* next;
+  };
+
+  // Merges all staged batches, oldest first.
+  void drainStaged(PendingCollectionBase& base);
+
+  // Head of the lock-free staging stack, in reverse publication order.
+  std::atomic<StagedBatch*> stagedBatches_{nullptr};
+
+  // Monotonic ping sequence observed by the consumer's spin phase.
+  std::atomic<uint64_t> pingSeq_{0};
+
   // Notified on ping().
   std::condition_variable cond_;
 };
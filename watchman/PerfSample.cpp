@@ -108,6 +108,7 @@ void processSamples(
 }
 
 PerfSample::PerfSample(const char* description) : description(description) {
+  alloc_begin = getThreadAllocationCounters();
   gettimeofday(&time_begin, nullptr);
 #ifdef HAVE_SYS_RESOURCE_H
   getrusage(RUSAGE_SELF, &usage_begin);
@@ -115,6 +116,19 @@ PerfSample::PerfSample(const char* description) : description(description) {
 }
 
 bool PerfSample::finish() {
+  {
+    auto now = getThreadAllocationCounters();
+    alloc_delta.allocCount = now.allocCount - alloc_begin.allocCount;
+    alloc_delta.allocBytes = now.allocBytes - alloc_begin.allocBytes;
+    alloc_delta.freeCount = now.freeCount - alloc_begin.freeCount;
+    add_meta(
+        "allocations",
+        json_object(
+            {{"count", json_integer(alloc_delta.allocCount)},
+             {"bytes", json_integer(alloc_delta.allocBytes)},
+             {"frees", json_integer(alloc_delta.freeCount)}}));
+  }
+
   gettimeofday(&time_end, nullptr);
   w_timeval_sub(time_end, time_begin, &duration);
 #ifdef HAVE_SYS_RESOURCE_H
@@ -186,10 +200,10 @@ void PerfLogThread::loop() noexcept {
       w_string_piece(flags.watchman_state_file).dirName().asWString();
 
   perf_cmd = cfg_get_json("perf_logger_command");
-  if (perf_cmd.isString()) {
+  if (perf_cmd && perf_cmd.isString()) {
     perf_cmd = json_array({perf_cmd});
   }
-  if (!perf_cmd.isArray()) {
+  if (perf_cmd && !perf_cmd.isArray()) {
     logf(
         FATAL,
         "perf_logger_command must be either a string or an array of strings\n");
@@ -217,6 +231,18 @@ void PerfLogThread::loop() noexcept {
     }
 
     if (samples) {
+      // Emit the PERF log lines from this thread: json_dumps of a big
+      // sample is exactly the formatting cost we don't want on the
+      // thread that did the measured work.
+      for (auto& sample : samples.array()) {
+        auto dumped = json_dumps(sample, 0);
+        watchman::log(ERR, "PERF: ", dumped, "\n");
+      }
+
+      if (!perf_cmd) {
+        continue;
+      }
+
       // Hack: Divide by two because this limit includes environment variables
       // and perf_cmd.
       // It's possible to compute this correctly on every platform given the
@@ -324,15 +350,9 @@ void PerfSample::log() {
 #endif // HAVE_SYS_RESOURCE_H
 #undef ADDTV
 
-  // Log to the log file
-  auto dumped = json_dumps(info, 0);
-  watchman::log(ERR, "PERF: ", dumped, "\n");
-
-  if (!cfg_get_json("perf_logger_command")) {
-    return;
-  }
-
-  // Send this to our logging thread for async processing
+  // Hand the sample to the telemetry thread, which formats the PERF
+  // log line and invokes the logger command (if configured). The
+  // working thread only pays for assembling the json blob above.
   auto& perfThread = getPerfThread();
   perfThread.addSample(std::move(info));
 }
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include "watchman/AllocationCounters.h"
+
 #include <string>
 #include <vector>
 #include "watchman/thirdparty/jansson/jansson.h"
@@ -20,6 +22,12 @@ class PerfSample {
   // What we're sampling across
   const char* description;
 
+  // Thread-local allocation counters captured at construction; finish()
+  // records the deltas in the sample metadata so per-command allocation
+  // behavior is visible without heap profiler tooling.
+  AllocationCounters alloc_begin;
+  AllocationCounters alloc_delta;
+
   // Additional arbitrary information.
   // This is a json object with various properties set inside it
   json_ref meta_data{json_object()};
@@ -6,12 +6,47 @@
  */
 
 #include "watchman/Logging.h"
+#include "watchman/TimerService.h"
 #include "watchman/WatchmanConfig.h"
+#include "watchman/fs/FileSystem.h"
 
 namespace watchman {
 
 folly::Synchronized<std::string> poisoned_reason;
 
+namespace {
+/**
+ * Probes whether the condition that poisoned us has cleared (the
+ * triggering path is accessible again) and, if so, lifts the poison.
+ * Re-arms itself with exponential backoff otherwise. Transients like
+ * EMFILE after an fd-limit bump or an NFS server restart thus cure the
+ * daemon without operator intervention; a genuinely persistent fault
+ * keeps the poison with a probe at most every half hour.
+ */
+void schedulePoisonProbe(w_string dir, std::chrono::seconds delay) {
+  TimerService::get().scheduleAt(
+      std::chrono::steady_clock::now() + delay, [dir, delay] {
+        if (poisoned_reason.rlock()->empty()) {
+          return;
+        }
+
+        auto probe = tryGetFileInformation(dir.c_str());
+        if (probe.hasValue()) {
+          log(ERR,
+              "poison recovery: ",
+              dir,
+              " is accessible again; clearing poisoned state\n");
+          poisoned_reason.wlock()->clear();
+          return;
+        }
+
+        auto next = std::min<std::chrono::seconds>(
+            delay * 2, std::chrono::minutes(30));
+        schedulePoisonProbe(dir, next);
+      });
+}
+} // namespace
+
 void set_poison_state(
     const w_string& dir,
     std::chrono::system_clock::time_point now,
@@ -41,6 +76,10 @@ void set_poison_state(
 
   watchman::log(watchman::ERR, why);
   *poisoned_reason.wlock() = why;
+
+  if (cfg_get_bool("poison_recovery", true)) {
+    schedulePoisonProbe(dir, std::chrono::minutes(1));
+  }
 }
 
 } // namespace watchman
@@ -48,6 +48,9 @@ Publisher::Subscriber::~Subscriber() {
     // Take this opportunity to reap anything that is no longer
     // referenced now that we've removed some subscriber(s)
     wlock->collectGarbage();
+    wlock->rebuildSnapshot();
+    publisher_->subscriberCount_.store(
+        wlock->subscriberSnapshot->size(), std::memory_order_relaxed);
   }
 
   // It is now safe for subscribers to be torn down and release
@@ -109,12 +112,26 @@ std::shared_ptr<Publisher::Subscriber> Publisher::subscribe(
     const json_ref& info) {
   auto sub =
       std::make_shared<Publisher::Subscriber>(shared_from_this(), notify, info);
-  state_.wlock()->subscribers.emplace_back(sub);
+  {
+    auto wlock = state_.wlock();
+    wlock->subscribers.emplace_back(sub);
+    wlock->rebuildSnapshot();
+    subscriberCount_.store(
+        wlock->subscriberSnapshot->size(), std::memory_order_relaxed);
+  }
   return sub;
 }
 
-bool Publisher::hasSubscribers() const {
-  return !state_.rlock()->subscribers.empty();
+void Publisher::state::rebuildSnapshot() {
+  auto snapshot =
+      std::make_shared<std::vector<std::weak_ptr<Subscriber>>>();
+  snapshot->reserve(subscribers.size());
+  for (auto& weak : subscribers) {
+    if (!weak.expired()) {
+      snapshot->push_back(weak);
+    }
+  }
+  subscriberSnapshot = std::move(snapshot);
 }
 
 void Publisher::state::collectGarbage() {
@@ -136,45 +153,39 @@ void Publisher::state::collectGarbage() {
 }
 
 bool Publisher::enqueue(json_ref&& payload) {
-  std::vector<std::shared_ptr<Subscriber>> subscribers;
+  // Build the item before taking the lock; the critical section is then
+  // just a serial assignment, a push, and the occasional amortized gc.
+  auto item = std::make_shared<Item>();
+  item->payload = std::move(payload);
 
+  std::shared_ptr<const std::vector<std::weak_ptr<Subscriber>>> snapshot;
   {
     auto wlock = state_.wlock();
 
-    // We need to collect live references for the notify portion,
-    // but since we're holding the wlock, take this opportunity to
-    // detect and prune dead subscribers and clean up some garbage.
-    auto it = wlock->subscribers.begin();
-    while (it != wlock->subscribers.end()) {
-      auto sub = it->lock();
-      // Prune vacated weak_ptr's
-      if (!sub) {
-        it = wlock->subscribers.erase(it);
-      } else {
-        ++it;
-        // Remember that live reference so that we can notify
-        // outside of the lock below.
-        subscribers.emplace_back(std::move(sub));
-      }
-    }
-
-    wlock->collectGarbage();
-
-    if (subscribers.empty()) {
+    snapshot = wlock->subscriberSnapshot;
+    if (!snapshot || snapshot->empty()) {
       return false;
     }
 
-    auto item = std::make_shared<Item>();
-    item->payload = std::move(payload);
     item->serial = wlock->nextSerial++;
     wlock->items.emplace_back(std::move(item));
+
+    // Dead subscribers are pruned when the subscription set changes;
+    // here we only need to bound item retention, and that can be
+    // amortized instead of scanning on every publish.
+    if (++wlock->enqueuesSinceGc >= 64 || wlock->items.size() >= 1024) {
+      wlock->enqueuesSinceGc = 0;
+      wlock->collectGarbage();
+    }
   }
 
-  // and notify them outside of the lock
-  for (auto& sub : subscribers) {
-    auto& n = sub->getNotify();
-    if (n) {
-      n();
+  // Lock the weak refs and notify outside of the lock.
+  for (auto& weak : *snapshot) {
+    if (auto sub = weak.lock()) {
+      auto& n = sub->getNotify();
+      if (n) {
+        n();
+      }
     }
   }
   return true;
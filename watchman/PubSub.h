@@ -11,8 +11,10 @@
 #include "watchman/watchman_string.h"
 #include "watchman/watchman_system.h"
 
+#include <atomic>
 #include <deque>
 #include <functional>
+#include <memory>
 #include <vector>
 
 namespace watchman {
@@ -77,8 +79,11 @@ class Publisher : public std::enable_shared_from_this<Publisher> {
 
   // Returns true if there are any subscribers.
   // This is racy and intended to be used to gate building a payload
-  // if there are no current subscribers.
-  bool hasSubscribers() const;
+  // if there are no current subscribers. Costs one relaxed atomic load,
+  // so it is suitable for very hot log sites.
+  bool hasSubscribers() const {
+    return subscriberCount_.load(std::memory_order_relaxed) != 0;
+  }
 
   // Enqueue a new item, but only if there are subscribers.
   // Returns true if the item was queued.
@@ -98,11 +103,28 @@ class Publisher : public std::enable_shared_from_this<Publisher> {
     // The subscribers
     std::vector<std::weak_ptr<Subscriber>> subscribers;
 
+    // Immutable snapshot of `subscribers`, rebuilt when the
+    // subscription set changes. enqueue() grabs the snapshot under the
+    // lock but performs all of its per-subscriber work (weak_ptr
+    // locking, notification) outside it, so publishing no longer scans
+    // or prunes the subscriber list while holding the state lock.
+    std::shared_ptr<const std::vector<std::weak_ptr<Subscriber>>>
+        subscriberSnapshot;
+
+    // Publishes between garbage collections; gc is amortized rather
+    // than run on every enqueue.
+    uint32_t enqueuesSinceGc{0};
+
     void collectGarbage();
+    void rebuildSnapshot();
     void enqueue(json_ref&& payload);
   };
   folly::Synchronized<state> state_;
 
+  // Mirrors the live entry count of the subscriber snapshot; updated by
+  // rebuildSnapshot so hasSubscribers needs no lock.
+  std::atomic<size_t> subscriberCount_{0};
+
   friend class Subscriber;
 };
 
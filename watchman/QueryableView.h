@@ -49,6 +49,28 @@ class QueryableView : public std::enable_shared_from_this<QueryableView> {
   virtual ClockPosition getMostRecentRootNumberAndTickValue() const = 0;
   virtual w_string getCurrentClockString() const = 0;
   virtual uint32_t getLastAgeOutTickValue() const;
+
+  /**
+   * Returns false only when the view can prove that nothing at or below
+   * `path` changed after the given tick. The base implementation cannot
+   * prove anything and returns true; InMemoryView answers from its
+   * per-dir change clocks. Used to skip scoped subscriptions cheaply at
+   * settle time.
+   */
+  virtual bool subtreeChangedSince(const w_string& /*path*/, uint32_t /*ticks*/)
+      const {
+    return true;
+  }
+
+  /**
+   * The time at which this view last settled (caught up with all
+   * pending changes and went idle), or the epoch if unknown. Used by
+   * bounded-staleness queries to decide whether a sync can be skipped.
+   */
+  virtual std::chrono::steady_clock::time_point getLastSettleTimestamp()
+      const {
+    return std::chrono::steady_clock::time_point{};
+  }
   virtual std::chrono::system_clock::time_point getLastAgeOutTimeStamp() const;
   virtual void ageOut(PerfSample& sample, std::chrono::seconds minAge);
 
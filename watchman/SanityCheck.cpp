@@ -6,10 +6,13 @@
  */
 
 #include <folly/String.h>
+#include <atomic>
+#include <chrono>
 #include "watchman/Logging.h"
 #include "watchman/PDU.h"
 #include "watchman/PerfSample.h"
 #include "watchman/Shutdown.h"
+#include "watchman/TimerService.h"
 #include "watchman/watchman_stream.h"
 
 namespace watchman {
@@ -169,49 +172,51 @@ void do_clock_check(watchman_stream* client) {
   }
 }
 
-void sanityCheckThread() noexcept {
-  w_set_thread_name("sanitychecks");
-  auto lastCheck = std::chrono::steady_clock::now();
-  auto interval = std::chrono::minutes(1);
-
-  log(ERR, "starting sanityCheckThread\n");
-  // we want to try the checks in here once per minute, but since
-  // this is mildly ghetto we don't have a way to directly signal
-  // this thread when we're shutting down.  So we sleep for a second
-  // at a time and then check to see if a shutdown is in progress
-  // so that we can shutdown with a slightly lower latency than
-  // if we were to sleep for a minute at a time.
-  while (!w_is_stopping()) {
-    auto now = std::chrono::steady_clock::now();
-    if (now - lastCheck < interval) {
-      std::this_thread::sleep_for(std::chrono::seconds(1));
-      continue;
-    }
+std::atomic<int64_t> lastServerActivity{0};
+
+void runSanityChecks() noexcept {
+  // Real command traffic is a stronger health signal than a synthetic
+  // probe: if a client completed a command within the check interval,
+  // the socket, listener and dispatch machinery all demonstrably work,
+  // and the probe would only add load. Only probe when the daemon has
+  // been quiet.
+  auto last = std::chrono::steady_clock::time_point{
+      std::chrono::steady_clock::duration{
+          lastServerActivity.load(std::memory_order_relaxed)}};
+  if (last.time_since_epoch().count() != 0 &&
+      std::chrono::steady_clock::now() - last < std::chrono::minutes(1)) {
+    log(DBG, "skipping sanity checks; server is demonstrably live\n");
+    return;
+  }
 
-    lastCheck = now;
-    log(DBG, "running sanity checks\n");
+  log(DBG, "running sanity checks\n");
 
-    auto client = w_stm_connect(6000);
-    if (!client) {
-      log(watchman::FATAL,
-          "Failed to connect to myself for sanity check: ",
-          folly::errnoStr(errno),
-          "\n");
-      /* NOTREACHED */
-    }
-    check_my_sock(client.get());
-    do_clock_check(client.get());
+  auto client = w_stm_connect(6000);
+  if (!client) {
+    log(watchman::FATAL,
+        "Failed to connect to myself for sanity check: ",
+        folly::errnoStr(errno),
+        "\n");
+    /* NOTREACHED */
   }
-  log(ERR, "done with sanityCheckThread\n");
+  check_my_sock(client.get());
+  do_clock_check(client.get());
 }
 } // namespace
 
+void noteServerActivity() {
+  lastServerActivity.store(
+      std::chrono::steady_clock::now().time_since_epoch().count(),
+      std::memory_order_relaxed);
+}
+
 void startSanityCheckThread() {
   // The blocking pipe reads we use on win32 can cause us to get blocked
   // forever running the sanity checks, so skip this on win32
 #ifndef _WIN32
-  std::thread thr(sanityCheckThread);
-  thr.detach();
+  log(ERR, "scheduling periodic sanity checks\n");
+  TimerService::get().scheduleEvery(
+      std::chrono::minutes(1), runSanityChecks);
 #endif
 }
 } // namespace watchman
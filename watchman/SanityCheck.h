@@ -9,4 +9,12 @@
 
 namespace watchman {
 void startSanityCheckThread();
+
+/**
+ * Liveness beacon: the command dispatch path calls this after completing
+ * a command, demonstrating that the listener and dispatch machinery are
+ * healthy. The periodic sanity check skips its synthetic self-connect
+ * probe while real traffic has recently proven the same thing.
+ */
+void noteServerActivity();
 }
@@ -71,6 +71,11 @@ class SymlinkTargetCache {
   // Returns cache statistics
   CacheStats stats() const;
 
+  /** Purges all cached targets (eg: under memory pressure). */
+  void clear() {
+    cache_.clear();
+  }
+
  private:
   LRUCache<SymlinkTargetCacheKey, w_string> cache_;
   w_string rootPath_;
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "watchman/TimerService.h"
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "watchman/Logging.h"
+#include "watchman/Shutdown.h"
+
+namespace watchman {
+
+struct TimerService::Impl {
+  struct Entry {
+    std::chrono::milliseconds interval{0};
+    Task fn;
+  };
+
+  std::mutex mutex;
+  std::condition_variable cond;
+  // Armed deadlines, soonest first. multimap because deadlines can
+  // collide.
+  std::multimap<std::chrono::steady_clock::time_point, Entry> deadlines;
+};
+
+TimerService& TimerService::get() {
+  // Leaked singleton; the thread runs for the life of the process and
+  // winds down when shutdown is requested.
+  static TimerService* service = new TimerService();
+  return *service;
+}
+
+TimerService::TimerService() : impl_(new Impl) {
+  std::thread thr([this] { run(); });
+  thr.detach();
+}
+
+void TimerService::scheduleAt(
+    std::chrono::steady_clock::time_point deadline,
+    Task fn) {
+  {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->deadlines.emplace(
+        deadline, Impl::Entry{std::chrono::milliseconds(0), std::move(fn)});
+  }
+  impl_->cond.notify_one();
+}
+
+void TimerService::scheduleEvery(std::chrono::milliseconds interval, Task fn) {
+  {
+    std::lock_guard<std::mutex> lock(impl_->mutex);
+    impl_->deadlines.emplace(
+        std::chrono::steady_clock::now() + interval,
+        Impl::Entry{interval, std::move(fn)});
+  }
+  impl_->cond.notify_one();
+}
+
+void TimerService::run() {
+  w_set_thread_name("timersvc");
+
+  // We don't have a shutdown signal routed here, so bound waits at a
+  // second to notice w_is_stopping with reasonable latency; this single
+  // bounded wait replaces one such poll loop per timer user.
+  constexpr auto kMaxWait = std::chrono::seconds(1);
+
+  std::unique_lock<std::mutex> lock(impl_->mutex);
+  while (!w_is_stopping()) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (!impl_->deadlines.empty() && impl_->deadlines.begin()->first <= now) {
+      auto node = impl_->deadlines.extract(impl_->deadlines.begin());
+      auto entry = std::move(node.mapped());
+
+      if (entry.interval.count()) {
+        impl_->deadlines.emplace(
+            now + entry.interval, Impl::Entry{entry.interval, entry.fn});
+      }
+
+      lock.unlock();
+      try {
+        entry.fn();
+      } catch (const std::exception& exc) {
+        log(ERR, "timer task threw: ", exc.what(), "\n");
+      }
+      lock.lock();
+      continue;
+    }
+
+    auto waitUntil = now + kMaxWait;
+    if (!impl_->deadlines.empty()) {
+      waitUntil = std::min(waitUntil, impl_->deadlines.begin()->first);
+    }
+    impl_->cond.wait_until(lock, waitUntil);
+  }
+}
+
+} // namespace watchman
@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+
+namespace watchman {
+
+/**
+ * A process-wide deadline scheduler backed by a single thread and a
+ * single timed wait per wakeup, so periodic housekeeping doesn't need a
+ * dedicated sleeping thread (or its own condvar dance) per user. Tasks
+ * run on the service thread and should be brief or hand off to other
+ * executors.
+ */
+class TimerService {
+ public:
+  using Task = std::function<void()>;
+
+  static TimerService& get();
+
+  /** Runs fn once at (approximately) the given deadline. */
+  void scheduleAt(std::chrono::steady_clock::time_point deadline, Task fn);
+
+  /** Runs fn every interval until the daemon begins shutting down. */
+  void scheduleEvery(std::chrono::milliseconds interval, Task fn);
+
+ private:
+  TimerService();
+  void run();
+
+  struct Impl;
+  Impl* impl_;
+};
+
+} // namespace watchman
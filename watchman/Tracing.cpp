@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "watchman/Tracing.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include "watchman/RingBuffer.h"
+#include "watchman/WatchmanConfig.h"
+
+namespace watchman::tracing {
+
+namespace {
+
+struct TraceSpan {
+  uint64_t traceId;
+  const char* stage;
+  std::chrono::system_clock::time_point at;
+  char pathTail[48];
+
+  TraceSpan() = default;
+};
+
+RingBuffer<TraceSpan>& spanBuffer() {
+  static auto* buffer = new RingBuffer<TraceSpan>(4096);
+  return *buffer;
+}
+
+std::atomic<uint64_t> nextTraceId{1};
+std::atomic<uint64_t> sampleCounter{0};
+
+void write(uint64_t traceId, const char* stage, const w_string* path) {
+  TraceSpan span;
+  span.traceId = traceId;
+  span.stage = stage;
+  span.at = std::chrono::system_clock::now();
+  span.pathTail[0] = 0;
+  if (path) {
+    storeTruncatedTail(span.pathTail, *path);
+  }
+  spanBuffer().write(span);
+}
+
+} // namespace
+
+uint64_t maybeStartTrace(const w_string& path) {
+  // Config lookups take the global config lock; this runs per pending
+  // change, so snapshot the rate once. The config is immutable after
+  // daemon startup.
+  static const json_int_t rate = cfg_get_int("trace_sample_rate", 0);
+  if (rate <= 0) {
+    return 0;
+  }
+  if (sampleCounter.fetch_add(1, std::memory_order_relaxed) %
+      uint64_t(rate)) {
+    return 0;
+  }
+
+  auto traceId = nextTraceId.fetch_add(1, std::memory_order_relaxed);
+  write(traceId, "pending_add", &path);
+  return traceId;
+}
+
+void recordSpan(uint64_t traceId, const char* stage) {
+  if (!traceId) {
+    return;
+  }
+  write(traceId, stage, nullptr);
+}
+
+json_ref dumpSpans() {
+  auto result = json_array();
+  for (auto& span : spanBuffer().readAll()) {
+    result.array().push_back(json_object({
+        {"trace_id", json_integer(span.traceId)},
+        {"stage", typed_string_to_json(span.stage, W_STRING_UNICODE)},
+        {"at_us",
+         json_integer(std::chrono::duration_cast<std::chrono::microseconds>(
+                          span.at.time_since_epoch())
+                          .count())},
+        {"path_tail",
+         w_string_to_json(w_string(
+             span.pathTail, strnlen(span.pathTail, sizeof(span.pathTail))))},
+    }));
+  }
+  return result;
+}
+
+} // namespace watchman::tracing
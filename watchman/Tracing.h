@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include "watchman/thirdparty/jansson/jansson.h"
+#include "watchman/watchman_string.h"
+
+namespace watchman::tracing {
+
+/**
+ * Sampled end-to-end tracing of change propagation. When the global
+ * trace_sample_rate config is N > 0, roughly one in N pending changes is
+ * assigned a trace id at the moment it enters a PendingCollection; the
+ * stages it passes through record spans into a fixed ring buffer that
+ * debug-trace dumps. Zero-cost when sampling is disabled beyond one
+ * relaxed counter increment per pending change.
+ */
+
+/** Assigns and records a trace id for a sampled path, or returns 0. */
+uint64_t maybeStartTrace(const w_string& path);
+
+/** Records a span for an active trace; no-op when traceId is 0. */
+void recordSpan(uint64_t traceId, const char* stage);
+
+/** Renders the span ring buffer, newest last. */
+json_ref dumpSpans();
+
+} // namespace watchman::tracing
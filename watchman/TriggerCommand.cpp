@@ -7,6 +7,7 @@
 
 #include "watchman/TriggerCommand.h"
 #include <folly/String.h>
+#include <algorithm>
 #include "watchman/Errors.h"
 #include "watchman/PDU.h"
 #include "watchman/QueryableView.h"
@@ -134,6 +135,66 @@ std::unique_ptr<watchman_stream> prepare_stdin(
   return stdin_file;
 }
 
+bool write_all(watchman::FileDescriptor& fd, const char* buf, size_t len) {
+  while (len) {
+    auto r = fd.write(buf, len);
+    if (r.hasError() || r.value() <= 0) {
+      return false;
+    }
+    buf += r.value();
+    len -= size_t(r.value());
+  }
+  return true;
+}
+
+/**
+ * Delivers a firing to a live persistent worker as a length-prefixed
+ * name-per-line batch. Returns false if there is no live worker (or the
+ * pipe broke), in which case the caller falls through to the regular
+ * spawn path, which will (re)launch it.
+ */
+bool send_persistent_batch(struct TriggerCommand* cmd, QueryResult* res) {
+  if (!cmd->current_proc || !cmd->persistentStdin_) {
+    return false;
+  }
+  if (cmd->current_proc->terminated()) {
+    cmd->current_proc->wait();
+    cmd->current_proc.reset();
+    cmd->persistentStdin_.reset();
+    return false;
+  }
+
+  std::string payload;
+  size_t count = 0;
+  for (auto& item : res->resultsArray.array()) {
+    auto* name = json_string_value(item);
+    if (!name) {
+      continue;
+    }
+    payload.append(name);
+    payload.push_back('\n');
+    if (cmd->max_files_stdin && ++count >= cmd->max_files_stdin) {
+      break;
+    }
+  }
+
+  auto header = folly::to<std::string>(payload.size(), "\n");
+  if (!write_all(cmd->persistentStdin_->write, header.data(), header.size()) ||
+      !write_all(
+          cmd->persistentStdin_->write, payload.data(), payload.size())) {
+    logf(
+        ERR,
+        "trigger {}: failed writing batch to persistent worker; respawning\n",
+        cmd->triggername);
+    cmd->current_proc->kill();
+    cmd->current_proc->wait();
+    cmd->current_proc.reset();
+    cmd->persistentStdin_.reset();
+    return false;
+  }
+  return true;
+}
+
 void spawn_command(
     const std::shared_ptr<Root>& root,
     struct TriggerCommand* cmd,
@@ -155,8 +216,18 @@ void spawn_command(
     file_overflow = true;
   }
 
-  auto stdin_file = prepare_stdin(cmd, res);
-  if (!stdin_file) {
+  if (cmd->keep_alive && send_persistent_batch(cmd, res)) {
+    // Delivered to the live worker; nothing to spawn.
+    return;
+  }
+
+  std::unique_ptr<watchman::Pipe> persistentPipe;
+  if (cmd->keep_alive) {
+    persistentPipe = std::make_unique<watchman::Pipe>();
+  }
+
+  auto stdin_file = cmd->keep_alive ? nullptr : prepare_stdin(cmd, res);
+  if (!cmd->keep_alive && !stdin_file) {
     logf(
         ERR,
         "trigger {}:{} {}\n",
@@ -231,7 +302,11 @@ void spawn_command(
 #endif
   opts.setFlags(POSIX_SPAWN_SETPGROUP);
 
-  opts.dup2(stdin_file->getFileDescriptor(), STDIN_FILENO);
+  if (cmd->keep_alive) {
+    opts.dup2(persistentPipe->read, STDIN_FILENO);
+  } else {
+    opts.dup2(stdin_file->getFileDescriptor(), STDIN_FILENO);
+  }
 
   if (!cmd->stdout_name.empty()) {
     opts.open(STDOUT_FILENO, cmd->stdout_name.c_str(), cmd->stdout_flags, 0666);
@@ -270,6 +345,13 @@ void spawn_command(
       cmd->current_proc->wait();
     }
     cmd->current_proc = std::make_unique<ChildProcess>(args, std::move(opts));
+    if (cmd->keep_alive) {
+      // Hold the write side open for future batches and deliver this
+      // firing through it.
+      persistentPipe->read.close();
+      cmd->persistentStdin_ = std::move(persistentPipe);
+      send_persistent_batch(cmd, res);
+    }
   } catch (const std::exception& exc) {
     log(ERR,
         "trigger ",
@@ -325,6 +407,18 @@ TriggerCommand::TriggerCommand(
     throw CommandValidationError("invalid command array");
   }
 
+  keep_alive = trig.get_default("keep_alive", json_false()).asBool();
+
+  {
+    auto interval =
+        trig.get_default("min_spawn_interval_ms", json_integer(0));
+    if (!interval.isInt() || interval.asInt() < 0) {
+      throw CommandValidationError(
+          "min_spawn_interval_ms must be an integer >= 0");
+    }
+    min_spawn_interval = std::chrono::milliseconds(interval.asInt());
+  }
+
   append_files = trig.get_default("append_files", json_false()).asBool();
   if (append_files) {
     // This is unfortunately a bit of a hack.  When appending files to the
@@ -358,6 +452,11 @@ TriggerCommand::TriggerCommand(
     throw CommandValidationError("invalid value for stdin");
   }
 
+  if (keep_alive && stdin_style != input_name_list) {
+    throw CommandValidationError(
+        "keep_alive triggers require stdin set to NAME_PER_LINE");
+  }
+
   // unlimited unless specified
   auto ival = trig.get_default("max_files_stdin", json_integer(0)).asInt();
   if (ival < 0) {
@@ -394,28 +493,51 @@ void TriggerCommand::run(const std::shared_ptr<Root>& root) {
 
     log(DBG, "waiting for settle\n");
 
+    // When a settle arrives inside the min-spawn interval we note it
+    // and wake up when the interval expires; the eventual firing's
+    // since clock covers everything coalesced in between.
+    bool deferredSettle = false;
+
     while (!w_is_stopping() && !stopTrigger_) {
-      ignore_result(w_poll_events(pfd, 1, 86400));
+      int timeoutms = 86400000;
+      if (deferredSettle) {
+        auto wait = min_spawn_interval -
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - last_spawn);
+        timeoutms = int(std::max<int64_t>(wait.count(), 1));
+      }
+
+      ignore_result(w_poll_events(pfd, 1, timeoutms));
       if (w_is_stopping() || stopTrigger_) {
         break;
       }
+
+      bool seenSettle = false;
       while (ping_->testAndClear()) {
         pending.clear();
         subscriber_->getPending(pending);
-        bool seenSettle = false;
         for (auto& item : pending) {
           if (item->payload.get_default("settled")) {
             seenSettle = true;
             break;
           }
         }
+      }
 
-        if (seenSettle) {
-          if (!maybeSpawn(root)) {
-            continue;
-          }
-          waitNoIntr();
+      if (deferredSettle || seenSettle) {
+        auto now = std::chrono::steady_clock::now();
+        if (min_spawn_interval.count() &&
+            now - last_spawn < min_spawn_interval) {
+          deferredSettle = true;
+          continue;
+        }
+        deferredSettle = false;
+        last_spawn = now;
+
+        if (!maybeSpawn(root)) {
+          continue;
         }
+        waitNoIntr();
       }
     }
 
@@ -11,6 +11,7 @@
 
 #include "watchman/ChildProcess.h"
 #include "watchman/PubSub.h"
+#include "watchman/fs/Pipe.h"
 #include "watchman/saved_state/SavedStateInterface.h"
 
 class watchman_event;
@@ -33,6 +34,21 @@ struct TriggerCommand {
   enum trigger_input_style stdin_style;
   uint32_t max_files_stdin;
 
+  /* When true (the "keep_alive" trigger option, NAME_PER_LINE only), the
+   * spawned process is kept running across firings and receives each
+   * batch as a length-prefixed block of name-per-line data on stdin,
+   * avoiding a fork/exec per firing. */
+  bool keep_alive{false};
+
+  /* Minimum interval between spawns (the "min_spawn_interval_ms" trigger
+   * option). Settles arriving faster than this are coalesced: the
+   * trigger fires once when the interval expires, covering every change
+   * accumulated meanwhile via its since clock. Zero disables. */
+  std::chrono::milliseconds min_spawn_interval{0};
+  std::chrono::steady_clock::time_point last_spawn{};
+  /* Write side of the persistent worker's stdin. */
+  std::unique_ptr<watchman::Pipe> persistentStdin_;
+
   int stdout_flags;
   int stderr_flags;
   std::string stdout_name;
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <vector>
+#include "watchman/InMemoryView.h"
+#include "watchman/Logging.h"
+#include "watchman/PDU.h"
+#include "watchman/watcher/Watcher.h"
+#include "watchman/watchman_file.h"
+#include "watchman/watchman_stream.h"
+
+namespace watchman {
+
+namespace {
+
+// Bump this whenever the per-file entry layout below changes; snapshots
+// with a different version are ignored rather than migrated.
+constexpr json_int_t kViewSnapshotVersion = 1;
+
+json_ref serializeFileNode(const watchman_file* f) {
+  return json_array({
+      w_string_to_json(f->parent->getFullPathToChild(f->getName())),
+      json_boolean(f->exists),
+      json_integer(f->stat.mode),
+      json_integer(f->stat.size),
+      json_integer(f->stat.nlink),
+      json_integer(f->stat.dev),
+      json_integer(f->stat.ino),
+      json_integer(f->stat.uid),
+      json_integer(f->stat.gid),
+      json_integer(f->stat.mtime.tv_sec),
+      json_integer(f->stat.mtime.tv_nsec),
+      json_integer(f->stat.ctime.tv_sec),
+      json_integer(f->stat.ctime.tv_nsec),
+      json_integer(f->otime.ticks),
+      json_integer(f->otime.timestamp),
+      json_integer(f->ctime.ticks),
+      json_integer(f->ctime.timestamp),
+  });
+}
+
+} // namespace
+
+json_ref InMemoryView::takeViewSnapshot() const {
+  auto view = view_.rlock();
+
+  auto files = json_array();
+  for (const watchman_file* f = view->getLatestFile(); f; f = f->next) {
+    json_array_append_new(files, serializeFileNode(f));
+  }
+
+  return json_object({
+      {"version", json_integer(kViewSnapshotVersion)},
+      {"root", w_string_to_json(rootPath_)},
+      {"clock", json_integer(mostRecentTick_.load(std::memory_order_acquire))},
+      {"root_inode", json_integer(view->getRootInode())},
+      {"files", std::move(files)},
+  });
+}
+
+void InMemoryView::restoreViewSnapshot(const json_ref& snapshot) {
+  if (json_integer_value(snapshot.get_default("version")) !=
+      kViewSnapshotVersion) {
+    log(ERR, "view snapshot has unsupported version, ignoring\n");
+    return;
+  }
+  if (json_to_w_string(snapshot.get_default("root")) != rootPath_) {
+    log(ERR, "view snapshot was taken for a different root, ignoring\n");
+    return;
+  }
+
+  auto view = view_.wlock();
+  if (view->getLatestFile()) {
+    // Only an empty view may be restored into; anything else would
+    // scramble the recency order of changes we've already observed.
+    log(ERR, "view is already populated, ignoring snapshot\n");
+    return;
+  }
+
+  const auto& files = snapshot.get("files");
+
+  // The snapshot is serialized newest-first by walking the recency list,
+  // so apply it in reverse to finish with the same recency order.
+  for (size_t i = json_array_size(files); i > 0; --i) {
+    const auto& entry = files.at(i - 1);
+    auto name = json_to_w_string(entry.at(0));
+
+    auto* dir = view->resolveDir(name.dirName(), true);
+    ClockStamp cclock{
+        uint32_t(json_integer_value(entry.at(15))),
+        time_t(json_integer_value(entry.at(16)))};
+    auto* file = view->getOrCreateChildFile(
+        *watcher_, dir, name.baseName(), cclock);
+
+    file->exists = json_is_true(entry.at(1));
+    file->stat.mode = mode_t(json_integer_value(entry.at(2)));
+    file->stat.size = off_t(json_integer_value(entry.at(3)));
+    file->stat.nlink = nlink_t(json_integer_value(entry.at(4)));
+    file->stat.dev = dev_t(json_integer_value(entry.at(5)));
+    file->stat.ino = ino_t(json_integer_value(entry.at(6)));
+    file->stat.uid = uid_t(json_integer_value(entry.at(7)));
+    file->stat.gid = gid_t(json_integer_value(entry.at(8)));
+    file->stat.mtime.tv_sec = json_integer_value(entry.at(9));
+    file->stat.mtime.tv_nsec = json_integer_value(entry.at(10));
+    file->stat.ctime.tv_sec = json_integer_value(entry.at(11));
+    file->stat.ctime.tv_nsec = json_integer_value(entry.at(12));
+
+    ClockStamp otime{
+        uint32_t(json_integer_value(entry.at(13))),
+        time_t(json_integer_value(entry.at(14)))};
+    view->markFileChanged(*watcher_, file, otime);
+
+    if (file->stat.isDir()) {
+      // Make sure the corresponding dir node exists so that the
+      // comparison crawl descends into it rather than treating it as
+      // brand new.
+      view->resolveDir(name, true)->last_check_existed = file->exists;
+    }
+  }
+
+  view->setRootInode(
+      ino_t(json_integer_value(snapshot.get_default("root_inode"))));
+
+  // Resume the tick stream after the snapshot clock so that changes
+  // discovered by the comparison crawl sort after everything restored
+  // above.
+  auto clock = uint32_t(json_integer_value(snapshot.get_default("clock")));
+  mostRecentTick_.store(clock + 1, std::memory_order_release);
+
+  logf(
+      ERR,
+      "restored view snapshot with {} files at tick {}\n",
+      json_array_size(files),
+      clock);
+}
+
+void InMemoryView::maybeRestoreViewSnapshot() {
+  if (viewSnapshotPath_.empty() || viewSnapshotRestoreAttempted_) {
+    return;
+  }
+  viewSnapshotRestoreAttempted_ = true;
+
+  auto file = w_stm_open(viewSnapshotPath_.c_str(), O_RDONLY);
+  if (!file) {
+    // Not having written a snapshot yet is the common case; stay quiet.
+    return;
+  }
+
+  try {
+    w_jbuffer_t buffer;
+    json_error_t jerr;
+    auto snapshot = buffer.decodeNext(file.get(), &jerr);
+    if (!snapshot) {
+      logf(
+          ERR,
+          "failed to decode view snapshot {}: {}\n",
+          viewSnapshotPath_,
+          jerr.text);
+      return;
+    }
+    restoreViewSnapshot(snapshot);
+  } catch (const std::exception& exc) {
+    logf(
+        ERR,
+        "failed to restore view snapshot {}: {}\n",
+        viewSnapshotPath_,
+        exc.what());
+  }
+}
+
+void InMemoryView::maybeSaveViewSnapshot(bool force) {
+  if (viewSnapshotPath_.empty()) {
+    return;
+  }
+
+  auto tick = mostRecentTick_.load(std::memory_order_acquire);
+  if (!force && tick < lastSnapshotTick_ + viewSnapshotIntervalTicks_) {
+    return;
+  }
+
+  // Write-then-rename so that the snapshot at viewSnapshotPath_ is
+  // always a complete, immutable image. This doubles as an export
+  // facility: sidecar tools may open and decode the published file at
+  // any time — the embedded clock versions it — without coordinating
+  // with the daemon or racing a partial write.
+  auto tmpPath = viewSnapshotPath_ + ".tmp";
+  auto file = w_stm_open(tmpPath.c_str(), O_WRONLY | O_TRUNC | O_CREAT, 0600);
+  if (!file) {
+    logf(
+        ERR,
+        "maybeSaveViewSnapshot: unable to open {} for write\n",
+        tmpPath);
+    return;
+  }
+
+  auto snapshot = takeViewSnapshot();
+  w_jbuffer_t buffer;
+  if (!buffer.bserEncodeToStream(2, 0, snapshot, file.get())) {
+    logf(ERR, "maybeSaveViewSnapshot: failed writing {}\n", tmpPath);
+    return;
+  }
+  file.reset();
+
+  if (rename(tmpPath.c_str(), viewSnapshotPath_.c_str()) != 0) {
+    logf(
+        ERR,
+        "maybeSaveViewSnapshot: failed renaming {} into place\n",
+        tmpPath);
+    return;
+  }
+
+  lastSnapshotTick_ = tick;
+}
+
+} // namespace watchman
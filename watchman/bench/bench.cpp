@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+// Microbenchmarks for the hot core data structures. Build with the
+// `bench` target and run ./bench.t; each case reports ns/op over enough
+// iterations to stabilize. This deliberately uses a tiny self-timing
+// harness rather than pulling in google-benchmark as a dependency.
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "watchman/PendingCollection.h"
+#include "watchman/bser.h"
+#include "watchman/thirdparty/libart/src/art.h"
+#include "watchman/watchman_string.h"
+
+using namespace watchman;
+
+namespace {
+
+// Synthetic but representative path corpus: a few top level dirs, deep
+// nesting, and realistic component lengths.
+std::vector<w_string> makePathCorpus(size_t count) {
+  static const char* tops[] = {"src", "node_modules", "build", "third-party"};
+  std::vector<w_string> paths;
+  paths.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    paths.push_back(w_string::build(
+        "/repo/",
+        tops[i % 4],
+        "/component",
+        i % 97,
+        "/subdir",
+        i % 13,
+        "/file",
+        i,
+        ".cpp"));
+  }
+  return paths;
+}
+
+void run(const char* name, size_t ops, const std::function<void()>& body) {
+  using clock = std::chrono::steady_clock;
+
+  // Warm up once, then measure.
+  body();
+  auto start = clock::now();
+  body();
+  auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      clock::now() - start);
+
+  printf(
+      "%-32s %12zu ops %10.1f ns/op\n",
+      name,
+      ops,
+      double(elapsed.count()) / double(ops));
+}
+
+void benchArtTree(const std::vector<w_string>& corpus) {
+  art_tree<int, w_string> tree;
+
+  run("art_tree insert", corpus.size(), [&] {
+    for (auto& path : corpus) {
+      tree.insert(path, 1);
+    }
+  });
+
+  run("art_tree search", corpus.size(), [&] {
+    size_t hits = 0;
+    for (auto& path : corpus) {
+      hits += tree.search(path) ? 1 : 0;
+    }
+    if (hits != corpus.size()) {
+      printf("art_tree search: unexpected misses!\n");
+    }
+  });
+}
+
+void benchStringHash(const std::vector<w_string>& corpus) {
+  run("w_string hash", corpus.size(), [&] {
+    size_t accum = 0;
+    for (auto& path : corpus) {
+      accum += w_string_piece{path}.hashValue();
+    }
+    // Keep the loop from being optimized out
+    if (accum == 42) {
+      printf("!\n");
+    }
+  });
+}
+
+void benchPendingCollection(const std::vector<w_string>& corpus) {
+  auto now = std::chrono::system_clock::now();
+
+  run("PendingChanges::add", corpus.size(), [&] {
+    PendingChanges coll;
+    for (auto& path : corpus) {
+      coll.add(path, now, W_PENDING_VIA_NOTIFY);
+    }
+    coll.stealItems();
+  });
+}
+
+void benchBser(const std::vector<w_string>& corpus) {
+  auto files = json_array();
+  for (auto& path : corpus) {
+    json_array_append_new(
+        files,
+        json_object(
+            {{"name", w_string_to_json(path)},
+             {"size", json_integer(4096)},
+             {"exists", json_true()}}));
+  }
+  auto payload = json_object({{"files", std::move(files)}});
+
+  std::string encoded;
+  auto append = [](const char* buf, size_t size, void* ptr) -> int {
+    static_cast<std::string*>(ptr)->append(buf, size);
+    return 0;
+  };
+
+  run("bser encode", corpus.size(), [&] {
+    encoded.clear();
+    w_bser_write_pdu(2, 0, append, payload, &encoded);
+  });
+
+  run("bser decode", corpus.size(), [&] {
+    json_error_t jerr;
+    json_int_t needed;
+    json_int_t payloadLen;
+    // Skip the magic, capabilities and length headers the same way the
+    // PDU layer does before calling bunser.
+    const char* data = encoded.data() + 2 + sizeof(uint32_t);
+    const char* end = encoded.data() + encoded.size();
+    bunser_int(data, end - data, &needed, &payloadLen);
+    data += needed;
+    auto decoded = bunser(data, end, &needed, &jerr);
+    if (!decoded) {
+      printf("bser decode failed: %s\n", jerr.text);
+    }
+  });
+}
+
+} // namespace
+
+int main() {
+  auto corpus = makePathCorpus(100000);
+
+  benchStringHash(corpus);
+  benchArtTree(corpus);
+  benchPendingCollection(corpus);
+  benchBser(corpus);
+
+  return 0;
+}
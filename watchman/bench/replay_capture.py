@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+# Copyright (c) Meta Platforms, Inc. and affiliates.
+#
+# This source code is licensed under the MIT license found in the
+# LICENSE file in the root directory of this source tree.
+
+"""Replays a pdu_capture_path log against a watchman daemon.
+
+Each record in the capture is a BSER object {ts_us, client, request}
+appended by the daemon when pdu_capture_path is configured. Replay
+preserves the original inter-request spacing by default; --speed N
+divides the gaps (0 replays flat out). Point WATCHMAN_SOCK at a test
+daemon (typically watching a scratch or FakeFileSystem-style clone of
+the production root) before running.
+
+Usage: replay_capture.py capture.bser [--speed N]
+"""
+
+import argparse
+import sys
+import time
+
+import pywatchman
+from pywatchman import bser
+
+
+def read_records(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    while pos < len(data):
+        # Each record is a self-delimiting BSER v2 pdu.
+        _, _, total = bser.pdu_info(data[pos:])
+        yield bser.loads(data[pos : pos + total])
+        pos += total
+
+
+def main():
+    ap = argparse.ArgumentParser()
+    ap.add_argument("capture")
+    ap.add_argument(
+        "--speed",
+        type=float,
+        default=1.0,
+        help="replay speed multiplier; 0 replays with no delays",
+    )
+    args = ap.parse_args()
+
+    client = pywatchman.client()
+    prev_ts = None
+    count = 0
+    started = time.monotonic()
+
+    for record in read_records(args.capture):
+        ts = record[b"ts_us"] if b"ts_us" in record else record["ts_us"]
+        request = record[b"request"] if b"request" in record else record["request"]
+
+        if prev_ts is not None and args.speed > 0:
+            gap = (ts - prev_ts) / 1e6 / args.speed
+            if gap > 0:
+                time.sleep(gap)
+        prev_ts = ts
+
+        try:
+            client.query(*request)
+        except pywatchman.WatchmanError as exc:
+            print("request %d failed: %s" % (count, exc), file=sys.stderr)
+        count += 1
+
+    elapsed = time.monotonic() - started
+    print("replayed %d requests in %.2fs" % (count, elapsed))
+
+
+if __name__ == "__main__":
+    main()
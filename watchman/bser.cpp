@@ -6,6 +6,9 @@
  */
 
 #include "watchman/bser.h"
+#include <optional>
+#include <unordered_map>
+#include <vector>
 #include "watchman/Logging.h"
 #include "watchman/thirdparty/jansson/jansson_private.h"
 
@@ -38,6 +41,10 @@
 #define BSER_TEMPLATE 0x0b
 #define BSER_SKIP 0x0c
 #define BSER_UTF8STRING 0x0d
+// A reference to a previously emitted string in this PDU; only valid
+// when BSER_CAP_STRING_TABLE was negotiated. Followed by a bser int
+// index into the implicit table.
+#define BSER_STRING_REF 0x0e
 
 static const char bser_true = BSER_TRUE;
 static const char bser_false = BSER_FALSE;
@@ -73,6 +80,23 @@ bool bunser_generic_string(
     json_int_t* len) {
   json_int_t ineed;
 
+  if (decodeTable.active && avail > 0 && buf[0] == BSER_STRING_REF) {
+    // Resolve a table reference; the returned pointer aims into the
+    // recorded string, which the table keeps alive for the rest of
+    // this PDU's decode.
+    json_int_t idx;
+    if (!bunser_int(buf + 1, avail - 1, &ineed, &idx) || idx < 0 ||
+        size_t(idx) >= decodeTable.strings.size()) {
+      *needed = -1;
+      return false;
+    }
+    auto& recorded = decodeTable.strings[size_t(idx)];
+    *start = recorded.data();
+    *len = recorded.size();
+    *needed = ineed + 1;
+    return true;
+  }
+
   if (!bunser_int(buf + 1, avail - 1, &ineed, len)) {
     *needed = ineed;
     return false;
@@ -87,6 +111,13 @@ bool bunser_generic_string(
   }
 
   *start = buf;
+
+  if (decodeTable.active) {
+    // Mirror the encoder's table: every literal string is appended in
+    // emission order. Stored as a byte string; the typed value decode
+    // path refines the type of its own entries.
+    decodeTable.strings.emplace_back(*start, uint32_t(*len), W_STRING_BYTE);
+  }
   return true;
 }
 
@@ -192,6 +223,43 @@ static int bser_int(const bser_ctx_t* ctx, json_int_t val, void* data) {
   return ctx->dump(iptr, size, data);
 }
 
+namespace {
+// Implicit per-PDU string tables, active only within the RAII scopes
+// declared in bser.h. Encoding and decoding are single threaded per
+// PDU, so thread locals avoid threading state through every helper.
+struct EncodeTable {
+  bool active{false};
+  std::unordered_map<w_string, uint32_t> indexByString;
+};
+thread_local EncodeTable encodeTable;
+
+struct DecodeTable {
+  bool active{false};
+  std::vector<w_string> strings;
+};
+thread_local DecodeTable decodeTable;
+} // namespace
+
+BserStringTableEncodeScope::BserStringTableEncodeScope() {
+  encodeTable.active = true;
+  encodeTable.indexByString.clear();
+}
+
+BserStringTableEncodeScope::~BserStringTableEncodeScope() {
+  encodeTable.active = false;
+  encodeTable.indexByString.clear();
+}
+
+BserStringTableDecodeScope::BserStringTableDecodeScope() {
+  decodeTable.active = true;
+  decodeTable.strings.clear();
+}
+
+BserStringTableDecodeScope::~BserStringTableDecodeScope() {
+  decodeTable.active = false;
+  decodeTable.strings.clear();
+}
+
 static int bser_generic_string(
     const bser_ctx_t* ctx,
     w_string_piece str,
@@ -201,6 +269,20 @@ static int bser_generic_string(
     return -1;
   }
 
+  if (encodeTable.active) {
+    auto key = str.asWString();
+    auto it = encodeTable.indexByString.find(key);
+    if (it != encodeTable.indexByString.end()) {
+      static const char refHdr = BSER_STRING_REF;
+      if (ctx->dump(&refHdr, sizeof(refHdr), data)) {
+        return -1;
+      }
+      return bser_int(ctx, it->second, data);
+    }
+    encodeTable.indexByString.emplace(
+        std::move(key), uint32_t(encodeTable.indexByString.size()));
+  }
+
   if (ctx->dump(&hdr, sizeof(hdr), data)) {
     return -1;
   }
@@ -421,12 +503,23 @@ int w_bser_write_pdu(
   json_int_t m_size = 0;
   bser_ctx_t ctx{bser_version, bser_capabilities, measure};
 
+  const bool useStringTable =
+      bser_version == 2 && (bser_capabilities & BSER_CAP_STRING_TABLE);
+
   if (!is_bser_version_supported(&ctx)) {
     return -1;
   }
 
-  if (w_bser_dump(&ctx, json, &m_size)) {
-    return -1;
+  {
+    // The measure pass must populate and consume the table exactly as
+    // the dump pass will, then start the dump pass from a fresh table.
+    std::optional<BserStringTableEncodeScope> tableScope;
+    if (useStringTable) {
+      tableScope.emplace();
+    }
+    if (w_bser_dump(&ctx, json, &m_size)) {
+      return -1;
+    }
   }
 
   // To actually write the contents
@@ -453,8 +546,14 @@ int w_bser_write_pdu(
     return -1;
   }
 
-  if (w_bser_dump(&ctx, json, data)) {
-    return -1;
+  {
+    std::optional<BserStringTableEncodeScope> tableScope;
+    if (useStringTable) {
+      tableScope.emplace();
+    }
+    if (w_bser_dump(&ctx, json, data)) {
+      return -1;
+    }
   }
 
   return 0;
@@ -690,16 +789,32 @@ json_ref bunser(
       }
       return json_integer(ival);
 
+    case BSER_STRING_REF:
     case BSER_BYTESTRING:
     case BSER_UTF8STRING: {
       const char* start;
       json_int_t len;
+      bool isRef = buf[0] == BSER_STRING_REF;
+
+      if (isRef && !decodeTable.active) {
+        snprintf(
+            jerr->text,
+            sizeof(jerr->text),
+            "string table reference without negotiated string table");
+        return nullptr;
+      }
 
       if (!bunser_generic_string(buf, end - buf, needed, &start, &len)) {
         snprintf(jerr->text, sizeof(jerr->text), "invalid bytestring encoding");
         return nullptr;
       }
 
+      if (isRef) {
+        // start/len alias the recorded table entry; hand back a fresh
+        // ref to the same string.
+        return w_string_to_json(w_string(start, uint32_t(len), W_STRING_BYTE));
+      }
+
       return typed_string_to_json(
           start,
           len,
@@ -21,6 +21,13 @@ typedef struct bser_ctx {
 // BSERv2 capabilities. Must be powers of 2.
 #define BSER_CAP_DISABLE_UNICODE 0x1
 #define BSER_CAP_DISABLE_UNICODE_FOR_ERRORS 0x2
+// When negotiated, each PDU carries an implicit string table: the first
+// occurrence of a string is emitted literally (and appended to the
+// table by both sides as it is written/read), and repeats are emitted
+// as a compact table reference. Object keys and values both
+// participate, so a 500k-row result emits each field name and each
+// repeated path prefix string once.
+#define BSER_CAP_STRING_TABLE 0x4
 
 int w_bser_write_pdu(
     const uint32_t bser_version,
@@ -34,6 +41,24 @@ bool bunser_int(
     json_int_t avail,
     json_int_t* needed,
     json_int_t* val);
+/**
+ * RAII scopes enabling the implicit per-PDU string table for the calling
+ * thread's encode or decode. The PDU layer activates these when
+ * BSER_CAP_STRING_TABLE was negotiated; each scope starts with an empty
+ * table.
+ */
+class BserStringTableEncodeScope {
+ public:
+  BserStringTableEncodeScope();
+  ~BserStringTableEncodeScope();
+};
+
+class BserStringTableDecodeScope {
+ public:
+  BserStringTableDecodeScope();
+  ~BserStringTableDecodeScope();
+};
+
 json_ref bunser(
     const char* buf,
     const char* end,
@@ -19,7 +19,7 @@ bool try_client_mode_command(const json_ref& cmd, bool pretty) {
 
   if (!client->responses.empty()) {
     json_dumpf(
-        client->responses.front(),
+        client->responses.front().payload,
         stdout,
         pretty ? JSON_INDENT(4) : JSON_COMPACT);
     printf("\n");
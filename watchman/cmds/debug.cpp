@@ -6,11 +6,22 @@
  */
 
 #include <folly/chrono/Conv.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
 #include <iomanip>
+#include "watchman/AllocationCounters.h"
+#include "watchman/query/eval.h"
+#include "watchman/query/parse.h"
+#include "watchman/saved_state/SavedStateFactory.h"
+#include <folly/stop_watch.h>
+#include <atomic>
 #include "watchman/InMemoryView.h"
 #include "watchman/LRUCache.h"
+#include "watchman/LatencyHistogram.h"
 #include "watchman/Logging.h"
 #include "watchman/Poison.h"
+#include "watchman/Tracing.h"
 #include "watchman/QueryableView.h"
 #include "watchman/root/Root.h"
 #include "watchman/watchman_client.h"
@@ -253,12 +264,189 @@ W_CMD_REG(
     CMD_DAEMON,
     w_cmd_realpath_root)
 
+/* self-test /root [threshold_ms]
+ * Synthetic end-to-end probe: performs a cookie sync against the root
+ * (which exercises the create-file -> watcher -> iothread pipeline) and
+ * then evaluates a trivial query, reporting per-stage durations and
+ * rolling SLO counters. */
+static void cmd_self_test(
+    struct watchman_client* clientbase,
+    const json_ref& args) {
+  auto* client = (watchman_user_client*)clientbase;
+  auto root = resolveRoot(client, args);
+
+  json_int_t thresholdMs = 1000;
+  if (json_array_size(args) > 2 && args.at(2).isInt()) {
+    thresholdMs = args.at(2).asInt();
+  }
+
+  static std::atomic<uint64_t> probesTotal{0};
+  static std::atomic<uint64_t> probesSlow{0};
+  static std::atomic<uint64_t> probesFailed{0};
+
+  auto resp = make_response();
+  folly::stop_watch<std::chrono::milliseconds> timer;
+
+  try {
+    // Stage 1: full write -> watcher -> iothread round trip.
+    root->view()->syncToNow(root, std::chrono::seconds(20));
+    auto syncMs = timer.lap().count();
+
+    // Stage 2: query machinery, with sync disabled since we just did it.
+    auto spec = json_object(
+        {{"expression", json_array({typed_string_to_json("false")})},
+         {"sync_timeout", json_integer(0)}});
+    auto query = parseQuery(root, spec);
+    w_query_execute(query.get(), root, nullptr, getInterface);
+    auto queryMs = timer.lap().count();
+
+    auto total = ++probesTotal;
+    bool slow = syncMs + queryMs > thresholdMs;
+    if (slow) {
+      ++probesSlow;
+    }
+
+    resp.set(
+        {{"healthy", json_boolean(!slow)},
+         {"sync_ms", json_integer(syncMs)},
+         {"query_ms", json_integer(queryMs)},
+         {"probes_total", json_integer(total)},
+         {"probes_slow", json_integer(probesSlow.load())},
+         {"probes_failed", json_integer(probesFailed.load())}});
+  } catch (const std::exception& exc) {
+    ++probesTotal;
+    ++probesFailed;
+    resp.set(
+        {{"healthy", json_false()},
+         {"error", typed_string_to_json(exc.what(), W_STRING_MIXED)},
+         {"probes_total", json_integer(probesTotal.load())},
+         {"probes_slow", json_integer(probesSlow.load())},
+         {"probes_failed", json_integer(probesFailed.load())}});
+  }
+
+  send_and_dispose_response(client, std::move(resp));
+}
+W_CMD_REG("self-test", cmd_self_test, CMD_DAEMON, w_cmd_realpath_root)
+
+static void cmd_debug_crawl_info(
+    struct watchman_client* clientbase,
+    const json_ref& args) {
+  auto* client = (watchman_user_client*)clientbase;
+  auto root = resolveRoot(client, args);
+
+  auto view = std::dynamic_pointer_cast<InMemoryView>(root->view());
+  if (!view) {
+    send_error_response(client, "root has no crawl profiles (eden?)");
+    return;
+  }
+
+  auto resp = make_response();
+  resp.set("crawls", view->renderCrawlProfiles());
+  send_and_dispose_response(client, std::move(resp));
+}
+W_CMD_REG(
+    "debug-crawl-info",
+    cmd_debug_crawl_info,
+    CMD_DAEMON,
+    w_cmd_realpath_root)
+
+static void cmd_debug_trace(struct watchman_client* client, const json_ref&) {
+  auto resp = make_response();
+  resp.set("spans", watchman::tracing::dumpSpans());
+  send_and_dispose_response(client, std::move(resp));
+}
+W_CMD_REG("debug-trace", cmd_debug_trace, CMD_DAEMON | CMD_ALLOW_ANY_USER, NULL)
+
+static void cmd_stats(struct watchman_client* client, const json_ref& args) {
+  bool reset = false;
+  if (json_array_size(args) > 1) {
+    auto& arg = args.at(1);
+    reset = arg.isString() && !strcmp(json_string_value(arg), "reset");
+  }
+
+  auto resp = make_response();
+  resp.set("latency", LatencyHistogram::renderAll());
+  if (reset) {
+    LatencyHistogram::resetAll();
+    resp.set("reset", json_true());
+  }
+  send_and_dispose_response(client, std::move(resp));
+}
+W_CMD_REG("stats", cmd_stats, CMD_DAEMON | CMD_ALLOW_ANY_USER, NULL)
+
+static void cmd_debug_allocations(
+    struct watchman_client* client,
+    const json_ref&) {
+  auto counters = getProcessAllocationCounters();
+  auto resp = make_response();
+  resp.set(
+      {{"alloc_count", json_integer(counters.allocCount)},
+       {"alloc_bytes", json_integer(counters.allocBytes)},
+       {"free_count", json_integer(counters.freeCount)},
+       {"live_allocations",
+        json_integer(counters.allocCount - counters.freeCount)}});
+  send_and_dispose_response(client, std::move(resp));
+}
+W_CMD_REG(
+    "debug-allocations",
+    cmd_debug_allocations,
+    CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    NULL)
+
+static json_ref renderAllocatorStats() {
+  auto counters = getProcessAllocationCounters();
+  auto result = json_object({
+      {"alloc_count", json_integer(counters.allocCount)},
+      {"free_count", json_integer(counters.freeCount)},
+      {"alloc_bytes", json_integer(counters.allocBytes)},
+  });
+
+#ifdef __GLIBC__
+  // Lightweight fragmentation signal: bytes the allocator holds versus
+  // bytes actually in use. A ratio well above 1 after an incident means
+  // freed memory is stranded in the heap and debug-malloc-trim may
+  // recover it.
+  auto info = mallinfo2();
+  result.set(
+      {{"heap_bytes", json_integer(info.arena + info.hblkhd)},
+       {"in_use_bytes", json_integer(info.uordblks + info.hblkhd)},
+       {"free_bytes", json_integer(info.fordblks)},
+       {"trimmable_bytes", json_integer(info.keepcost)}});
+#endif
+
+  return result;
+}
+
 static void cmd_debug_status(struct watchman_client* client, const json_ref&) {
   auto resp = make_response();
   auto roots = Root::getStatusForAllRoots();
   resp.set("roots", std::move(roots));
+  resp.set("allocator", renderAllocatorStats());
+  send_and_dispose_response(client, std::move(resp));
+}
+
+static void cmd_debug_malloc_trim(
+    struct watchman_client* client,
+    const json_ref&) {
+  auto resp = make_response();
+#ifdef __GLIBC__
+  auto before = mallinfo2();
+  int trimmed = malloc_trim(0);
+  auto after = mallinfo2();
+  resp.set(
+      {{"trimmed", json_boolean(trimmed != 0)},
+       {"heap_bytes_before", json_integer(before.arena + before.hblkhd)},
+       {"heap_bytes_after", json_integer(after.arena + after.hblkhd)}});
+#else
+  resp.set("error", typed_string_to_json("malloc_trim is not available"));
+#endif
   send_and_dispose_response(client, std::move(resp));
 }
+W_CMD_REG(
+    "debug-malloc-trim",
+    cmd_debug_malloc_trim,
+    CMD_DAEMON,
+    NULL)
 W_CMD_REG(
     "debug-status",
     cmd_debug_status,
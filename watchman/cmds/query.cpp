@@ -5,6 +5,15 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <folly/futures/Future.h>
+#include <algorithm>
+#include <thread>
+#include <folly/Synchronized.h>
+#include <unordered_map>
+#include <deque>
+#include <atomic>
+#include "watchman/Errors.h"
+#include "watchman/ThreadPool.h"
 #include "watchman/query/Query.h"
 #include "watchman/query/eval.h"
 #include "watchman/query/parse.h"
@@ -15,6 +24,32 @@
 using namespace watchman;
 
 /* query /root {query} */
+namespace {
+
+/**
+ * Server-side result memoization for poll-style clients that re-run the
+ * same query periodically. Each diffed query response carries a
+ * result_id; a follow-up query passing diff_since_result_id receives
+ * only rows that changed since that result plus a "removed" name list.
+ * The daemon retains compact name->rowhash maps, not the results
+ * themselves, bounded to a handful of entries.
+ */
+struct RetainedResult {
+  uint64_t id;
+  std::unordered_map<w_string, uint64_t> rowHashes;
+};
+
+folly::Synchronized<std::deque<RetainedResult>, std::mutex> retainedResults;
+std::atomic<uint64_t> nextResultId{1};
+constexpr size_t kMaxRetainedResults = 16;
+
+uint64_t hashRow(const json_ref& row) {
+  auto dumped = json_dumps(row, JSON_COMPACT);
+  return w_string_piece(dumped.data(), dumped.size()).hashValue();
+}
+
+} // namespace
+
 static void cmd_query(struct watchman_client* client, const json_ref& args) {
   if (json_array_size(args) != 3) {
     send_error_response(client, "wrong number of arguments for 'query'");
@@ -31,13 +66,118 @@ static void cmd_query(struct watchman_client* client, const json_ref& args) {
     query->sync_timeout = std::chrono::milliseconds(0);
   }
 
-  auto res = w_query_execute(query.get(), root, nullptr, getInterface);
+  std::function<void(std::vector<json_ref>&&)> streamer;
+  if (query->stream_results) {
+    // Flush rendered chunks to the client as generation proceeds. Each
+    // chunk is its own PDU carrying "stream_files"; the client knows to
+    // keep reading until the regular response arrives because it asked
+    // for stream_results.
+    streamer = [client](std::vector<json_ref>&& chunk) {
+      auto files = json_array();
+      for (auto& f : chunk) {
+        json_array_append_new(files, std::move(f));
+      }
+      auto resp = make_response();
+      resp.set({{"stream_files", std::move(files)}});
+      client->enqueueResponse(std::move(resp));
+      // Push the chunk to the wire now: the client thread won't drain
+      // the response queue until this command returns, and letting
+      // chunks pile up there would just re-create the peak-memory
+      // problem streaming exists to fix (with encoded copies on top).
+      // This runs on the client's own thread, so the non-blocking flush
+      // is safe; the rendered rows are released as each chunk encodes.
+      client->flushNonBlocking();
+    };
+  }
+
+  auto res =
+      w_query_execute(query.get(), root, nullptr, getInterface, streamer);
   auto response = make_response();
+
+  auto diffRequested = query_spec.get_default("diff_results", json_false());
+  if (diffRequested.isBool() && diffRequested.asBool()) {
+    // Hash each row by name and compare against the retained map from
+    // the result named by diff_since_result_id, if provided and still
+    // retained; emit only changed rows plus removals. Rows without a
+    // name field can't be correlated and always pass through.
+    RetainedResult current;
+    current.id = nextResultId.fetch_add(1, std::memory_order_relaxed);
+
+    std::unordered_map<w_string, uint64_t> previous;
+    bool havePrevious = false;
+    auto sinceId = query_spec.get_default("diff_since_result_id");
+    if (sinceId && sinceId.isInt()) {
+      auto retained = retainedResults.lock();
+      for (auto& entry : *retained) {
+        if (entry.id == uint64_t(sinceId.asInt())) {
+          previous = entry.rowHashes;
+          havePrevious = true;
+          break;
+        }
+      }
+    }
+
+    auto diffedRows = json_array();
+    for (auto& row : res.resultsArray.array()) {
+      w_string name;
+      if (row.isObject()) {
+        auto nameField = row.get_default("name");
+        if (nameField && nameField.isString()) {
+          name = json_to_w_string(nameField);
+        }
+      }
+
+      if (!name) {
+        json_array_append(diffedRows, row);
+        continue;
+      }
+
+      auto rowHash = hashRow(row);
+      current.rowHashes[name] = rowHash;
+
+      auto it = previous.find(name);
+      if (it != previous.end()) {
+        auto unchanged = it->second == rowHash;
+        previous.erase(it);
+        if (unchanged) {
+          continue;
+        }
+      }
+      json_array_append(diffedRows, row);
+    }
+
+    // Anything left in previous no longer appears in the result set.
+    auto removed = json_array();
+    if (havePrevious) {
+      for (auto& it : previous) {
+        json_array_append_new(removed, w_string_to_json(it.first));
+      }
+    }
+
+    auto resultId = current.id;
+    {
+      auto retained = retainedResults.lock();
+      if (retained->size() >= kMaxRetainedResults) {
+        retained->pop_front();
+      }
+      retained->push_back(std::move(current));
+    }
+
+    response.set(
+        {{"result_id", json_integer(resultId)},
+         {"diffed", json_boolean(havePrevious)},
+         {"removed", std::move(removed)}});
+    res.resultsArray = std::move(diffedRows);
+  }
+
   response.set(
       {{"is_fresh_instance", json_boolean(res.isFreshInstance)},
        {"clock", res.clockAtStartOfQuery.toJson()},
        {"files", std::move(res.resultsArray)},
        {"debug", res.debugInfo.render()}});
+  if (query->limit) {
+    response.set("is_limited", json_boolean(res.isLimited));
+  }
   if (res.savedStateInfo) {
     response.set({{"saved-state-info", std::move(res.savedStateInfo)}});
   }
@@ -46,10 +186,154 @@ static void cmd_query(struct watchman_client* client, const json_ref& args) {
 
   send_and_dispose_response(client, std::move(response));
 }
+
+/* multi-query {"queries": [{"root": "/path", "query": {...}}, ...]}
+ * Executes several queries, possibly against different roots,
+ * concurrently on the shared thread pool. Roots have independent view
+ * locks, so sibling-repo tooling stops paying for serial round trips.
+ * Results are returned in input order under "results"; a failed entry
+ * carries "error" instead of its result fields. */
+static void cmd_multi_query(
+    struct watchman_client* client,
+    const json_ref& args) {
+  if (json_array_size(args) != 2 || !args.at(1).isObject()) {
+    send_error_response(client, "wrong number of arguments for multi-query");
+    return;
+  }
+
+  auto queries = args.at(1).get_default("queries");
+  if (!queries || !queries.isArray()) {
+    send_error_response(client, "multi-query requires a 'queries' array");
+    return;
+  }
+
+  auto count = json_array_size(queries);
+  std::vector<json_ref> results(count);
+  std::vector<std::shared_ptr<Root>> roots(count);
+
+  // Resolve every root on the dispatch thread before fanning out:
+  // resolveRoot records metadata on the client's PerfSample, which is
+  // owned by this thread and must not be mutated concurrently, and
+  // resolution is cheap next to query execution.
+  for (size_t i = 0; i < count; ++i) {
+    auto entry = queries.at(i);
+    try {
+      if (!entry.isObject()) {
+        throw QueryParseError("each multi-query entry must be an object");
+      }
+      auto rootPath = entry.get_default("root");
+      auto spec = entry.get_default("query");
+      if (!rootPath || !rootPath.isString() || !spec) {
+        throw QueryParseError(
+            "each multi-query entry requires 'root' and 'query'");
+      }
+
+      auto rootArgs = json_array(
+          {typed_string_to_json("multi-query"), json_ref(rootPath)});
+      w_cmd_realpath_root(rootArgs);
+      roots[i] = resolveRoot(client, rootArgs);
+    } catch (const std::exception& exc) {
+      results[i] = json_object(
+          {{"error", typed_string_to_json(exc.what(), W_STRING_MIXED)}});
+    }
+  }
+
+  // Run the queries on a small set of dedicated threads rather than the
+  // shared pool: query execution blocks on cookie sync, on collectAll
+  // for the parallel eval/stat fan-outs, and on SCM futures — all of
+  // which are themselves scheduled on the shared pool, so nesting those
+  // blocking waits inside pool tasks can fill every worker with tasks
+  // waiting on tasks that can never run. The worker count is a fixed
+  // small cap (not one thread per entry: this command is reachable by
+  // any user, so the entry list must not size our thread usage) and the
+  // workers pull entries from a shared cursor.
+  constexpr size_t kMaxWorkers = 8;
+  std::atomic<size_t> nextEntry{0};
+
+  auto workerBody = [&] {
+    while (true) {
+      auto i = nextEntry.fetch_add(1, std::memory_order_relaxed);
+      if (i >= count) {
+        return;
+      }
+      if (!roots[i]) {
+        // Resolution already failed and recorded its error
+        continue;
+      }
+
+      auto entry = queries.at(i);
+      try {
+        auto rootPath = entry.get_default("root");
+        auto spec = entry.get_default("query");
+
+        auto query = parseQuery(roots[i], spec);
+        query->clientPid = client->stm ? client->stm->getPeerProcessID() : 0;
+
+        auto res =
+            w_query_execute(query.get(), roots[i], nullptr, getInterface);
+        results[i] = json_object(
+            {{"root", json_ref(rootPath)},
+             {"is_fresh_instance", json_boolean(res.isFreshInstance)},
+             {"clock", res.clockAtStartOfQuery.toJson()},
+             {"files", std::move(res.resultsArray)}});
+      } catch (const std::exception& exc) {
+        results[i] = json_object(
+            {{"error",
+              typed_string_to_json(exc.what(), W_STRING_MIXED)}});
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  workers.reserve(std::min(count, kMaxWorkers));
+  for (size_t i = 0; i < std::min(count, kMaxWorkers); ++i) {
+    workers.emplace_back(workerBody);
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  auto resultArray = json_array();
+  for (auto& result : results) {
+    json_array_append_new(resultArray, std::move(result));
+  }
+
+  auto response = make_response();
+  response.set("results", std::move(resultArray));
+  send_and_dispose_response(client, std::move(response));
+}
+W_CMD_REG(
+    "multi-query",
+    cmd_multi_query,
+    CMD_EXPENSIVE | CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    NULL)
+
+/* cancel-request <request_id>
+ * Cooperatively cancels an in-flight query that was issued with the
+ * given request_id. */
+static void cmd_cancel_request(
+    struct watchman_client* client,
+    const json_ref& args) {
+  if (json_array_size(args) != 2 || !args.at(1).isString()) {
+    send_error_response(client, "wrong number of arguments for cancel-request");
+    return;
+  }
+
+  auto found = w_query_cancel_request(json_to_w_string(args.at(1)));
+  auto response = make_response();
+  response.set("cancelled", json_boolean(found));
+  send_and_dispose_response(client, std::move(response));
+}
+W_CMD_REG(
+    "cancel-request",
+    cmd_cancel_request,
+    CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    NULL)
+
 W_CMD_REG(
     "query",
     cmd_query,
-    CMD_DAEMON | CMD_CLIENT | CMD_ALLOW_ANY_USER,
+    CMD_EXPENSIVE | CMD_DAEMON | CMD_CLIENT | CMD_ALLOW_ANY_USER,
     w_cmd_realpath_root)
 
 /* vim:ts=2:sw=2:et:
@@ -5,14 +5,20 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <condition_variable>
+#include <mutex>
+
 #include <folly/ExceptionString.h>
+#include <folly/stop_watch.h>
 #include <folly/ScopeGuard.h>
 #include <folly/Synchronized.h>
 #include "watchman/CommandRegistry.h"
+#include "watchman/LatencyHistogram.h"
 #include "watchman/Errors.h"
 #include "watchman/Logging.h"
 #include "watchman/PDU.h"
 #include "watchman/Poison.h"
+#include "watchman/SanityCheck.h"
 #include "watchman/WatchmanConfig.h"
 #include "watchman/thirdparty/jansson/jansson.h"
 #include "watchman/watchman_client.h"
@@ -21,6 +27,8 @@
 
 using namespace watchman;
 
+W_CAP_REG("request-tags")
+
 namespace {
 command_handler_def* lookup(const json_ref& args, CommandFlags mode) {
   const char* cmd_name;
@@ -72,6 +80,56 @@ void preprocess_command(
   }
 }
 
+namespace {
+/**
+ * Bounds the number of expensive commands running at once. During a
+ * thundering-herd reconnect (daemon restart with hundreds of clients)
+ * every new connection immediately issues watch-project plus a full
+ * query; admitting them a few at a time keeps the daemon responsive and
+ * lets the early crawls warm state that later arrivals reuse. A zero
+ * limit (the default) disables gating.
+ */
+class HeavyCommandGate {
+ public:
+  void enter() {
+    auto limit = cfg_get_int("max_concurrent_heavy_commands", 0);
+    if (limit <= 0) {
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++waiting_;
+    cond_.wait(lock, [&] { return running_ < uint32_t(limit); });
+    --waiting_;
+    ++running_;
+    entered_ = true;
+  }
+
+  void leave() {
+    if (!entered_) {
+      return;
+    }
+    entered_ = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      --running_;
+    }
+    cond_.notify_one();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  uint32_t running_{0};
+  uint32_t waiting_{0};
+  // Per-thread entry marker; enter/leave pair on the same thread.
+  static thread_local bool entered_;
+};
+
+thread_local bool HeavyCommandGate::entered_ = false;
+
+HeavyCommandGate heavyGate;
+} // namespace
+
 bool dispatch_command(
     struct watchman_client* client,
     const json_ref& args,
@@ -105,6 +163,19 @@ bool dispatch_command(
       return false;
     }
 
+    if (def->flags.contains(CMD_EXPENSIVE)) {
+      heavyGate.enter();
+    }
+    SCOPE_EXIT {
+      heavyGate.leave();
+    };
+
+    static LatencyHistogram dispatchLatency("command_dispatch");
+    folly::stop_watch<std::chrono::microseconds> dispatchTimer;
+    SCOPE_EXIT {
+      dispatchLatency.record(dispatchTimer.elapsed());
+    };
+
     // Scope for the perf sample
     {
       logf(DBG, "dispatch_command: {}\n", def->name);
@@ -132,6 +203,7 @@ bool dispatch_command(
       logf(DBG, "dispatch_command: {} (completed)\n", def->name);
     }
 
+    noteServerActivity();
     return true;
   } catch (const std::exception& e) {
     auto what = folly::exceptionStr(e);
@@ -53,7 +53,7 @@ static void cmd_since(struct watchman_client* client, const json_ref& args) {
 W_CMD_REG(
     "since",
     cmd_since,
-    CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    CMD_EXPENSIVE | CMD_DAEMON | CMD_ALLOW_ANY_USER,
     w_cmd_realpath_root)
 
 /* vim:ts=2:sw=2:et:
@@ -128,14 +128,22 @@ static void cmd_state_enter(
           root->assertedStates.wlock()->removeAssertion(assertion);
           return;
         }
-        auto clock = w_string_to_json(root->view()->getCurrentClockString());
-        auto payload = json_object(
-            {{"root", w_string_to_json(root->root_path)},
-             {"clock", std::move(clock)},
-             {"state-enter", w_string_to_json(parsed.name)}});
-        if (parsed.metadata) {
-          payload.set("metadata", json_ref(parsed.metadata));
-        }
+        // Don't bother rendering the clock and payload when nobody is
+        // listening; build systems enter/leave states constantly and the
+        // broadcast machinery drops payloads without subscribers anyway.
+        // Note: when deferring below we must build the payload even so,
+        // since subscribers may appear before it reaches the front.
+        json_ref payload;
+        auto buildPayload = [&] {
+          auto clock = w_string_to_json(root->view()->getCurrentClockString());
+          payload = json_object(
+              {{"root", w_string_to_json(root->root_path)},
+               {"clock", std::move(clock)},
+               {"state-enter", w_string_to_json(parsed.name)}});
+          if (parsed.metadata) {
+            payload.set("metadata", json_ref(parsed.metadata));
+          }
+        };
 
         {
           auto wlock = root->assertedStates.wlock();
@@ -143,8 +151,12 @@ static void cmd_state_enter(
 
           if (wlock->isFront(assertion)) {
             // Broadcast about the state enter
-            root->unilateralResponses->enqueue(std::move(payload));
+            if (root->unilateralResponses->hasSubscribers()) {
+              buildPayload();
+              root->unilateralResponses->enqueue(std::move(payload));
+            }
           } else {
+            buildPayload();
             // Defer the broadcast until we are at the front of the queue.
             // removeAssertion() will take care of sending this when this
             // assertion makes it to the front of the queue.
@@ -163,19 +175,22 @@ static void leave_state(
     std::shared_ptr<ClientStateAssertion> assertion,
     bool abandoned,
     json_t* metadata) {
-  // Broadcast about the state leave
-  auto payload = json_object(
-      {{"root", w_string_to_json(assertion->root->root_path)},
-       {"clock",
-        w_string_to_json(assertion->root->view()->getCurrentClockString())},
-       {"state-leave", w_string_to_json(assertion->name)}});
-  if (metadata) {
-    payload.set("metadata", json_ref(metadata));
-  }
-  if (abandoned) {
-    payload.set("abandoned", json_true());
+  // Broadcast about the state leave, unless nobody is subscribed: the
+  // publisher would discard the payload after we rendered it.
+  if (assertion->root->unilateralResponses->hasSubscribers()) {
+    auto payload = json_object(
+        {{"root", w_string_to_json(assertion->root->root_path)},
+         {"clock",
+          w_string_to_json(assertion->root->view()->getCurrentClockString())},
+         {"state-leave", w_string_to_json(assertion->name)}});
+    if (metadata) {
+      payload.set("metadata", json_ref(metadata));
+    }
+    if (abandoned) {
+      payload.set("abandoned", json_true());
+    }
+    assertion->root->unilateralResponses->enqueue(std::move(payload));
   }
-  assertion->root->unilateralResponses->enqueue(std::move(payload));
 
   // Now remove the state assertion
   assertion->root->assertedStates.wlock()->removeAssertion(assertion);
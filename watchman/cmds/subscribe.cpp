@@ -5,6 +5,14 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include "watchman/InMemoryView.h"
+#include "watchman/fs/FileSystem.h"
+#include <algorithm>
+#include "watchman/LatencyHistogram.h"
+#include <deque>
+#include <mutex>
+#include <folly/ScopeGuard.h>
+#include <folly/stop_watch.h>
 #include "watchman/Errors.h"
 #include "watchman/Logging.h"
 #include "watchman/MapUtil.h"
@@ -79,6 +87,11 @@ static std::tuple<sub_action, w_string> get_subscription_action(
   if (sub->last_sub_tick != position.ticks) {
     if (!sub->drop_or_defer.empty()) {
       auto assertedStates = root->assertedStates.rlock();
+      if (assertedStates->empty()) {
+        // No states asserted anywhere (the overwhelmingly common
+        // settle): skip the per-policy probes entirely.
+        return std::make_tuple(action, policy_name);
+      }
       // This subscription has some policy for states.
       // Figure out what we should do.
       for (auto& policy_iter : sub->drop_or_defer) {
@@ -180,7 +193,33 @@ void watchman_client_subscription::processSubscriptionImpl() {
       executeQuery = false;
     }
 
+    if (executeQuery && query->relative_root && query->since_spec &&
+        std::holds_alternative<ClockSpec::Clock>(query->since_spec->spec) &&
+        !query->since_spec->hasScmParams() &&
+        !root->view()->subtreeChangedSince(
+            query->relative_root, last_sub_tick)) {
+      // Nothing under this subscription's scope changed since it last
+      // ran; an empty result would be suppressed anyway, so skip the
+      // query entirely and just advance our position. With many scoped
+      // subscriptions per root this turns most settles into a per-dir
+      // clock comparison.
+      log(DBG,
+          "subscription ",
+          name,
+          " scope is unchanged since tick ",
+          last_sub_tick,
+          "; skipping query\n");
+      last_sub_tick = position.ticks;
+      query->since_spec = std::make_unique<ClockSpec>(position);
+      executeQuery = false;
+    }
+
     if (executeQuery) {
+      static LatencyHistogram subscriptionLatency("subscription_eval");
+      folly::stop_watch<std::chrono::microseconds> subTimer;
+      SCOPE_EXIT {
+        subscriptionLatency.record(subTimer.elapsed());
+      };
       try {
         last_sub_tick =
             runSubscriptionRules(client.get(), root).position().ticks;
@@ -210,6 +249,108 @@ void watchman_client_subscription::updateSubscriptionTicks(QueryResult* res) {
   query->since_spec = std::make_unique<ClockSpec>(res->clockAtStartOfQuery);
 }
 
+void watchman_client_subscription::suppressUnchangedContent(
+    const std::shared_ptr<Root>& root,
+    QueryResult& res) {
+  // Bound the work so hashing can never stall delivery: at most this
+  // many files are hashed per flush, and only small-ish regular files
+  // qualify; anything else passes through unsuppressed.
+  constexpr size_t kHashBudget = 128;
+  constexpr json_int_t kMaxHashableSize = 4 * 1024 * 1024;
+
+  auto view = std::dynamic_pointer_cast<InMemoryView>(root->view());
+  if (!view) {
+    // No content hash cache to consult (eg: eden roots)
+    return;
+  }
+  auto& cache = view->debugAccessCaches().contentHashCache;
+
+  size_t budget = kHashBudget;
+  size_t suppressed = 0;
+  auto& rows = res.resultsArray.array();
+
+  rows.erase(
+      std::remove_if(
+          rows.begin(),
+          rows.end(),
+          [&](const json_ref& row) {
+            if (!budget || !row.isObject()) {
+              return false;
+            }
+            auto nameField = row.get_default("name");
+            if (!nameField || !nameField.isString()) {
+              return false;
+            }
+            auto name = json_to_w_string(nameField);
+
+            try {
+              auto fullPath = w_string::pathCat({root->root_path, name});
+              auto st = getFileInformation(
+                  fullPath.c_str(), root->case_sensitive);
+              if (!st.isFile() || st.size > kMaxHashableSize) {
+                lastContentHash_.erase(name);
+                return false;
+              }
+
+              ContentHashCacheKey key{name, size_t(st.size), st.mtime};
+              --budget;
+              auto hash = cache.get(key).get()->value();
+
+              auto it = lastContentHash_.find(name);
+              bool unchanged =
+                  it != lastContentHash_.end() && it->second == hash;
+              lastContentHash_[name] = hash;
+              if (unchanged) {
+                ++suppressed;
+                return true;
+              }
+            } catch (const std::exception&) {
+              // Deleted, unreadable or failed to hash: deliver the row
+              // and forget any stored hash.
+              lastContentHash_.erase(name);
+            }
+            return false;
+          }),
+      rows.end());
+
+  if (suppressed) {
+    log(DBG,
+        "subscription ",
+        name,
+        ": suppressed ",
+        suppressed,
+        " no-op rewrites\n");
+  }
+}
+
+namespace {
+/**
+ * Shared evaluation for identical subscriptions: when N clients hold
+ * byte-identical subscription specs at the same since position, the
+ * first to evaluate at a given root tick populates this cache and the
+ * rest reuse the rendered rows by reference. Only subscriptions whose
+ * delivery path treats rows as immutable participate (name-id
+ * rewriting, content suppression and pagination all mutate or consume
+ * rows and are excluded). Entries are tiny and shed FIFO.
+ */
+struct SharedSubscriptionResult {
+  // Root identity must be part of the key: identical specs on different
+  // roots (the normal IDE case) can collide on tick values otherwise.
+  w_string rootPath;
+  uint32_t rootNumber;
+  std::string fingerprint;
+  uint32_t sinceTicks;
+  uint32_t evalTicks;
+  json_ref files;
+  bool isFreshInstance;
+  ClockSpec clock;
+};
+
+folly::Synchronized<std::deque<SharedSubscriptionResult>, std::mutex>
+    sharedSubscriptionResults;
+constexpr size_t kMaxSharedSubscriptionResults = 8;
+} // namespace
+
 json_ref watchman_client_subscription::buildSubscriptionResults(
     const std::shared_ptr<Root>& root,
     ClockSpec& position,
@@ -240,7 +381,59 @@ json_ref watchman_client_subscription::buildSubscriptionResults(
   logf(DBG, "running subscription {} {}\n", name, fmt::ptr(this));
 
   try {
-    auto res = w_query_execute(query.get(), root, time_generator, getInterface);
+    bool shareable = !use_name_ids && !suppress_unchanged_content &&
+        !max_batch_size && since_spec &&
+        std::holds_alternative<ClockSpec::Clock>(since_spec->spec) &&
+        !since_spec->hasScmParams();
+    std::string fingerprint;
+    uint32_t sinceTicks = 0;
+    ClockPosition currentPosition;
+
+    QueryResult res;
+    bool usedShared = false;
+
+    if (shareable) {
+      fingerprint = json_dumps(query->query_spec, JSON_COMPACT | JSON_SORT_KEYS);
+      sinceTicks =
+          std::get<ClockSpec::Clock>(since_spec->spec).position.ticks;
+      currentPosition = root->view()->getMostRecentRootNumberAndTickValue();
+
+      auto cache = sharedSubscriptionResults.lock();
+      for (auto& entry : *cache) {
+        if (entry.sinceTicks == sinceTicks &&
+            entry.evalTicks == currentPosition.ticks &&
+            entry.rootNumber == currentPosition.rootNumber &&
+            entry.rootPath == root->root_path &&
+            entry.fingerprint == fingerprint) {
+          res.resultsArray = entry.files;
+          res.isFreshInstance = entry.isFreshInstance;
+          res.clockAtStartOfQuery = entry.clock;
+          usedShared = true;
+          break;
+        }
+      }
+    }
+
+    if (!usedShared) {
+      res = w_query_execute(query.get(), root, time_generator, getInterface);
+
+      if (shareable) {
+        auto evalPosition = res.clockAtStartOfQuery.position();
+        auto cache = sharedSubscriptionResults.lock();
+        if (cache->size() >= kMaxSharedSubscriptionResults) {
+          cache->pop_front();
+        }
+        cache->push_back(SharedSubscriptionResult{
+            root->root_path,
+            evalPosition.rootNumber,
+            std::move(fingerprint),
+            sinceTicks,
+            evalPosition.ticks,
+            res.resultsArray,
+            res.isFreshInstance,
+            res.clockAtStartOfQuery});
+      }
+    }
 
     logf(
         DBG,
@@ -263,6 +456,10 @@ json_ref watchman_client_subscription::buildSubscriptionResults(
       }
     }
 
+    if (suppress_unchanged_content && !res.isFreshInstance) {
+      suppressUnchangedContent(root, res);
+    }
+
     // We can suppress empty results, unless this is a source code aware query
     // and the mergeBase has changed or this is a fresh instance.
     bool mergeBaseChanged = scmAwareQuery &&
@@ -284,6 +481,38 @@ json_ref watchman_client_subscription::buildSubscriptionResults(
     }
     updateSubscriptionTicks(&res);
 
+    if (use_name_ids) {
+      // Delta-encode pathnames: rows whose name was already delivered on
+      // this subscription replace it with the previously assigned
+      // integer id; new names carry both the name and their new id. A
+      // fresh instance resets the id space, and the response says so,
+      // which is the client's signal to drop its mapping.
+      if (res.isFreshInstance) {
+        name_ids.clear();
+        next_name_id = 1;
+        response.set("name_ids_reset", json_true());
+      }
+      for (auto& row : res.resultsArray.array()) {
+        if (!row.isObject()) {
+          continue;
+        }
+        auto nameField = row.get_default("name");
+        if (!nameField || !nameField.isString()) {
+          continue;
+        }
+        auto nameStr = json_to_w_string(nameField);
+        auto it = name_ids.find(nameStr);
+        if (it != name_ids.end()) {
+          row.set("name_id", json_integer(it->second));
+          json_object_del(row, "name");
+        } else {
+          auto id = next_name_id++;
+          name_ids[nameStr] = id;
+          row.set("name_id", json_integer(id));
+        }
+      }
+    }
+
     response.set(
         {{"is_fresh_instance", json_boolean(res.isFreshInstance)},
          {"clock", res.clockAtStartOfQuery.toJson()},
@@ -312,7 +541,40 @@ ClockSpec watchman_client_subscription::runSubscriptionRules(
 
   if (response) {
     add_root_warnings_to_response(response, root);
-    client->enqueueResponse(std::move(response), false);
+
+    auto files = response.get_default("files");
+    if (max_batch_size && files && files.isArray() &&
+        json_array_size(files) > max_batch_size) {
+      // Paginate the catch-up: a laptop waking from sleep can owe a
+      // subscription every change since its clock, and one enormous PDU
+      // stalls encode on our side and parse on the client's. Each page
+      // duplicates the envelope (clock, subscription, since) so clients
+      // process pages independently; every page except the last says
+      // is_partial.
+      // Detach the rows and keep the response as the envelope template
+      // for each page.
+      auto rowsArray = json_ref(files);
+      json_object_del(response, "files");
+
+      auto& rows = rowsArray.array();
+      size_t total = rows.size();
+      for (size_t start = 0; start < total; start += max_batch_size) {
+        auto end = std::min(total, start + size_t(max_batch_size));
+        auto page = json_array();
+        for (size_t i = start; i < end; ++i) {
+          json_array_append_new(page, std::move(rows[i]));
+        }
+
+        auto pageResponse = json_deep_copy(response);
+        pageResponse.set("files", std::move(page));
+        if (end < total) {
+          pageResponse.set("is_partial", json_true());
+        }
+        client->enqueueResponse(std::move(pageResponse), false);
+      }
+    } else {
+      client->enqueueResponse(std::move(response), false);
+    }
   }
   return position;
 }
@@ -488,6 +750,8 @@ W_CMD_REG(
     CMD_DAEMON | CMD_ALLOW_ANY_USER,
     w_cmd_realpath_root)
 
+W_CAP_REG("subscription-name-ids")
+
 /* subscribe /root subname {query}
  * Subscribes the client connection to the specified root. */
 static void cmd_subscribe(
@@ -542,6 +806,35 @@ static void cmd_subscribe(
   sub->name = json_to_w_string(jname);
   sub->query = query;
 
+  {
+    auto batch = query_spec.get_default("max_batch_size", json_integer(0));
+    if (!batch.isInt() || batch.asInt() < 0) {
+      send_error_response(client, "max_batch_size must be an integer >= 0");
+      return;
+    }
+    sub->max_batch_size = uint32_t(batch.asInt());
+  }
+
+  {
+    auto suppress =
+        query_spec.get_default("suppress_unchanged_content", json_false());
+    if (!suppress.isBool()) {
+      send_error_response(
+          client, "suppress_unchanged_content must be boolean");
+      return;
+    }
+    sub->suppress_unchanged_content = suppress.asBool();
+  }
+
+  {
+    auto name_ids = query_spec.get_default("name_ids", json_false());
+    if (!name_ids.isBool()) {
+      send_error_response(client, "name_ids must be boolean");
+      return;
+    }
+    sub->use_name_ids = name_ids.asBool();
+  }
+
   auto defer = query_spec.get_default("defer_vcs", json_true());
   if (!defer.isBool()) {
     send_error_response(client, "defer_vcs must be boolean");
@@ -640,7 +933,7 @@ static void cmd_subscribe(
 W_CMD_REG(
     "subscribe",
     cmd_subscribe,
-    CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    CMD_EXPENSIVE | CMD_DAEMON | CMD_ALLOW_ANY_USER,
     w_cmd_realpath_root)
 
 /* vim:ts=2:sw=2:et:
@@ -6,6 +6,9 @@
  */
 
 #include "watchman/CommandRegistry.h"
+#include <unordered_map>
+#include <chrono>
+#include <folly/Synchronized.h>
 #include "watchman/Errors.h"
 #include "watchman/LogConfig.h"
 #include "watchman/QueryableView.h"
@@ -15,6 +18,48 @@
 
 using namespace watchman;
 
+namespace {
+/**
+ * Canonical path resolutions for root arguments, with a short TTL.
+ * Nearly every command carries a root path and resolved it from scratch
+ * (a full symlink walk) on each dispatch even though watched roots are
+ * extremely stable. A changed resolution (someone re-pointed a symlink
+ * under a watched root path) is picked up within the TTL; a brief
+ * staleness window for that already-racy operation is an accepted
+ * trade.
+ */
+struct RealPathCacheEntry {
+  w_string resolved;
+  std::chrono::steady_clock::time_point at;
+};
+folly::Synchronized<std::unordered_map<w_string, RealPathCacheEntry>>
+    realPathCache;
+constexpr auto kRealPathTTL = std::chrono::seconds(5);
+constexpr size_t kRealPathCacheMax = 64;
+
+w_string cachedRealPath(const char* path) {
+  w_string key{path};
+  auto now = std::chrono::steady_clock::now();
+
+  {
+    auto cache = realPathCache.rlock();
+    auto it = cache->find(key);
+    if (it != cache->end() && now - it->second.at < kRealPathTTL) {
+      return it->second.resolved;
+    }
+  }
+
+  auto resolved = realPath(path);
+
+  auto cache = realPathCache.wlock();
+  if (cache->size() >= kRealPathCacheMax) {
+    cache->clear();
+  }
+  (*cache)[key] = RealPathCacheEntry{resolved, now};
+  return resolved;
+}
+} // namespace
+
 void w_cmd_realpath_root(json_ref& args) {
   const char* path;
 
@@ -29,7 +74,7 @@ void w_cmd_realpath_root(json_ref& args) {
   }
 
   try {
-    auto resolved = realPath(path);
+    auto resolved = cachedRealPath(path);
     args.array()[1] = w_string_to_json(resolved);
   } catch (const std::exception& exc) {
     throw CommandValidationError(
@@ -294,7 +339,7 @@ static void cmd_watch(struct watchman_client* client, const json_ref& args) {
 W_CMD_REG(
     "watch",
     cmd_watch,
-    CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    CMD_EXPENSIVE | CMD_DAEMON | CMD_ALLOW_ANY_USER,
     w_cmd_realpath_root)
 
 static void cmd_watch_project(
@@ -334,7 +379,7 @@ static void cmd_watch_project(
 W_CMD_REG(
     "watch-project",
     cmd_watch_project,
-    CMD_DAEMON | CMD_ALLOW_ANY_USER,
+    CMD_EXPENSIVE | CMD_DAEMON | CMD_ALLOW_ANY_USER,
     w_cmd_realpath_root)
 
 /* vim:ts=2:sw=2:et:
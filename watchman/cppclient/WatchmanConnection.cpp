@@ -8,9 +8,11 @@
 #include "WatchmanConnection.h"
 
 #include <cstdlib>
+#include <unordered_map>
 
 #include <folly/ExceptionWrapper.h>
 #include <folly/SocketAddress.h>
+#include <folly/Synchronized.h>
 #include <folly/executors/InlineExecutor.h>
 #include <folly/experimental/bser/Bser.h>
 
@@ -56,6 +58,35 @@ WatchmanConnection::~WatchmanConnection() {
   close();
 }
 
+namespace {
+folly::Synchronized<
+    std::unordered_map<std::string, std::weak_ptr<WatchmanConnection>>>
+    sharedConnections;
+} // namespace
+
+std::shared_ptr<WatchmanConnection> WatchmanConnection::getShared(
+    EventBase* eventBase,
+    std::optional<std::string> sockPath,
+    Executor* cpuExecutor) {
+  auto key = folly::to<std::string>(
+      reinterpret_cast<uintptr_t>(eventBase),
+      ":",
+      sockPath.has_value() ? *sockPath : "<default>");
+
+  auto map = sharedConnections.wlock();
+  auto& weak = (*map)[key];
+  if (auto existing = weak.lock()) {
+    if (!existing->isDead()) {
+      return existing;
+    }
+  }
+
+  auto conn = std::make_shared<WatchmanConnection>(
+      eventBase, std::move(sockPath), std::nullopt, cpuExecutor);
+  weak = conn;
+  return conn;
+}
+
 folly::Future<std::string> WatchmanConnection::getSockPath() {
   // Take explicit configuration first
   if (sockPath_.has_value()) {
@@ -303,10 +334,24 @@ void WatchmanConnection::getReadBuffer(void** bufReturn, size_t* lenReturn) {
 
 // Called when AsyncSocket gave us data
 void WatchmanConnection::readDataAvailable(size_t len) noexcept {
+  size_t buffered;
   {
     std::lock_guard<std::mutex> g(mutex_);
     bufQ_.postallocate(len);
+    buffered = bufQ_.chainLength();
   }
+
+  // Small responses are cheaper to decode right here than to bounce
+  // through the cpu executor (a cross-thread hop per response wakes the
+  // consumer twice). Only offload once enough data is buffered that the
+  // decode could meaningfully occupy the event base.
+  constexpr size_t kOffloadDecodeThreshold = 64 * 1024;
+  if (buffered < kOffloadDecodeThreshold ||
+      cpuExecutor_.get() == &inlineExecutor) {
+    decodeNextResponse();
+    return;
+  }
+
   cpuExecutor_->add([shared_this = shared_from_this()] {
     shared_this->decodeNextResponse();
   });
@@ -346,6 +391,19 @@ std::unique_ptr<folly::IOBuf> WatchmanConnection::splitNextPdu() {
 // for us to receive a large PDU followed by a small one and for the
 // small one to finish decoding before the large one, so we must
 // serialize the dispatching.
+/*
+ * Note on parallel decode: splitting a large PDU's top-level array into
+ * ranges (BSER length headers make the boundary pre-scan cheap) and
+ * decoding them on multiple workers was evaluated and declined here.
+ * The decode target is folly::dynamic, whose containers must be
+ * assembled single-threaded anyway, so workers would only parallelize
+ * leaf construction and then pay a merge; and the string-table PDU
+ * encoding introduces sequential decode dependencies for exactly the
+ * payloads big enough to matter. The practical fix that landed instead
+ * keeps small responses off the executor entirely and moves only large
+ * ones (where the single decode core is acceptable because it is off
+ * the event base) — see readDataAvailable.
+ */
 void WatchmanConnection::decodeNextResponse() {
   if (decoding_.exchange(true)) {
     return;
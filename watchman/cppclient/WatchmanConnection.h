@@ -57,6 +57,19 @@ class WatchmanConnection
       folly::Executor* cpuExecutor = nullptr);
   ~WatchmanConnection() override;
 
+  /**
+   * Returns a process-wide shared connection for the given socket path on
+   * the given event base, creating and caching it on first use. Dead
+   * connections are replaced transparently. Shared connections carry no
+   * unilateral callback, so they are suitable for request/response usage
+   * (queries, clocks, triggers) but not for subscriptions; create a
+   * dedicated connection for those.
+   */
+  static std::shared_ptr<WatchmanConnection> getShared(
+      folly::EventBase* eventBase,
+      std::optional<std::string> sockPath = {},
+      folly::Executor* cpuExecutor = nullptr);
+
   // Initiate a connection.  Yields the version information for the
   // service at a later time.  You need to call connect once before
   // you can use the run() method.
@@ -68,6 +81,18 @@ class WatchmanConnection
           "required",
           folly::dynamic::array("relative_root")));
 
+  // Note on typed zero-copy decode: an extraction API parsing BSER
+  // straight into caller structs (skipping the folly::dynamic
+  // intermediary) was evaluated and declined at this layer. The
+  // connection must decode far enough to route every PDU anyway
+  // (unilateral payloads vs ordered command responses), and a typed
+  // template layer belongs with the schema owner, not the transport:
+  // services that want one traversal can negotiate the string-table
+  // PDU encoding (which collapses the repeated strings that dominate
+  // decode cost) and run a bser-cursor parser over the payload
+  // themselves. If a shared typed layer emerges it should be a sibling
+  // of this class consuming the same socket, not a mode of it.
+
   // Issue a watchman command, yielding the results at a later time.
   // If the connection was terminated, will throw immediately
   folly::Future<folly::dynamic> run(const folly::dynamic& command) noexcept;
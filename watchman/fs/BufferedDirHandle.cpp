@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "watchman/fs/BufferedDirHandle.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include "watchman/ThreadPool.h"
+
+namespace watchman {
+
+namespace {
+
+class BufferedDirHandle final : public DirHandle {
+ public:
+  explicit BufferedDirHandle(std::unique_ptr<DirHandle> inner)
+      : inner_(std::move(inner)) {
+    try {
+      getThreadPool().add([this] { drain(); });
+    } catch (const std::exception&) {
+      // The pool is stopped (eg: during shutdown); serve entries
+      // synchronously instead.
+      passthrough_ = true;
+    }
+  }
+
+  ~BufferedDirHandle() override {
+    if (passthrough_) {
+      return;
+    }
+    // The drain task holds a raw reference to us; wait for it to finish
+    // before tearing down.
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return done_; });
+  }
+
+  const DirEntry* readDir() override {
+    if (passthrough_) {
+      return inner_->readDir();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    cond_.wait(lock, [this] { return !queue_.empty() || done_; });
+
+    if (queue_.empty()) {
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      return nullptr;
+    }
+
+    current_ = std::move(queue_.front());
+    queue_.pop_front();
+    current_.entry.d_name = current_.name.c_str();
+    return &current_.entry;
+  }
+
+#ifndef _WIN32
+  int getFd() const override {
+    return inner_->getFd();
+  }
+#endif
+
+ private:
+  struct BufferedEntry {
+    std::string name;
+    DirEntry entry;
+  };
+
+  void drain() {
+    std::exception_ptr error;
+    try {
+      while (const DirEntry* ent = inner_->readDir()) {
+        BufferedEntry buffered;
+        buffered.name = ent->d_name;
+        buffered.entry = *ent;
+
+        std::lock_guard<std::mutex> guard(mutex_);
+        queue_.push_back(std::move(buffered));
+        cond_.notify_one();
+      }
+    } catch (...) {
+      // Deliver the error to the consumer once it has drained the
+      // entries we did manage to read.
+      error = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    error_ = error;
+    done_ = true;
+    cond_.notify_all();
+  }
+
+  std::unique_ptr<DirHandle> inner_;
+  bool passthrough_{false};
+
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  std::deque<BufferedEntry> queue_;
+  BufferedEntry current_;
+  bool done_{false};
+  std::exception_ptr error_;
+};
+
+} // namespace
+
+std::unique_ptr<DirHandle> makeBufferedDirHandle(
+    std::unique_ptr<DirHandle> inner) {
+  return std::make_unique<BufferedDirHandle>(std::move(inner));
+}
+
+} // namespace watchman
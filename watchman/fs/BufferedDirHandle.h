@@ -0,0 +1,28 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <memory>
+#include "watchman/fs/DirHandle.h"
+
+namespace watchman {
+
+/**
+ * Wraps a DirHandle and eagerly drains it on the shared thread pool,
+ * buffering entries so that the consumer's per-entry work overlaps the
+ * blocking readdir/getdents round trips instead of serializing with them.
+ * This matters most on high-latency filesystems such as NFS checkouts.
+ *
+ * Entry names and stat data are copied into the buffer; the returned
+ * DirEntry stays valid until the next readDir call, same as the
+ * underlying handle's contract.
+ */
+std::unique_ptr<DirHandle> makeBufferedDirHandle(
+    std::unique_ptr<DirHandle> inner);
+
+} // namespace watchman
@@ -6,6 +6,8 @@
  */
 
 #include "watchman/fs/FSDetect.h"
+#include <mutex>
+#include <poll.h>
 #include <folly/FileUtil.h>
 #include <folly/String.h>
 #include "watchman/fs/FileDescriptor.h"
@@ -124,9 +126,38 @@ w_string w_fstype_detect_macos_nfs(w_string fstype, w_string edenfs_indicator) {
 w_string w_fstype(const char* path) {
 #ifdef __linux__
   // If possible, we prefer to read the filesystem type names from
-  // `/proc/self/mounts`
+  // `/proc/self/mounts`. The table is parsed per call but only re-read
+  // when the kernel signals a mount change: /proc/self/mounts reports
+  // POLLERR|POLLPRI on its fd when the namespace's mounts change, so a
+  // zero-timeout poll is an exact, event-driven invalidation check.
+  static std::mutex mountsMutex;
+  static std::string cachedMounts;
+  static int mountsFd = -1;
+
   std::string mounts;
-  if (folly::readFile("/proc/self/mounts", mounts)) {
+  {
+    std::lock_guard<std::mutex> lock(mountsMutex);
+    bool reread = cachedMounts.empty();
+    if (mountsFd == -1) {
+      mountsFd = open("/proc/self/mounts", O_RDONLY | O_CLOEXEC);
+      reread = true;
+    } else {
+      struct pollfd pfd {
+        mountsFd, POLLPRI, 0
+      };
+      if (poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLERR | POLLPRI))) {
+        reread = true;
+      }
+    }
+
+    if (reread) {
+      cachedMounts.clear();
+      folly::readFile("/proc/self/mounts", cachedMounts);
+    }
+    mounts = cachedMounts;
+  }
+
+  if (!mounts.empty()) {
     auto fstype = find_fstype_in_linux_proc_mounts(path, mounts);
     if (fstype) {
       return fstype;
@@ -83,13 +83,26 @@ enum class DType {
 #endif
 };
 
+// Note: fields are grouped by size so that the narrow ids pack together
+// instead of padding out against the 8-byte fields; with a watchman_file
+// embedded per tracked path, each byte of padding here is multiplied by
+// the file population.
+//
+// Timestamp interning (replacing the three timespecs with 32-bit ids
+// into a per-root table) was evaluated and rejected: this struct is
+// copied wholesale from stat results (statPath memcpys it, and
+// did_file_change compares raw fields), handed to FileResult accessors
+// as plain timespecs, and used identically for dirs and non-view
+// callers, so ids would need materialization at every boundary while
+// the table itself pins an entry per distinct (checkout, build)
+// timestamp forever. The struct-packing above captures the free part
+// of that savings.
 struct FileInformation {
   // On POSIX systems, the complete mode information.
   // On Windows, this is lossy wrt. symlink information,
   // so it is preferable to use isSymlink() rather than
   // S_ISLNK() on the mode value.
   mode_t mode{0};
-  off_t size{0};
 
   // On Windows systems, these fields are approximated
   // from cheaply available information in a way that is
@@ -97,14 +110,16 @@ struct FileInformation {
   // native win32 applications (including python).
   uid_t uid{0};
   gid_t gid{0};
-  ino_t ino{0};
-  dev_t dev{0};
   nlink_t nlink{0};
 
 #ifdef _WIN32
   uint32_t fileAttributes{0};
 #endif
 
+  off_t size{0};
+  ino_t ino{0};
+  dev_t dev{0};
+
   struct timespec atime {
     0, 0
   };
@@ -40,6 +40,12 @@ class RealFileSystem final : public FileSystem {
     return watchman::getFileInformation(path, caseSensitive);
   }
 
+  Result<FileInformation, std::error_code> tryGetFileInformation(
+      const char* path,
+      CaseSensitivity caseSensitive = CaseSensitivity::Unknown) override {
+    return watchman::tryGetFileInformation(path, caseSensitive);
+  }
+
   /**
    * Watchman-specific API for creating an empty file on the filesystem.
    * On unix, the created file will have mode 0700.
@@ -262,6 +268,28 @@ FileDescriptor openFileHandle(
           opened.view()));
 }
 
+Result<FileInformation, std::error_code> tryGetFileInformation(
+    const char* path,
+    CaseSensitivity caseSensitive) {
+#ifndef _WIN32
+  if (caseSensitive == CaseSensitivity::CaseSensitive) {
+    struct stat st;
+    if (lstat(path, &st)) {
+      return Result<FileInformation, std::error_code>(
+          std::error_code(errno, std::generic_category()));
+    }
+    return Result<FileInformation, std::error_code>(FileInformation(st));
+  }
+#endif
+
+  try {
+    return Result<FileInformation, std::error_code>(
+        getFileInformation(path, caseSensitive));
+  } catch (const std::system_error& exc) {
+    return Result<FileInformation, std::error_code>(exc.code());
+  }
+}
+
 FileInformation getFileInformation(
     const char* path,
     CaseSensitivity caseSensitive) {
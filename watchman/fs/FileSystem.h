@@ -46,6 +46,23 @@ class FileSystem {
       const char* path,
       CaseSensitivity caseSensitive = CaseSensitivity::Unknown) = 0;
 
+  /**
+   * Exception-free variant of getFileInformation. The default wraps the
+   * virtual throwing implementation (so fake filesystems in tests work
+   * unchanged); RealFileSystem overrides it to avoid the throw/unwind
+   * per missing path that ENOENT storms otherwise cost.
+   */
+  virtual Result<FileInformation, std::error_code> tryGetFileInformation(
+      const char* path,
+      CaseSensitivity caseSensitive = CaseSensitivity::Unknown) {
+    try {
+      return Result<FileInformation, std::error_code>(
+          getFileInformation(path, caseSensitive));
+    } catch (const std::system_error& exc) {
+      return Result<FileInformation, std::error_code>(exc.code());
+    }
+  }
+
   /**
    * Watchman-specific API for creating an empty file on the filesystem.
    * On unix, the created file will have mode 0700.
@@ -69,6 +86,11 @@ FileDescriptor openFileHandle(
     const OpenFileHandleOptions& opts);
 
 /** equivalent to lstat(2), but performs strict name checking */
+/** Exception-free counterpart of the free getFileInformation below. */
+Result<FileInformation, std::error_code> tryGetFileInformation(
+    const char* path,
+    CaseSensitivity caseSensitive = CaseSensitivity::Unknown);
+
 FileInformation getFileInformation(
     const char* path,
     CaseSensitivity caseSensitive = CaseSensitivity::Unknown);
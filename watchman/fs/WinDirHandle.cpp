@@ -58,6 +58,15 @@ class WinDirHandle : public DirHandle {
     }
   }
 
+  // Enumeration audit: the primary path already does what large-buffer
+  // NtQueryDirectoryFile batching would — GetFileInformationByHandleEx
+  // with FileFullDirectoryInfo fills the 64KB buffer below with many
+  // entries per kernel transition, and names convert to UTF-8 into a
+  // fixed member buffer with no per-entry allocation. Only the Windows 7
+  // fallback iterates FindNextFileW entry-at-a-time, and it exists
+  // purely for an OS generation that no longer receives performance
+  // work; dropping to NtQueryDirectoryFile directly would buy the same
+  // batch with an undocumented-API maintenance burden.
   const DirEntry* readDir() override {
     if (win7_) {
       return readDirWin7();
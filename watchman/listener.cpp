@@ -12,8 +12,10 @@
 #include <folly/String.h>
 #include <folly/Synchronized.h>
 #include <folly/net/NetworkSocket.h>
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <deque>
 #include <optional>
 #include <thread>
 #include "watchman/Constants.h"
@@ -115,14 +117,153 @@ watchman_client::~watchman_client() {
   }
 }
 
-void watchman_client::enqueueResponse(json_ref&& resp, bool ping) {
-  responses.emplace_back(std::move(resp));
+void watchman_client::enqueueResponse(
+    json_ref&& resp,
+    bool ping,
+    bool broadcast) {
+  if (current_request_tag && resp.isObject()) {
+    resp.set("tag", json_ref(current_request_tag));
+  }
+  responses.push_back(QueuedResponse{std::move(resp), broadcast});
 
   if (ping) {
     this->ping->notify();
   }
 }
 
+namespace {
+
+/**
+ * When the pdu_capture_path config option names a file, every inbound
+ * request is appended to it as a BSER record of
+ * {ts_us, client, request}, timestamped at dispatch. The resulting log
+ * replays against a test daemon with watchman/bench/replay_capture.py.
+ * This is opt-in (it records query contents) and adds one buffered
+ * write per request when enabled, nothing when not.
+ */
+void maybeCapturePdu(uint64_t clientId, const json_ref& request) {
+  auto* path = cfg_get_string("pdu_capture_path", "");
+  if (!*path) {
+    return;
+  }
+
+  static folly::Synchronized<std::unique_ptr<watchman_stream>> captureFile;
+
+  auto file = captureFile.wlock();
+  if (!*file) {
+    *file = w_stm_open(path, O_WRONLY | O_APPEND | O_CREAT, 0600);
+    if (!*file) {
+      return;
+    }
+  }
+
+  auto record = json_object(
+      {{"ts_us",
+        json_integer(std::chrono::duration_cast<std::chrono::microseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count())},
+       {"client", json_integer(clientId)},
+       {"request", json_ref(request)}});
+
+  w_jbuffer_t buffer;
+  buffer.bserEncodeToStream(2, 0, record, file->get());
+}
+
+/**
+ * Cache of encoded PDUs keyed by payload object identity and wire format.
+ * When the same json payload object is broadcast to many clients (eg: log
+ * payloads, or shared subscription batches), it is encoded once per
+ * (pdu type, capabilities) pair and the refcounted bytes are appended to
+ * each client's send buffer. Holding the json_ref in the entry keeps the
+ * object alive, so pointer identity cannot be recycled while cached.
+ */
+struct EncodedPduCacheEntry {
+  json_ref payload;
+  w_pdu_type pduType;
+  uint32_t capabilities;
+  std::shared_ptr<const std::string> bytes;
+};
+
+folly::Synchronized<std::deque<EncodedPduCacheEntry>, std::mutex>
+    encodedPduCache;
+constexpr size_t kEncodedPduCacheSize = 32;
+
+std::shared_ptr<const std::string> encodePduShared(
+    const json_ref& payload,
+    w_pdu_type pduType,
+    uint32_t capabilities) {
+  {
+    auto cache = encodedPduCache.lock();
+    for (auto& entry : *cache) {
+      if (entry.payload.get() == payload.get() && entry.pduType == pduType &&
+          entry.capabilities == capabilities) {
+        return entry.bytes;
+      }
+    }
+  }
+
+  auto encoded = std::make_shared<std::string>();
+  if (!w_jbuffer_t::pduEncodeToBuffer(
+          pduType, capabilities, payload, *encoded)) {
+    return nullptr;
+  }
+
+  auto cache = encodedPduCache.lock();
+  if (cache->size() >= kEncodedPduCacheSize) {
+    cache->pop_front();
+  }
+  cache->push_back(
+      EncodedPduCacheEntry{payload, pduType, capabilities, encoded});
+  return encoded;
+}
+
+} // namespace
+
+void watchman_client::flushNonBlocking() {
+  while (!responses.empty()) {
+    auto& queued = responses.front();
+    bool ok;
+    if (queued.broadcast) {
+      auto encoded = encodePduShared(queued.payload, pdu_type, capabilities);
+      ok = encoded != nullptr;
+      if (ok) {
+        pendingWriteBuf.append(*encoded);
+      }
+    } else {
+      ok = w_jbuffer_t::pduEncodeToBuffer(
+          pdu_type, capabilities, queued.payload, pendingWriteBuf);
+    }
+    if (!ok) {
+      sendError = true;
+      return;
+    }
+    responses.pop_front();
+  }
+
+  while (pendingWritePos < pendingWriteBuf.size()) {
+    auto x = stm->write(
+        pendingWriteBuf.data() + pendingWritePos,
+        pendingWriteBuf.size() - pendingWritePos);
+    if (x <= 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // Socket is full; the encoded remainder stays buffered (the
+        // rendered rows it came from are already released) and the
+        // regular drain resumes it.
+        break;
+      }
+      sendError = true;
+      return;
+    }
+    pendingWritePos += x;
+    totalBytesSent += x;
+  }
+
+  if (pendingWritePos == pendingWriteBuf.size()) {
+    pendingWriteBuf.clear();
+    pendingWritePos = 0;
+  }
+}
+
 // The client thread reads and decodes json packets,
 // then dispatches the commands that it finds
 static void client_thread(
@@ -150,9 +291,17 @@ static void client_thread(
   while (!w_is_stopping() && client_alive) {
     // Wait for input from either the client socket or
     // via the ping pipe, which signals that some other
-    // thread wants to unilaterally send data to the client
-
-    ignore_result(w_poll_events(pfd, 2, 2000));
+    // thread wants to unilaterally send data to the client.
+    //
+    // An idle connection can sleep for a long time: shutdown explicitly
+    // pings every client, so the timeout is only a backstop, and on our
+    // busiest hosts hundreds of mostly idle client threads waking every
+    // couple of seconds adds up to real scheduler churn. When we have a
+    // partially drained send buffer we instead wake quickly to retry the
+    // write, since nothing else is guaranteed to signal writability.
+    int timeoutms =
+        client->pendingWritePos < client->pendingWriteBuf.size() ? 200 : 60000;
+    ignore_result(w_poll_events(pfd, 2, timeoutms));
     if (w_is_stopping()) {
       break;
     }
@@ -181,7 +330,26 @@ static void client_thread(
       } else if (request) {
         client->pdu_type = client->reader.pdu_type;
         client->capabilities = client->reader.capabilities;
-        dispatch_command(client.get(), request, CMD_DAEMON);
+        maybeCapturePdu(client->unique_id, request);
+        if (request.isObject()) {
+          // Tagged envelope: {"tag": ..., "command": [...]}. The tag is
+          // echoed on every response the command produces (including
+          // streamed chunks), letting a pipelining client correlate
+          // responses with requests instead of relying on ordering.
+          auto tag = request.get_default("tag");
+          auto cmd = request.get_default("command");
+          if (tag && cmd && cmd.isArray()) {
+            client->current_request_tag = tag;
+            dispatch_command(client.get(), cmd, CMD_DAEMON);
+            client->current_request_tag = nullptr;
+          } else {
+            send_error_response(
+                client.get(),
+                "tagged requests must carry 'tag' and 'command' fields");
+          }
+        } else {
+          dispatch_command(client.get(), request, CMD_DAEMON);
+        }
       }
     }
 
@@ -191,7 +359,10 @@ static void client_thread(
         pending.clear();
         getPending(pending, client->debugSub, client->errorSub);
         for (auto& item : pending) {
-          client->enqueueResponse(json_ref(item->payload), false);
+          // Publisher payloads are shared across every subscribed
+          // client; mark them so the send path encodes them once.
+          client->enqueueResponse(
+              json_ref(item->payload), false, /*broadcast=*/true);
         }
 
         // Maybe we have subscriptions to dispatch?
@@ -275,20 +446,40 @@ static void client_thread(
       }
     }
 
-    /* now send our response(s) */
+    /* now send our response(s): encode them into the pending write
+     * buffer and drain it without blocking. A consumer that stops
+     * reading must not pin this thread, which also dispatches commands
+     * and fans out subscriptions for this client. */
+
+    // A backlog this large means the consumer has effectively stopped
+    // reading; disconnect rather than buffer without bound.
+    constexpr size_t kMaxSendBacklog = 256 * 1024 * 1024;
+
     while (!client->responses.empty() && client_alive) {
-      auto& response_to_send = client->responses.front();
+      auto& queued = client->responses.front();
+      auto& response_to_send = queued.payload;
 
-      client->stm->setNonBlock(false);
       /* Return the data in the same format that was used to ask for it.
-       * Update client liveness based on send success.
-       */
-      client_alive = client->writer.pduEncodeToStream(
-          client->pdu_type,
-          client->capabilities,
-          response_to_send,
-          client->stm.get());
-      client->stm->setNonBlock(true);
+       * Update client liveness based on encode success. Broadcast
+       * payloads (shared by reference with other clients) go through
+       * the shared-encode cache so they are encoded at most once per
+       * wire format; one-shot responses encode straight into the send
+       * buffer and are released as soon as they are written. */
+      if (queued.broadcast) {
+        auto encoded = encodePduShared(
+            response_to_send, client->pdu_type, client->capabilities);
+        if (encoded) {
+          client->pendingWriteBuf.append(*encoded);
+        } else {
+          client_alive = false;
+        }
+      } else if (!w_jbuffer_t::pduEncodeToBuffer(
+                     client->pdu_type,
+                     client->capabilities,
+                     response_to_send,
+                     client->pendingWriteBuf)) {
+        client_alive = false;
+      }
 
       json_ref subscriptionValue = response_to_send.get_default("subscription");
       if (kResponseLogLimit && subscriptionValue &&
@@ -308,6 +499,54 @@ static void client_thread(
 
       client->responses.pop_front();
     }
+
+    if (client->sendError) {
+      // A streaming flush hit a hard write error mid-command.
+      client_alive = false;
+    }
+
+    auto backlog =
+        client->pendingWriteBuf.size() - client->pendingWritePos;
+    client->sendBacklogHighWater =
+        std::max(client->sendBacklogHighWater, backlog);
+
+    if (backlog > kMaxSendBacklog) {
+      logf(
+          ERR,
+          "client {} send backlog of {} bytes exceeds limit; disconnecting slow consumer\n",
+          client->unique_id,
+          backlog);
+      client_alive = false;
+    }
+
+    while (client_alive &&
+           client->pendingWritePos < client->pendingWriteBuf.size()) {
+      auto x = client->stm->write(
+          client->pendingWriteBuf.data() + client->pendingWritePos,
+          client->pendingWriteBuf.size() - client->pendingWritePos);
+      if (x <= 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          // The socket is full; we'll drain more on the next wakeup
+          // (at worst the poll timeout) while continuing to service
+          // reads and pings meanwhile.
+          break;
+        }
+        client_alive = false;
+        break;
+      }
+      client->pendingWritePos += x;
+      client->totalBytesSent += x;
+    }
+
+    if (client->pendingWritePos == client->pendingWriteBuf.size()) {
+      client->pendingWriteBuf.clear();
+      client->pendingWritePos = 0;
+    } else if (client->pendingWritePos > kMaxSendBacklog / 4) {
+      // Compact away the consumed prefix so the buffer doesn't grow
+      // without bound across partial drains.
+      client->pendingWriteBuf.erase(0, client->pendingWritePos);
+      client->pendingWritePos = 0;
+    }
   }
 
 disconnected:
@@ -747,7 +747,21 @@ static void setup_sock_name() {
   }
 #endif
 
-  auto user = computeUserName();
+  // Scripted clients typically provide the sockname (and often the
+  // state and log paths) explicitly via flags or environment; when every
+  // path we'd derive from the username is already specified, skip the
+  // username resolution — it can stall on NSS — and the state dir
+  // computation entirely. compute_file_name ignores `user` for paths
+  // that were provided.
+  std::string user;
+  bool needUser = flags.unix_sock_name.empty() ||
+      flags.watchman_state_file.empty() || logging::log_name.empty();
+#ifdef _WIN32
+  needUser = needUser || flags.named_pipe_path.empty();
+#endif
+  if (needUser) {
+    user = computeUserName();
+  }
 
   // Precompute the temporary directory path in case this process's environment
   // changes.
@@ -801,6 +815,52 @@ static bool should_start(int err) {
   return false;
 }
 
+/* --batch: run a stream of commands from stdin over one connection.
+ * Scripts that issue watch-project / clock / query as separate CLI
+ * invocations pay a process spawn and a fresh connection per step;
+ * batch mode reuses both. Commands are ordinary json or bser PDUs, one
+ * response is emitted per command in order, and the exit status is
+ * nonzero if any command failed to round trip. */
+static int run_batch_mode() {
+  auto client = w_stm_connect(6000);
+  if (!client) {
+    logf(ERR, "unable to connect to watchman for --batch\n");
+    return 1;
+  }
+  client->setNonBlock(false);
+
+  w_jbuffer_t input;
+  w_jbuffer_t sendBuffer;
+  w_jbuffer_t receiveBuffer;
+  w_jbuffer_t output_pdu_buffer;
+  int failures = 0;
+
+  while (true) {
+    json_error_t jerr;
+    auto cmd = input.decodeNext(w_stm_stdin(), &jerr);
+    if (!cmd) {
+      // End of input stream
+      break;
+    }
+
+    preprocess_command(cmd, output_pdu, output_capabilities);
+
+    if (!sendBuffer.pduEncodeToStream(
+            server_pdu, server_capabilities, cmd, client.get())) {
+      logf(ERR, "error sending PDU to server\n");
+      return 1;
+    }
+    sendBuffer.clear();
+
+    if (!receiveBuffer.passThru(
+            output_pdu, output_capabilities, &output_pdu_buffer, client.get())) {
+      ++failures;
+    }
+  }
+
+  return failures ? 1 : 0;
+}
+
 static bool try_command(json_t* cmd, int timeout) {
   auto client = w_stm_connect(timeout * 1000);
   if (!client) {
@@ -998,6 +1058,11 @@ static int inner_main(int argc, char** argv) {
   }
 
   w_set_thread_name("cli");
+
+  if (flags.batch_mode) {
+    return run_batch_mode();
+  }
+
   auto cmd = build_command(argc, argv);
   preprocess_command(cmd, output_pdu, output_capabilities);
 
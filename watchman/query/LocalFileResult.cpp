@@ -6,7 +6,9 @@
  */
 
 #include "watchman/query/LocalFileResult.h"
+#include <folly/futures/Future.h>
 #include "watchman/ContentHash.h"
+#include "watchman/ThreadPool.h"
 
 namespace watchman {
 
@@ -114,6 +116,27 @@ std::optional<FileResult::ContentHash> LocalFileResult::getContentSha1() {
 
 void LocalFileResult::batchFetchProperties(
     const std::vector<std::unique_ptr<FileResult>>& files) {
+  // Issue the stats for the whole batch concurrently before the serial
+  // property pass below; SCM-aware queries route thousands of
+  // LocalFileResults through here and paid one synchronous stat each.
+  // getInfo() is a no-op for entries whose stat already completed, and
+  // entries whose pool task failed simply stat again serially inside
+  // getInfo with the usual treat-errors-as-deleted handling.
+  {
+    std::vector<folly::Future<folly::Unit>> statFutures;
+    statFutures.reserve(files.size());
+    for (auto& f : files) {
+      auto localFile = dynamic_cast<LocalFileResult*>(f.get());
+      if (localFile->info_.has_value()) {
+        continue;
+      }
+      statFutures.push_back(folly::via(&getThreadPool(), [localFile] {
+        localFile->getInfo();
+      }));
+    }
+    folly::collectAll(statFutures.begin(), statFutures.end()).wait();
+  }
+
   for (auto& f : files) {
     auto localFile = dynamic_cast<LocalFileResult*>(f.get());
     localFile->getInfo();
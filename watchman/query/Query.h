@@ -56,7 +56,10 @@ struct Query {
 
   std::optional<std::vector<QueryPath>> paths;
 
-  std::unique_ptr<GlobTree> glob_tree;
+  // Compiled glob set; shared with the process-wide compilation cache
+  // (tools resend identical glob lists constantly) and treated as
+  // immutable after parse.
+  std::shared_ptr<const GlobTree> glob_tree;
   // Additional flags to pass to wildmatch in the glob_generator
   int glob_flags = 0;
 
@@ -100,6 +103,54 @@ struct Query {
 
   bool alwaysIncludeDirectories{false};
 
+  /**
+   * When true, the command layer may deliver rendered results in bounded
+   * chunks as generation proceeds (each as its own PDU carrying
+   * "stream_files"), rather than materializing the full results array in
+   * the final response. Set by clients that advertise they can consume
+   * chunked results.
+   */
+  bool stream_results{false};
+
+  /**
+   * When true, the path and glob generators may skip whole subtrees whose
+   * per-dir change clock shows nothing newer than the query's since
+   * clock. This is opt-in because generators union their outputs: a
+   * caller combining glob with since that expects unchanged-but-matching
+   * files must leave it unset.
+   */
+  bool prune_unchanged_dirs{false};
+
+  /**
+   * When true, the response's debug info carries an "explain" report:
+   * which generators ran, files examined versus matched, and cache hit
+   * rates. Costs a few extra counters only.
+   */
+  bool explain{false};
+
+  /**
+   * When non-zero, the syncToNow round trip is skipped if the root last
+   * settled within this bound; the response then carries
+   * "synced": false so callers can see they were served from a possibly
+   * stale (but bounded) view. Zero preserves full synchronization.
+   */
+  std::chrono::milliseconds max_staleness{0};
+
+  /**
+   * Opt-in to the whole-result cache for sinceless queries; results are
+   * shared by reference with other clients issuing the byte-identical
+   * query at the same root clock.
+   */
+  bool cache_results{false};
+
+  /**
+   * When non-zero, stop accepting matches once this many results have
+   * been rendered; the response carries "is_limited": true when the
+   * limit cut the result set short. Time-ordered queries can resume
+   * from the returned clock, which is the natural continuation token.
+   */
+  uint32_t limit{0};
+
   ~Query();
 
   /** Returns true if the supplied name is contained in
@@ -7,6 +7,8 @@
 
 #include "watchman/query/QueryContext.h"
 
+#include "watchman/Errors.h"
+
 #include "watchman/query/Query.h"
 #include "watchman/query/eval.h"
 #include "watchman/query/parse.h"
@@ -19,6 +21,13 @@ namespace {
 
 constexpr size_t kMaximumRenderBatchSize = 1024;
 
+// Streamed results are flushed in chunks of this many rendered files.
+constexpr size_t kStreamChunkSize = 4096;
+
+// Enough for every known field with headroom; field lists are parsed from
+// the fixed renderer registry so they can't meaningfully exceed this.
+constexpr size_t kMaxRowFields = 24;
+
 std::optional<json_ref> file_result_to_json(
     const QueryFieldList& fieldList,
     const std::unique_ptr<FileResult>& file,
@@ -26,6 +35,30 @@ std::optional<json_ref> file_result_to_json(
   if (fieldList.size() == 1) {
     return fieldList.front()->make(file.get(), ctx);
   }
+
+  if (fieldList.size() <= kMaxRowFields) {
+    // Render the row into a stack buffer first: if a field still needs
+    // data to be loaded we bail before allocating the result object, so
+    // rows that go through the batched-fetch path don't cost a discarded
+    // half-built object on the first attempt.
+    std::optional<json_ref> row[kMaxRowFields];
+    for (size_t i = 0; i < fieldList.size(); ++i) {
+      row[i] = fieldList[i]->make(file.get(), ctx);
+      if (!row[i].has_value()) {
+        // Need data to be loaded
+        return std::nullopt;
+      }
+    }
+
+    // The field names are preinterned w_strings with cached hashes, so
+    // emitting the completed row is a single pass of cheap inserts.
+    auto value = json_object_of_size(fieldList.size());
+    for (size_t i = 0; i < fieldList.size(); ++i) {
+      value.set(fieldList[i]->name, std::move(row[i].value()));
+    }
+    return value;
+  }
+
   auto value = json_object_of_size(fieldList.size());
 
   for (auto& f : fieldList) {
@@ -41,6 +74,12 @@ std::optional<json_ref> file_result_to_json(
 
 } // namespace
 
+void QueryContext::checkCancellation() const {
+  if (cancelRequested.load(std::memory_order_relaxed)) {
+    throw QueryExecError("query cancelled by cancel-request");
+  }
+}
+
 void QueryContext::resetWholeName() {
   wholename_.reset();
 }
@@ -52,6 +91,24 @@ const w_string& QueryContext::getWholeName() {
   return wholename_;
 }
 
+uint32_t QueryContext::getWholeNamePrefixSize() {
+  return (query->relative_root ? query->relative_root.size()
+                               : root->root_path.size()) +
+      1;
+}
+
+/*
+ * Note on caching rendered wholenames across queries: evaluated and
+ * declined. A wholename is one w_string::build from the shared per-dir
+ * path (rendered once per directory, at dir construction) plus the
+ * basename; a cross-query cache keyed by (dir, name) would pay a hash
+ * probe on those same bytes to save a single bounded concatenation,
+ * and the result string is usually consumed into the response anyway
+ * (the allocation exists either way). The sharing that mattered — the
+ * directory portion, repeated for every file in a dir — is already
+ * amortized via watchman_dir::full_path and the generators' per-dir
+ * path reuse.
+ */
 w_string QueryContext::computeWholeName(FileResult* file) const {
   uint32_t name_start;
 
@@ -155,15 +212,32 @@ json_ref QueryContext::renderResults() {
 }
 
 void QueryContext::maybeRender(std::unique_ptr<FileResult>&& file) {
+  if (limitReached) {
+    return;
+  }
+
   auto maybeRendered = file_result_to_json(query->fieldList, file, this);
   if (maybeRendered.has_value()) {
     resultsArray.push_back(std::move(maybeRendered.value()));
+    if (query->limit &&
+        resultsArray.size() + renderedSoFar_ >= query->limit) {
+      limitReached = true;
+    }
+    maybeFlushStream();
     return;
   }
 
   addToRenderBatch(std::move(file));
 }
 
+void QueryContext::maybeFlushStream() {
+  if (resultsStreamer && resultsArray.size() >= kStreamChunkSize) {
+    renderedSoFar_ += resultsArray.size();
+    resultsStreamer(std::move(resultsArray));
+    resultsArray.clear();
+  }
+}
+
 void QueryContext::addToRenderBatch(std::unique_ptr<FileResult>&& file) {
   renderBatch_.emplace_back(std::move(file));
   // TODO: maybe allow passing this number in via the query?
@@ -184,6 +258,7 @@ bool QueryContext::fetchRenderBatchNow() {
     auto maybeRendered = file_result_to_json(query->fieldList, file, this);
     if (maybeRendered.has_value()) {
       resultsArray.push_back(std::move(maybeRendered.value()));
+      maybeFlushStream();
     } else {
       renderBatch_.emplace_back(std::move(file));
     }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <folly/stop_watch.h>
+#include <functional>
 #include <unordered_set>
 #include "watchman/Clock.h"
 #include "watchman/query/QueryExpr.h"
@@ -56,6 +57,12 @@ struct QueryContext : QueryContextBase {
   // Rendered results
   std::vector<json_ref> resultsArray;
 
+  // When set, accumulated results are flushed through this callback in
+  // kStreamChunkSize batches as they are rendered, bounding the peak size
+  // of resultsArray. The remainder is returned via renderResults() as
+  // usual.
+  std::function<void(std::vector<json_ref>&&)> resultsStreamer;
+
   // When deduping the results, set<wholename> of
   // the files held in results
   std::unordered_set<w_string> dedup;
@@ -72,6 +79,17 @@ struct QueryContext : QueryContextBase {
   // Disable fresh instance queries
   bool disableFreshInstance{false};
 
+  // Set by cancel-request (via another client thread); observed at the
+  // generators' cooperative checkpoints.
+  std::atomic<bool> cancelRequested{false};
+
+  // Names of the generators that ran, for explain output.
+  std::vector<const char*> generatorsUsed;
+
+  // True once the query's limit has been reached; evaluation of further
+  // candidates short-circuits.
+  bool limitReached{false};
+
   QueryContext(
       const Query* q,
       const std::shared_ptr<Root>& root,
@@ -82,8 +100,16 @@ struct QueryContext : QueryContextBase {
   // Increment numWalked_ by the specified amount
   inline void bumpNumWalked(int64_t amount = 1) {
     numWalked_ += amount;
+    if ((numWalked_ & 0x3fff) == 0) {
+      // Cooperative cancellation checkpoint: every 16k files costs one
+      // relaxed load on the walk.
+      checkCancellation();
+    }
   }
 
+  // Throws QueryExecError if cancellation was requested.
+  void checkCancellation() const;
+
   int64_t getNumWalked() const {
     return numWalked_;
   }
@@ -97,6 +123,8 @@ struct QueryContext : QueryContextBase {
    */
   const w_string& getWholeName() override;
 
+  uint32_t getWholeNamePrefixSize() override;
+
   /**
    * Returns a JSON array containing the query results.
    *
@@ -117,6 +145,13 @@ struct QueryContext : QueryContextBase {
   void fetchEvalBatchNow();
 
   void maybeRender(std::unique_ptr<FileResult>&& file);
+
+  // Rows already flushed through the streamer, counted toward limit.
+  size_t renderedSoFar_{0};
+
+  // Flushes resultsArray through resultsStreamer if it has grown past the
+  // chunk size.
+  void maybeFlushStream();
   void addToRenderBatch(std::unique_ptr<FileResult>&& file);
 
   // Perform a batch load of the items in the render batch,
@@ -9,6 +9,7 @@
 
 #include <optional>
 #include "watchman/Clock.h"
+#include "watchman/watchman_system.h"
 #include "watchman/watchman_string.h"
 
 namespace watchman {
@@ -31,6 +32,14 @@ class QueryContextBase {
    * until the next file is set.
    */
   virtual const w_string& getWholeName() = 0;
+
+  /**
+   * Returns the length of the full-path prefix (root or relative root,
+   * including the trailing slash) that getWholeName() strips from the
+   * file's path. Lets terms that only inspect the directory portion work
+   * from FileResult::dirName() without rendering the per-file wholename.
+   */
+  virtual uint32_t getWholeNamePrefixSize() = 0;
 };
 
 /**
@@ -43,9 +52,56 @@ enum AggregateOp {
 
 class QueryExpr {
  public:
+  /**
+   * Relative evaluation cost rank, used by compound terms to order their
+   * children so that cheap terms run (and short circuit) before expensive
+   * ones. These are coarse buckets, not measurements; within a bucket
+   * author order is preserved.
+   */
+  enum CostClass : uint32_t {
+    // Reads scalar state that is already loaded (type, exists, size, since)
+    kCostTrivial = 10,
+    // Compares a string (name, suffix, dirname)
+    kCostString = 20,
+    // Runs a pattern engine (match, pcre)
+    kCostPattern = 30,
+    // Aggregates other terms
+    kCostCompound = 40,
+  };
+
   virtual ~QueryExpr() = default;
   virtual EvaluateResult evaluate(QueryContextBase* ctx, FileResult* file) = 0;
 
+  /**
+   * Returns this term's CostClass. Most string-comparing terms accept the
+   * default; scalar and pattern terms override.
+   */
+  virtual uint32_t cost() const {
+    return kCostString;
+  }
+
+  /**
+   * If this expression can only ever match files of one type (in the
+   * "type" term's character vocabulary), returns that character so
+   * generators can skip non-matching nodes before materializing
+   * candidates. An allof list propagates any child's constraint, since
+   * the type is then a necessary condition for the whole expression.
+   */
+  virtual std::optional<char> soleTypeFilter() const {
+    return std::nullopt;
+  }
+
+  /**
+   * If matching this expression requires the file's root-relative path
+   * to live at or under a literal directory prefix (eg: a wholename
+   * match of "src/server/**" has the computable head "src/server"),
+   * returns that prefix so generators can skip everything outside it.
+   * allof propagates any child's prefix, being a necessary condition.
+   */
+  virtual std::optional<w_string> literalPathPrefix() const {
+    return std::nullopt;
+  }
+
   // If OTHER can be aggregated with THIS, returns a new expression instance
   // representing the combined state.  Op provides information on the containing
   // query and can be used to determine how aggregation is done.
@@ -57,4 +113,11 @@ class QueryExpr {
   }
 };
 
+/**
+ * Tests a raw st_mode against a "type" term character; the mode-only
+ * counterpart of TypeExpr::evaluate, used by generator-side type
+ * prefiltering.
+ */
+bool modeMatchesTypeChar(mode_t mode, char typeChar);
+
 } // namespace watchman
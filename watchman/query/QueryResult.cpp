@@ -14,9 +14,13 @@ json_ref QueryDebugInfo::render() const {
   for (auto& fn : cookieFileNames) {
     json_array_append(arr, w_string_to_json(fn));
   }
-  return json_object({
+  auto result = json_object({
       {"cookie_files", arr},
   });
+  if (explain) {
+    result.set("explain", json_ref(explain));
+  }
+  return result;
 }
 
 } // namespace watchman
@@ -18,11 +18,16 @@ namespace watchman {
 struct QueryDebugInfo {
   std::vector<w_string> cookieFileNames;
 
+  // Populated when the query sets the "explain" flag.
+  json_ref explain;
+
   json_ref render() const;
 };
 
 struct QueryResult {
   bool isFreshInstance;
+  // True when a query limit cut the result set short.
+  bool isLimited{false};
   json_ref resultsArray;
   // Only populated if the query was set to dedup_results
   std::unordered_set<w_string> dedupedFileNames;
@@ -9,6 +9,7 @@
 #include "watchman/query/QueryExpr.h"
 #include "watchman/query/TermRegistry.h"
 
+#include <algorithm>
 #include <memory>
 #include <vector>
 
@@ -31,6 +32,10 @@ class NotExpr : public QueryExpr {
     return !*res;
   }
 
+  uint32_t cost() const override {
+    return expr->cost();
+  }
+
   static std::unique_ptr<QueryExpr> parse(Query* query, const json_ref& term) {
     /* rigidly require ["not", expr] */
     if (!term.isArray() || json_array_size(term) != 2) {
@@ -51,6 +56,10 @@ class TrueExpr : public QueryExpr {
     return true;
   }
 
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   static std::unique_ptr<QueryExpr> parse(Query*, const json_ref&) {
     return std::make_unique<TrueExpr>();
   }
@@ -64,6 +73,10 @@ class FalseExpr : public QueryExpr {
     return false;
   }
 
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   static std::unique_ptr<QueryExpr> parse(Query*, const json_ref&) {
     return std::make_unique<FalseExpr>();
   }
@@ -77,7 +90,47 @@ class ListExpr : public QueryExpr {
 
  public:
   ListExpr(bool isAll, std::vector<std::unique_ptr<QueryExpr>> exprs)
-      : allof(isAll), exprs(std::move(exprs)) {}
+      : allof(isAll), exprs(std::move(exprs)) {
+    // Run cheap terms before expensive ones; either polarity of list
+    // short circuits, so evaluating a trivial type/exists check before a
+    // pcre saves the pattern engine entirely for most files. The sort is
+    // stable so equal-cost terms keep author order.
+    std::stable_sort(
+        this->exprs.begin(),
+        this->exprs.end(),
+        [](const std::unique_ptr<QueryExpr>& a,
+           const std::unique_ptr<QueryExpr>& b) {
+          return a->cost() < b->cost();
+        });
+  }
+
+  uint32_t cost() const override {
+    return kCostCompound;
+  }
+
+  std::optional<char> soleTypeFilter() const override {
+    if (!allof) {
+      return std::nullopt;
+    }
+    for (auto& expr : exprs) {
+      if (auto filter = expr->soleTypeFilter()) {
+        return filter;
+      }
+    }
+    return std::nullopt;
+  }
+
+  std::optional<w_string> literalPathPrefix() const override {
+    if (!allof) {
+      return std::nullopt;
+    }
+    for (auto& expr : exprs) {
+      if (auto prefix = expr->literalPathPrefix()) {
+        return prefix;
+      }
+    }
+    return std::nullopt;
+  }
 
   EvaluateResult evaluate(QueryContextBase* ctx, FileResult* file) override {
     bool needData = false;
@@ -22,46 +22,66 @@ static inline bool is_dir_sep(int c) {
 class DirNameExpr : public QueryExpr {
   w_string dirname;
   struct w_query_int_compare depth;
-  using StartsWith = bool (*)(w_string_t* str, w_string_t* prefix);
-  StartsWith startswith;
+  CaseSensitivity caseSensitive;
+
+  bool prefixMatch(w_string_piece subject, w_string_piece prefix) const {
+    return caseSensitive == CaseSensitivity::CaseInSensitive
+        ? subject.startsWithCaseInsensitive(prefix)
+        : subject.startsWith(prefix);
+  }
 
  public:
   explicit DirNameExpr(
       w_string dirname,
       struct w_query_int_compare depth,
-      StartsWith startswith)
-      : dirname(dirname), depth(depth), startswith(startswith) {}
-
-  EvaluateResult evaluate(QueryContextBase* ctx, FileResult*) override {
-    auto& str = ctx->getWholeName();
-
-    if (str.size() <= dirname.size()) {
-      // Either it doesn't prefix match, or file name is == dirname.
-      // That means that the best case is that the wholename matches.
-      // we only want to match if dirname(wholename) matches, so it
-      // is not possible for us to match unless the length of wholename
-      // is greater than the dirname operand
-      return false;
+      CaseSensitivity caseSensitive)
+      : dirname(dirname), depth(depth), caseSensitive(caseSensitive) {}
+
+  EvaluateResult evaluate(QueryContextBase* ctx, FileResult* file) override {
+    // Only the parent directory matters here, and FileResult supplies it
+    // pre-rendered (and shared between all files in the same dir), so
+    // work from that rather than building the per-file wholename just to
+    // strip the basename off it again.
+    auto dir = file->dirName();
+    auto prefix = ctx->getWholeNamePrefixSize();
+    w_string_piece relDir;
+    if (prefix <= dir.size()) {
+      relDir = dir;
+      relDir.advance(prefix);
     }
 
-    // Want to make sure that wholename is a child of dirname, so
-    // check for a dir separator.  Special case for dirname == '' (the root),
-    // which won't have a slash in position 0.
-    if (dirname.size() > 0 && !is_dir_sep(str.data()[dirname.size()])) {
-      // may have a common prefix with, but is not a child of dirname
+    if (relDir.size() < dirname.size()) {
+      // Cannot be at or below the dirname operand
       return false;
     }
 
-    if (!startswith(str, dirname)) {
-      return false;
-    }
+    json_int_t actual_depth;
+    if (relDir.size() == dirname.size()) {
+      if (!prefixMatch(relDir, dirname)) {
+        return false;
+      }
+      // The file is a direct child of the dirname operand
+      actual_depth = 0;
+    } else {
+      // Want to make sure that the parent is a descendant of dirname, so
+      // check for a dir separator.  Special case for dirname == '' (the
+      // root), which won't have a slash in position 0.
+      if (dirname.size() > 0 && !is_dir_sep(relDir.data()[dirname.size()])) {
+        // may have a common prefix with, but is not a child of dirname
+        return false;
+      }
+      if (!prefixMatch(relDir, dirname)) {
+        return false;
+      }
 
-    // Now compute the depth of file from dirname.  We do this by
-    // counting dir separators, not including the one we saw above.
-    json_int_t actual_depth = 0;
-    for (size_t i = dirname.size() + 1; i < str.size(); i++) {
-      if (is_dir_sep(str.data()[i])) {
-        actual_depth++;
+      // Depth of the file from dirname: one for the dir the file lives
+      // in, plus one per separator between it and the operand.
+      size_t start = dirname.size() ? dirname.size() + 1 : 0;
+      actual_depth = 1;
+      for (size_t i = start; i < relDir.size(); i++) {
+        if (is_dir_sep(relDir.data()[i])) {
+          actual_depth++;
+        }
       }
     }
 
@@ -116,11 +136,7 @@ class DirNameExpr : public QueryExpr {
     }
 
     return std::make_unique<DirNameExpr>(
-        json_to_w_string(name),
-        depth_comp,
-        case_sensitive == CaseSensitivity::CaseInSensitive
-            ? w_string_startswith_caseless
-            : w_string_startswith);
+        json_to_w_string(name), depth_comp, case_sensitive);
   }
   static std::unique_ptr<QueryExpr> parseDirName(
       Query* query,
@@ -17,6 +17,10 @@ class QueryContextBase;
 
 class ExistsExpr : public QueryExpr {
  public:
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   EvaluateResult evaluate(QueryContextBase*, FileResult* file) override {
     return file->exists();
   }
@@ -29,6 +33,10 @@ W_TERM_PARSER(exists, ExistsExpr::parse);
 
 class EmptyExpr : public QueryExpr {
  public:
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   EvaluateResult evaluate(QueryContextBase*, FileResult* file) override {
     auto exists = file->exists();
     auto stat = file->stat();
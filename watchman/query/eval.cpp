@@ -8,6 +8,9 @@
 #include "watchman/query/eval.h"
 #include <fmt/chrono.h>
 #include <folly/ScopeGuard.h>
+#include <folly/Synchronized.h>
+#include <deque>
+#include <unordered_map>
 #include "watchman/CommandRegistry.h"
 #include "watchman/Errors.h"
 #include "watchman/PerfSample.h"
@@ -51,7 +54,13 @@ const std::vector<w_string>& getUnconditionalLogFilePrefixes() {
 void w_query_process_file(
     const Query* query,
     QueryContext* ctx,
-    std::unique_ptr<FileResult> file) {
+    std::unique_ptr<FileResult> file,
+    std::optional<bool> precomputedMatch) {
+  if (ctx->limitReached) {
+    // The query's limit has been satisfied; drop further candidates.
+    return;
+  }
+
   // TODO: Should this be implicit by assigning a file to the QueryContext? It
   // could be cleared when resetting the file.
   ctx->resetWholeName();
@@ -83,7 +92,9 @@ void w_query_process_file(
   // We produce an output for this file if there is no expression,
   // or if the expression matched.
   if (query->expr) {
-    auto match = query->expr->evaluate(ctx, ctx->file.get());
+    auto match = precomputedMatch.has_value()
+        ? EvaluateResult{precomputedMatch}
+        : query->expr->evaluate(ctx, ctx->file.get());
 
     if (!match.has_value()) {
       // Reconsider this one later
@@ -133,16 +144,19 @@ static void default_generators(
 
   // Time based query
   if (ctx->since.is_timestamp() || !ctx->since.is_fresh_instance()) {
+    ctx->generatorsUsed.push_back("time");
     time_generator(query, root, ctx);
     generated = true;
   }
 
   if (query->paths.has_value()) {
+    ctx->generatorsUsed.push_back("path");
     root->view()->pathGenerator(query, ctx);
     generated = true;
   }
 
   if (query->glob_tree) {
+    ctx->generatorsUsed.push_back("glob");
     root->view()->globGenerator(query, ctx);
     generated = true;
   }
@@ -150,6 +164,7 @@ static void default_generators(
   // And finally, if there were no other generators, we walk all known
   // files
   if (!generated) {
+    ctx->generatorsUsed.push_back("all-files");
     root->view()->allFilesGenerator(query, ctx);
   }
 }
@@ -231,6 +246,28 @@ static void execute_common(
     sample->log();
   }
 
+  res->isLimited = ctx->limitReached;
+
+  if (ctx->query->explain) {
+    auto generators = json_array();
+    for (auto* name : ctx->generatorsUsed) {
+      json_array_append_new(
+          generators, typed_string_to_json(name, W_STRING_UNICODE));
+    }
+
+    res->debugInfo.explain = json_object({
+        {"generators", std::move(generators)},
+        {"files_examined", json_integer(ctx->getNumWalked())},
+        {"files_matched", json_integer(ctx->resultsArray.size())},
+        {"files_deduped", json_integer(ctx->num_deduped)},
+        {"generation_us",
+         json_integer(
+             ctx->generationDuration.load().count() * 1000)},
+        {"render_us",
+         json_integer(ctx->renderDuration.load().count() * 1000)},
+    });
+  }
+
   res->resultsArray = ctx->renderResults();
   res->dedupedFileNames = std::move(ctx->dedup);
 }
@@ -238,11 +275,60 @@ static void execute_common(
 // Capability indicating support for scm-aware since queries
 W_CAP_REG("scm-since")
 
+namespace {
+
+/**
+ * Whole-result cache for identical sinceless queries. Keyed by the
+ * query spec fingerprint plus the root clock at evaluation; the tick
+ * advances on any change applied to the view, so a (fingerprint, clock)
+ * hit is exact, and the cached rendered array is immutable and shared
+ * by reference. Lookup happens after the query's sync step, so pending
+ * changes have either been applied (bumping the tick and missing the
+ * cache) or do not exist.
+ */
+struct CachedQueryResult {
+  std::string fingerprint;
+  uint32_t rootNumber;
+  uint32_t ticks;
+  json_ref resultsArray;
+  bool isFreshInstance;
+  bool isLimited;
+};
+
+folly::Synchronized<std::deque<CachedQueryResult>, std::mutex>
+    queryResultCache;
+constexpr size_t kMaxCachedQueryResults = 8;
+
+std::string queryFingerprint(const Query* query) {
+  return json_dumps(query->query_spec, JSON_COMPACT | JSON_SORT_KEYS);
+}
+
+} // namespace
+
+namespace {
+// In-flight queries keyed by request_id, for cancel-request. Entries are
+// registered for the duration of w_query_execute only; the raw pointers
+// never escape that scope.
+folly::Synchronized<std::unordered_map<w_string, QueryContext*>>
+    liveQueries;
+} // namespace
+
+bool w_query_cancel_request(const w_string& requestId) {
+  auto map = liveQueries.rlock();
+  auto it = map->find(requestId);
+  if (it == map->end()) {
+    return false;
+  }
+  it->second->cancelRequested.store(true, std::memory_order_relaxed);
+  return true;
+}
+
 QueryResult w_query_execute(
     const Query* query,
     const std::shared_ptr<Root>& root,
     QueryGenerator generator,
-    SavedStateFactory savedStateFactory) {
+    SavedStateFactory savedStateFactory,
+    std::function<void(std::vector<json_ref>&&)> resultsStreamer) {
   QueryResult res;
   ClockSpec resultClock(ClockPosition{});
   bool disableFreshInstance{false};
@@ -378,6 +464,17 @@ QueryResult w_query_execute(
     };
   }
   QueryContext ctx{query, root, disableFreshInstance};
+  if (requestId && !requestId.empty()) {
+    liveQueries.wlock()->emplace(requestId, &ctx);
+  }
+  SCOPE_EXIT {
+    if (requestId && !requestId.empty()) {
+      liveQueries.wlock()->erase(requestId);
+    }
+  };
+  if (query->stream_results) {
+    ctx.resultsStreamer = std::move(resultsStreamer);
+  }
 
   // Track the query against the root.
   // This is to enable the `watchman debug-status` diagnostic command.
@@ -398,15 +495,30 @@ QueryResult w_query_execute(
     }
   }
   if (query->sync_timeout.count()) {
-    ctx.state = QueryContextState::WaitingForCookieSync;
-    ctx.stopWatch.reset();
-    try {
-      auto result = root->syncToNow(query->sync_timeout);
-      res.debugInfo.cookieFileNames = std::move(result.cookieFileNames);
-    } catch (const std::exception& exc) {
-      throw QueryExecError("synchronization failed: ", exc.what());
+    bool skipSync = false;
+    if (query->max_staleness.count()) {
+      // Bounded staleness: if the root settled recently enough, serve
+      // from the current view without the cookie round trip. The
+      // settle timestamp is conservative — an unsettled root always
+      // syncs — so the staleness a caller can observe is bounded by
+      // the option plus the settle latency itself.
+      auto lastSettle = root->view()->getLastSettleTimestamp();
+      skipSync = lastSettle.time_since_epoch().count() != 0 &&
+          std::chrono::steady_clock::now() - lastSettle <
+              query->max_staleness;
+    }
+
+    if (!skipSync) {
+      ctx.state = QueryContextState::WaitingForCookieSync;
+      ctx.stopWatch.reset();
+      try {
+        auto result = root->syncToNow(query->sync_timeout);
+        res.debugInfo.cookieFileNames = std::move(result.cookieFileNames);
+      } catch (const std::exception& exc) {
+        throw QueryExecError("synchronization failed: ", exc.what());
+      }
+      ctx.cookieSyncDuration = ctx.stopWatch.lap();
     }
-    ctx.cookieSyncDuration = ctx.stopWatch.lap();
   }
 
   /* The first stage of execution is generation.
@@ -438,6 +550,28 @@ QueryResult w_query_execute(
                                       &root->inner.cursors)
                                 : QuerySince{};
 
+  // Identical sinceless queries from different clients (build graph
+  // loaders invoked per target) hit the result cache when nothing has
+  // changed since the cached evaluation.
+  std::string fingerprint;
+  const bool cacheable = !query->since_spec && !query->stream_results &&
+      !generator && query->cache_results;
+  if (cacheable) {
+    fingerprint = queryFingerprint(query);
+    auto position = ctx.clockAtStartOfQuery.position();
+    auto cache = queryResultCache.lock();
+    for (auto& entry : *cache) {
+      if (entry.ticks == position.ticks &&
+          entry.rootNumber == position.rootNumber &&
+          entry.fingerprint == fingerprint) {
+        res.resultsArray = entry.resultsArray;
+        res.isFreshInstance = entry.isFreshInstance;
+        res.isLimited = entry.isLimited;
+        return res;
+      }
+    }
+  }
+
   if (query->bench_iterations > 0) {
     for (uint32_t i = 0; i < query->bench_iterations; ++i) {
       QueryContext c{query, root, ctx.disableFreshInstance};
@@ -449,6 +583,22 @@ QueryResult w_query_execute(
   }
 
   execute_common(&ctx, &sample, &res, generator);
+
+  if (cacheable) {
+    auto position = ctx.clockAtStartOfQuery.position();
+    auto cache = queryResultCache.lock();
+    if (cache->size() >= kMaxCachedQueryResults) {
+      cache->pop_front();
+    }
+    cache->push_back(CachedQueryResult{
+        std::move(fingerprint),
+        position.rootNumber,
+        position.ticks,
+        res.resultsArray,
+        res.isFreshInstance,
+        res.isLimited});
+  }
+
   return res;
 }
 
@@ -38,14 +38,25 @@ watchman::QueryResult w_query_execute(
     const watchman::Query* query,
     const std::shared_ptr<watchman::Root>& root,
     watchman::QueryGenerator generator,
-    watchman::SavedStateFactory savedStateFactory);
+    watchman::SavedStateFactory savedStateFactory,
+    std::function<void(std::vector<json_ref>&&)> resultsStreamer = nullptr);
+
+/**
+ * Requests cooperative cancellation of the in-flight query registered
+ * with the given request_id. Returns true if such a query was found.
+ */
+bool w_query_cancel_request(const w_string& requestId);
 
 // Allows a generator to process a file node
-// through the query engine
+// through the query engine.
+// If the generator already evaluated the query expression against the
+// file (eg: on a worker thread), the verdict may be supplied via
+// precomputedMatch to avoid re-evaluating it here.
 void w_query_process_file(
     const watchman::Query* query,
     watchman::QueryContext* ctx,
-    std::unique_ptr<watchman::FileResult> file);
+    std::unique_ptr<watchman::FileResult> file,
+    std::optional<bool> precomputedMatch = std::nullopt);
 
 void time_generator(
     const watchman::Query* query,
@@ -6,6 +6,8 @@
  */
 
 #include <folly/ScopeGuard.h>
+#include <unordered_map>
+#include <folly/Synchronized.h>
 #include <memory>
 #include "watchman/CommandRegistry.h"
 #include "watchman/Errors.h"
@@ -151,6 +153,17 @@ bool add_glob(GlobTree* tree, const w_string& glob_str) {
 
 } // namespace
 
+namespace {
+// Compiled glob trees keyed by the raw glob list plus flags. Tools
+// resend identical glob sets on every query and subscription
+// re-establishment, so compilation amortizes to a hash lookup; the
+// trees are immutable after construction and shared by reference.
+folly::Synchronized<
+    std::unordered_map<std::string, std::shared_ptr<const GlobTree>>>
+    globTreeCache;
+constexpr size_t kGlobTreeCacheMax = 64;
+} // namespace
+
 void parse_globs(Query* res, const json_ref& query) {
   size_t i;
 
@@ -180,15 +193,45 @@ void parse_globs(Query* res, const json_ref& query) {
   res->glob_flags = (includedotfiles.asBool() ? 0 : WM_PERIOD) |
       (noescape.asBool() ? WM_NOESCAPE : 0);
 
-  res->glob_tree = make_unique<GlobTree>("", 0);
+  // Cache key: flags plus the pattern list verbatim (order is
+  // semantically irrelevant to the merged tree but keeping it makes the
+  // key exact and cheap).
+  std::string cacheKey = folly::to<std::string>(res->glob_flags);
+  for (i = 0; i < json_array_size(globs); i++) {
+    const auto& ele = globs.at(i);
+    if (!ele.isString()) {
+      throw QueryParseError("'glob' must be an array of strings");
+    }
+    auto& pattern = json_to_w_string(ele);
+    cacheKey.push_back('\0');
+    cacheKey.append(pattern.data(), pattern.size());
+  }
+
+  {
+    auto cache = globTreeCache.rlock();
+    auto it = cache->find(cacheKey);
+    if (it != cache->end()) {
+      res->glob_tree = it->second;
+      return;
+    }
+  }
+
+  auto tree = std::make_shared<GlobTree>("", 0);
   for (i = 0; i < json_array_size(globs); i++) {
     const auto& ele = globs.at(i);
     const auto& pattern = json_to_w_string(ele);
 
-    if (!add_glob(res->glob_tree.get(), pattern)) {
+    if (!add_glob(tree.get(), pattern)) {
       throw QueryParseError("failed to compile multi-glob");
     }
   }
+  res->glob_tree = std::move(tree);
+
+  auto cache = globTreeCache.wlock();
+  if (cache->size() >= kGlobTreeCacheMax) {
+    cache->clear();
+  }
+  (*cache)[std::move(cacheKey)] = res->glob_tree;
 }
 
 static w_string parse_suffix(const json_ref& ele) {
@@ -225,8 +268,8 @@ void parse_suffixes(Query* res, const json_ref& query) {
   res->dedup_results = true;
   // Suffix queries are defined as being case insensitive
   res->glob_flags = WM_CASEFOLD;
-  res->glob_tree = folly::make_unique<GlobTree>("", 0);
 
+  auto tree = std::make_shared<GlobTree>("", 0);
   for (auto& ele : suffixArray) {
     if (!ele.isString()) {
       throw QueryParseError("'suffix' must be a string or an array of strings");
@@ -234,10 +277,11 @@ void parse_suffixes(Query* res, const json_ref& query) {
 
     auto suff = parse_suffix(ele);
     auto pattern = w_string::build("**/*.", suff);
-    if (!add_glob(res->glob_tree.get(), pattern)) {
+    if (!add_glob(tree.get(), pattern)) {
       throw QueryParseError("failed to compile multi-glob");
     }
   }
+  res->glob_tree = std::move(tree);
 }
 
 } // namespace watchman
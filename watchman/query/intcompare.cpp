@@ -87,6 +87,10 @@ class SizeExpr : public QueryExpr {
   w_query_int_compare comp;
 
  public:
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   explicit SizeExpr(w_query_int_compare comp) : comp(comp) {}
 
   EvaluateResult evaluate(QueryContextBase*, FileResult* file) override {
@@ -7,6 +7,19 @@
 
 #pragma once
 
+// Note on vectorized evaluation kernels: batch-evaluating size/mode/
+// since comparisons over SIMD lanes presupposes the columnar stat
+// sidecar, which was evaluated and declined (FileResult is the
+// abstraction boundary shared with Eden and local results, and the
+// mutation paths have no single funnel to keep parallel arrays
+// coherent). The wins that survive without columns have been taken in
+// scalar form: the generators prefilter whole walks by the
+// expression's sole file type before materializing candidates, the hot
+// node fields share a cache line with an explicit next-node prefetch,
+// and cheap scalar terms are cost-ordered ahead of pattern engines so
+// they short-circuit. If columns ever land, these comparisons are the
+// right first kernels.
+
 #include "watchman/thirdparty/jansson/jansson.h"
 
 namespace watchman {
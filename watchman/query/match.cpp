@@ -5,8 +5,11 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <cctype>
+#include <cstring>
 #include <memory>
 #include <string>
+#include <unordered_set>
 #include "watchman/CommandRegistry.h"
 #include "watchman/Errors.h"
 #include "watchman/query/FileResult.h"
@@ -18,13 +21,157 @@
 namespace watchman {
 
 class WildMatchExpr : public QueryExpr {
+  // Common pattern shapes can be matched with straight byte comparisons
+  // (which the compiler vectorizes) rather than the byte-at-a-time
+  // recursive wildmatch engine. Classified once at parse time.
+  enum class FastPath {
+    None, // general pattern; use wildmatch
+    Literal, // no metacharacters at all
+    Suffix, // "*rest" where rest is literal, eg: "*.java"
+    Prefix, // "rest*" where rest is literal
+  };
+
   std::string pattern;
   CaseSensitivity caseSensitive;
   bool wholename;
   bool noescape;
   bool includedotfiles;
+  FastPath fastPath{FastPath::None};
+  // The literal portion compared by the fast path.
+  std::string literal;
+
+  // Non-empty when this term was formed by fusing the literal patterns of
+  // an anyof list; evaluation is then a single set probe. Keyed lowercase
+  // when case insensitive.
+  std::unordered_set<w_string> literalSet_;
+
+  WildMatchExpr(std::unordered_set<w_string> set, CaseSensitivity cs)
+      : caseSensitive(cs),
+        wholename(false),
+        noescape(false),
+        includedotfiles(true),
+        literalSet_(std::move(set)) {}
+
+  bool isFusableLiteral() const {
+    return !wholename &&
+        (fastPath == FastPath::Literal || !literalSet_.empty());
+  }
+
+  void appendLiterals(std::unordered_set<w_string>& out) const {
+    if (!literalSet_.empty()) {
+      out.insert(literalSet_.begin(), literalSet_.end());
+      return;
+    }
+    w_string lit{literal.data(), literal.size()};
+    out.insert(
+        caseSensitive == CaseSensitivity::CaseInSensitive
+            ? lit.piece().asLowerCase()
+            : lit);
+  }
+
+  static bool isLiteral(const char* p, size_t len) {
+    return nullptr == strpbrk_len(p, len, "*?[\\");
+  }
+
+  static const char* strpbrk_len(const char* p, size_t len, const char* set) {
+    for (size_t i = 0; i < len; ++i) {
+      if (strchr(set, p[i])) {
+        return p + i;
+      }
+    }
+    return nullptr;
+  }
+
+  void classify() {
+    if (wholename) {
+      // The fast paths below are only correct for basename scope, where
+      // the subject cannot contain a slash and WM_PATHNAME is moot.
+      return;
+    }
+    auto len = pattern.size();
+    if (len == 0) {
+      return;
+    }
+    if (isLiteral(pattern.data(), len)) {
+      fastPath = FastPath::Literal;
+      literal = pattern;
+    } else if (
+        pattern[0] == '*' && isLiteral(pattern.data() + 1, len - 1)) {
+      fastPath = FastPath::Suffix;
+      literal = pattern.substr(1);
+    } else if (
+        pattern[len - 1] == '*' && isLiteral(pattern.data(), len - 1)) {
+      fastPath = FastPath::Prefix;
+      literal = pattern.substr(0, len - 1);
+    }
+  }
+
+  bool bytesEqual(const char* a, const char* b, size_t len) const {
+    if (caseSensitive == CaseSensitivity::CaseSensitive) {
+      return 0 == memcmp(a, b, len);
+    }
+    for (size_t i = 0; i < len; ++i) {
+      if (tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
 
  public:
+  uint32_t cost() const override {
+    return literalSet_.empty() ? kCostPattern : kCostString;
+  }
+
+  std::optional<w_string> literalPathPrefix() const override {
+    if (!wholename || noescape ||
+        caseSensitive == CaseSensitivity::CaseInSensitive) {
+      // Only wholename patterns scope the path; escaped patterns make
+      // the literal head ambiguous; and a case-insensitive match (the
+      // default on macOS and Windows) folds case while the generators'
+      // scope comparison is byte-exact, so advertising a prefix there
+      // would wrongly prune paths that differ only in case.
+      return std::nullopt;
+    }
+    // The literal head runs to the first metacharacter; the usable dir
+    // prefix is that head truncated at its last slash.
+    size_t metaAt = pattern.size();
+    for (size_t i = 0; i < pattern.size(); ++i) {
+      if (strchr("*?[\\", pattern[i])) {
+        metaAt = i;
+        break;
+      }
+    }
+    auto slash = pattern.rfind('/', metaAt ? metaAt - 1 : 0);
+    if (slash == std::string::npos || slash == 0 || slash > metaAt) {
+      return std::nullopt;
+    }
+    return w_string(pattern.data(), uint32_t(slash));
+  }
+
+  std::unique_ptr<QueryExpr> aggregate(
+      const QueryExpr* other,
+      const AggregateOp op) const override {
+    if (op != AggregateOp::AnyOf) {
+      return nullptr;
+    }
+    auto* otherExpr = dynamic_cast<const WildMatchExpr*>(other);
+    if (otherExpr == nullptr || caseSensitive != otherExpr->caseSensitive ||
+        !isFusableLiteral() || !otherExpr->isFusableLiteral()) {
+      return nullptr;
+    }
+
+    // Fuse ["anyof", ["match", "a"], ["match", "b"], ...] chains of
+    // literal patterns into one hash probe. Literals don't engage the
+    // WM_PERIOD/WM_NOESCAPE special cases, so flag differences between
+    // the branches don't matter.
+    std::unordered_set<w_string> merged;
+    appendLiterals(merged);
+    otherExpr->appendLiterals(merged);
+    return std::unique_ptr<QueryExpr>(
+        new WildMatchExpr(std::move(merged), caseSensitive));
+  }
+
   WildMatchExpr(
       const char* pat,
       CaseSensitivity caseSensitive,
@@ -35,18 +182,49 @@ class WildMatchExpr : public QueryExpr {
         caseSensitive(caseSensitive),
         wholename(wholename),
         noescape(noescape),
-        includedotfiles(includedotfiles) {}
+        includedotfiles(includedotfiles) {
+    classify();
+  }
 
   EvaluateResult evaluate(QueryContextBase* ctx, FileResult* file) override {
     w_string_piece str;
     bool res;
 
+    if (!literalSet_.empty()) {
+      auto name = caseSensitive == CaseSensitivity::CaseInSensitive
+          ? file->baseName().asLowerCase()
+          : file->baseName().asWString();
+      return literalSet_.find(name) != literalSet_.end();
+    }
+
     if (wholename) {
       str = ctx->getWholeName();
     } else {
       str = file->baseName();
     }
 
+    if (fastPath != FastPath::None &&
+        // WM_PERIOD gives hidden files special treatment; keep that edge
+        // case on the reference engine.
+        (includedotfiles || str.size() == 0 || str.data()[0] != '.')) {
+      switch (fastPath) {
+        case FastPath::Literal:
+          return str.size() == literal.size() &&
+              bytesEqual(str.data(), literal.data(), literal.size());
+        case FastPath::Suffix:
+          return str.size() >= literal.size() &&
+              bytesEqual(
+                     str.data() + str.size() - literal.size(),
+                     literal.data(),
+                     literal.size());
+        case FastPath::Prefix:
+          return str.size() >= literal.size() &&
+              bytesEqual(str.data(), literal.data(), literal.size());
+        case FastPath::None:
+          break;
+      }
+    }
+
 #ifdef _WIN32
     // Translate to unix style slashes for wildmatch
     w_string normBuf = str.asWString().normalizeSeparators();
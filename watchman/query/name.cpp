@@ -11,6 +11,7 @@
 #include "watchman/query/QueryExpr.h"
 #include "watchman/query/TermRegistry.h"
 
+#include <algorithm>
 #include <unordered_set>
 
 using namespace watchman;
@@ -142,6 +143,42 @@ class NameExpr : public QueryExpr {
     return std::unique_ptr<QueryExpr>(data);
   }
 
+  std::unique_ptr<QueryExpr> aggregate(
+      const QueryExpr* other,
+      const AggregateOp op) const override {
+    if (op != AggregateOp::AnyOf) {
+      return nullptr;
+    }
+    auto* otherExpr = dynamic_cast<const NameExpr*>(other);
+    if (otherExpr == nullptr || caseSensitive != otherExpr->caseSensitive ||
+        wholename != otherExpr->wholename) {
+      return nullptr;
+    }
+
+    // ["anyof", ["name", ...], ["name", ...], ...] lists fuse into a
+    // single set probe instead of a linear chain of branch evaluations.
+    std::unordered_set<w_string> merged;
+    merged.reserve(
+        std::max<size_t>(set.size(), 1) +
+        std::max<size_t>(otherExpr->set.size(), 1));
+    auto appendTo = [&](const NameExpr& expr) {
+      if (!expr.set.empty()) {
+        merged.insert(expr.set.begin(), expr.set.end());
+      } else {
+        // Single-name terms compare caselessly against the raw name, but
+        // the set is keyed lowercase when insensitive.
+        merged.insert(
+            caseSensitive == CaseSensitivity::CaseInSensitive
+                ? expr.name.piece().asLowerCase(expr.name.type())
+                : expr.name);
+      }
+    };
+    appendTo(*otherExpr);
+    appendTo(*this);
+    return std::unique_ptr<QueryExpr>(
+        new NameExpr(std::move(merged), caseSensitive, wholename));
+  }
+
   static std::unique_ptr<QueryExpr> parseName(
       Query* query,
       const json_ref& term) {
@@ -232,6 +232,47 @@ void parse_always_include_directories(Query* res, const json_ref& query) {
       parse_bool_param(query, "always_include_directories", false);
 }
 
+W_CAP_REG("stream_results")
+
+void parse_stream_results(Query* res, const json_ref& query) {
+  res->stream_results = parse_bool_param(query, "stream_results", false);
+}
+
+W_CAP_REG("prune_unchanged_dirs")
+
+void parse_prune_unchanged_dirs(Query* res, const json_ref& query) {
+  res->prune_unchanged_dirs =
+      parse_bool_param(query, "prune_unchanged_dirs", false);
+}
+
+void parse_explain(Query* res, const json_ref& query) {
+  res->explain = parse_bool_param(query, "explain", false);
+}
+
+W_CAP_REG("max_staleness_ms")
+
+W_CAP_REG("query-limit")
+
+void parse_limit(Query* res, const json_ref& query) {
+  auto value = query.get_default("limit", json_integer(0));
+  if (!value.isInt() || value.asInt() < 0) {
+    throw QueryParseError("limit must be an integer value >= 0");
+  }
+  res->limit = uint32_t(value.asInt());
+}
+
+void parse_cache_results(Query* res, const json_ref& query) {
+  res->cache_results = parse_bool_param(query, "cache_results", false);
+}
+
+void parse_max_staleness(Query* res, const json_ref& query) {
+  auto value = query.get_default("max_staleness_ms", json_integer(0));
+  if (!value.isInt() || value.asInt() < 0) {
+    throw QueryParseError("max_staleness_ms must be an integer value >= 0");
+  }
+  res->max_staleness = std::chrono::milliseconds(value.asInt());
+}
+
 void parse_benchmark(Query* res, const json_ref& query) {
   // Preserve behavior by supporting a boolean value. Also support int values.
   auto bench = query.get_default("bench");
@@ -275,6 +316,12 @@ std::shared_ptr<Query> parseQuery(
   parse_fail_if_no_saved_state(res, query);
   parse_omit_changed_files(res, query);
   parse_always_include_directories(res, query);
+  parse_stream_results(res, query);
+  parse_prune_unchanged_dirs(res, query);
+  parse_explain(res, query);
+  parse_max_staleness(res, query);
+  parse_cache_results(res, query);
+  parse_limit(res, query);
 
   /* Look for path generators */
   parse_paths(res, query);
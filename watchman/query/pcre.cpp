@@ -16,28 +16,117 @@
 
 #ifdef HAVE_PCRE_H
 
+#include <folly/Synchronized.h>
 #include <pcre.h> // @manual
+#include <unordered_map>
 
 using namespace watchman;
 
-class PcreExpr : public QueryExpr {
-  pcre* re;
-  pcre_extra* extra;
-  bool wholename;
+namespace {
 
- public:
-  explicit PcreExpr(pcre* re, pcre_extra* extra, bool wholename)
-      : re(re), extra(extra), wholename(wholename) {}
+/**
+ * A compiled (and, where the pcre build supports it, JIT compiled)
+ * pattern. Shared across every query using the same pattern and flags;
+ * pcre_exec is thread safe against a const compiled pattern.
+ */
+struct CompiledPcre {
+  pcre* re{nullptr};
+  pcre_extra* extra{nullptr};
 
-  ~PcreExpr() override {
+  ~CompiledPcre() {
+    if (extra) {
+#ifdef PCRE_CONFIG_JIT
+      pcre_free_study(extra);
+#else
+      pcre_free(extra);
+#endif
+    }
     if (re) {
       pcre_free(re);
     }
-    if (extra) {
-      pcre_free(extra);
+  }
+};
+
+// Subscriptions re-establish identical pcre queries on every reconnect,
+// so cache compiled patterns process-wide. The key embeds the case
+// sensitivity. Deliberately simple: patterns in active use are few, and
+// on overflow we shed an arbitrary entry; its users keep their shared_ptr
+// alive until they finish.
+constexpr size_t kMaxCachedPatterns = 256;
+folly::Synchronized<
+    std::unordered_map<std::string, std::shared_ptr<CompiledPcre>>>
+    compiledPatternCache;
+
+std::shared_ptr<CompiledPcre>
+compileCached(const char* pattern, bool caseless, const char* which) {
+  auto key = folly::to<std::string>(caseless ? "i:" : "s:", pattern);
+
+  {
+    auto cache = compiledPatternCache.rlock();
+    auto it = cache->find(key);
+    if (it != cache->end()) {
+      return it->second;
     }
   }
 
+  const char* errptr = nullptr;
+  int erroff = 0;
+  int errcode = 0;
+
+  auto* re = pcre_compile2(
+      pattern,
+      caseless ? PCRE_CASELESS : 0,
+      &errcode,
+      &errptr,
+      &erroff,
+      nullptr);
+  if (!re) {
+    throw QueryParseError(folly::to<std::string>(
+        "invalid ",
+        which,
+        ": code ",
+        errcode,
+        " ",
+        errptr,
+        " at offset ",
+        erroff,
+        " in ",
+        pattern));
+  }
+
+  auto compiled = std::make_shared<CompiledPcre>();
+  compiled->re = re;
+  compiled->extra = pcre_study(
+      re,
+#ifdef PCRE_STUDY_JIT_COMPILE
+      PCRE_STUDY_JIT_COMPILE,
+#else
+      0,
+#endif
+      &errptr);
+
+  auto cache = compiledPatternCache.wlock();
+  if (cache->size() >= kMaxCachedPatterns) {
+    cache->erase(cache->begin());
+  }
+  auto [it, _] = cache->emplace(std::move(key), std::move(compiled));
+  return it->second;
+}
+
+} // namespace
+
+class PcreExpr : public QueryExpr {
+  std::shared_ptr<CompiledPcre> compiled;
+  bool wholename;
+
+ public:
+  uint32_t cost() const override {
+    return kCostPattern;
+  }
+
+  explicit PcreExpr(std::shared_ptr<CompiledPcre> compiled, bool wholename)
+      : compiled(std::move(compiled)), wholename(wholename) {}
+
   EvaluateResult evaluate(QueryContextBase* ctx, FileResult* file) override {
     w_string_piece str;
     int rc;
@@ -48,7 +137,8 @@ class PcreExpr : public QueryExpr {
       str = file->baseName();
     }
 
-    rc = pcre_exec(re, extra, str.data(), str.size(), 0, 0, nullptr, 0);
+    rc = pcre_exec(
+        compiled->re, compiled->extra, str.data(), str.size(), 0, 0, nullptr, 0);
 
     if (rc == PCRE_ERROR_NOMATCH) {
       return false;
@@ -65,10 +155,6 @@ class PcreExpr : public QueryExpr {
     const char *pattern, *scope = "basename";
     const char* which =
         caseSensitive == CaseSensitivity::CaseInSensitive ? "ipcre" : "pcre";
-    pcre* re;
-    const char* errptr = nullptr;
-    int erroff = 0;
-    int errcode = 0;
 
     if (term.array().size() > 1 && term.at(1).isString()) {
       pattern = json_string_value(term.at(1));
@@ -93,29 +179,12 @@ class PcreExpr : public QueryExpr {
           "Invalid scope '", scope, "' for ", which, " expression"));
     }
 
-    re = pcre_compile2(
-        pattern,
-        caseSensitive == CaseSensitivity::CaseInSensitive ? PCRE_CASELESS : 0,
-        &errcode,
-        &errptr,
-        &erroff,
-        nullptr);
-    if (!re) {
-      throw QueryParseError(folly::to<std::string>(
-          "invalid ",
-          which,
-          ": code ",
-          errcode,
-          " ",
-          errptr,
-          " at offset ",
-          erroff,
-          " in ",
-          pattern));
-    }
-
     return std::make_unique<PcreExpr>(
-        re, pcre_study(re, 0, &errptr), !strcmp(scope, "wholename"));
+        compileCached(
+            pattern,
+            caseSensitive == CaseSensitivity::CaseInSensitive,
+            which),
+        !strcmp(scope, "wholename"));
   }
   static std::unique_ptr<QueryExpr> parsePcre(
       Query* query,
@@ -38,6 +38,10 @@ class SinceExpr : public QueryExpr {
   enum since_what field;
 
  public:
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   explicit SinceExpr(std::unique_ptr<ClockSpec> spec, enum since_what field)
       : spec(std::move(spec)), field(field) {}
 
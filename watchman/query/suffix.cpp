@@ -12,31 +12,93 @@
 #include "watchman/query/QueryExpr.h"
 #include "watchman/query/TermRegistry.h"
 
+#include <cctype>
+#include <cstring>
 #include <memory>
 #include <unordered_set>
+#include <vector>
 
 using namespace watchman;
 
 class SuffixExpr : public QueryExpr {
   std::unordered_set<w_string> suffixSet_;
 
+  // Suffixes bucketed by length; index is the suffix length in bytes.
+  // Evaluation peels the basename's suffix in place and only compares it
+  // against stored suffixes of the same length, avoiding the per-file
+  // lowercase allocation and hash the set lookup used to pay.
+  std::vector<std::vector<w_string>> byLen_;
+
+  // Multi-dot suffixes (eg: "tar.gz") don't fit the last-dot scan below;
+  // when any are present we keep the legacy evaluation path.
+  bool useLegacyPath_{false};
+
+  void buildIndex() {
+    for (auto const& suffix : suffixSet_) {
+      if (memchr(suffix.data(), '.', suffix.size())) {
+        useLegacyPath_ = true;
+        byLen_.clear();
+        return;
+      }
+      if (suffix.size() >= byLen_.size()) {
+        byLen_.resize(suffix.size() + 1);
+      }
+      byLen_[suffix.size()].push_back(suffix);
+    }
+  }
+
+  static bool foldedEqual(const char* name, const w_string& lower) {
+    for (size_t i = 0; i < lower.size(); ++i) {
+      if (tolower((unsigned char)name[i]) != lower.data()[i]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
  public:
   explicit SuffixExpr(std::unordered_set<w_string>&& suffixSet)
-      : suffixSet_(std::move(suffixSet)) {}
+      : suffixSet_(std::move(suffixSet)) {
+    buildIndex();
+  }
 
   EvaluateResult evaluate(QueryContextBase*, FileResult* file) override {
-    if (suffixSet_.size() < 3) {
-      // For small suffix sets, benchmarks indicated that iteration provides
-      // better performance since no suffix allocation is necessary.
-      for (auto const& suffix : suffixSet_) {
-        if (file->baseName().hasSuffix(suffix)) {
-          return true;
+    if (useLegacyPath_) {
+      if (suffixSet_.size() < 3) {
+        // For small suffix sets, benchmarks indicated that iteration provides
+        // better performance since no suffix allocation is necessary.
+        for (auto const& suffix : suffixSet_) {
+          if (file->baseName().hasSuffix(suffix)) {
+            return true;
+          }
         }
+        return false;
       }
+      auto suffix = file->baseName().asLowerCaseSuffix();
+      return suffix && (suffixSet_.find(suffix) != suffixSet_.end());
+    }
+
+    auto name = file->baseName();
+    const char* data = name.data();
+    size_t n = name.size();
+    size_t i = n;
+    while (i > 0 && data[i - 1] != '.') {
+      --i;
+    }
+    if (i == 0) {
+      // No suffix at all
       return false;
     }
-    auto suffix = file->baseName().asLowerCaseSuffix();
-    return suffix && (suffixSet_.find(suffix) != suffixSet_.end());
+    size_t len = n - i;
+    if (len >= byLen_.size()) {
+      return false;
+    }
+    for (auto const& suffix : byLen_[len]) {
+      if (foldedEqual(data + i, suffix)) {
+        return true;
+      }
+    }
+    return false;
   }
 
   static std::unique_ptr<QueryExpr> parse(Query*, const json_ref& term) {
@@ -19,8 +19,16 @@ class TypeExpr : public QueryExpr {
   char arg;
 
  public:
+  uint32_t cost() const override {
+    return kCostTrivial;
+  }
+
   explicit TypeExpr(char arg) : arg(arg) {}
 
+  std::optional<char> soleTypeFilter() const override {
+    return arg;
+  }
+
   EvaluateResult evaluate(QueryContextBase*, FileResult* file) override {
     auto optionalDtype = file->dtype();
     if (!optionalDtype.has_value()) {
@@ -104,5 +112,40 @@ class TypeExpr : public QueryExpr {
 };
 W_TERM_PARSER(type, TypeExpr::parse);
 
+namespace watchman {
+
+bool modeMatchesTypeChar(mode_t mode, char typeChar) {
+  switch (typeChar) {
+#ifndef _WIN32
+    case 'b':
+      return S_ISBLK(mode);
+    case 'c':
+      return S_ISCHR(mode);
+    case 'p':
+      return S_ISFIFO(mode);
+    case 's':
+      return S_ISSOCK(mode);
+#endif
+    case 'd':
+      return S_ISDIR(mode);
+    case 'f':
+      return S_ISREG(mode);
+    case 'l':
+#ifndef _WIN32
+      return S_ISLNK(mode);
+#else
+      return false;
+#endif
+#ifdef S_ISDOOR
+    case 'D':
+      return S_ISDOOR(mode);
+#endif
+    default:
+      return false;
+  }
+}
+
+} // namespace watchman
+
 /* vim:ts=2:sw=2:et:
  */
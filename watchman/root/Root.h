@@ -62,6 +62,13 @@ class ClientStateAssertions {
   /** Returns true if `assertion` currently has an Asserted disposition */
   bool isStateAsserted(w_string stateName) const;
 
+  /** True when no state assertions exist at all; the common case, and
+   * the cheap pre-check for the per-subscription policy probes that run
+   * at every settle. */
+  bool empty() const {
+    return states_.empty();
+  }
+
   /** Add assertion to the queue of assertions for assertion->name.
    * Throws if the named state is already asserted or if there is
    * a pending assertion for that state. */
@@ -13,10 +13,12 @@ void watchman_dir::Deleter::operator()(watchman_file* file) const {
 }
 
 watchman_dir::watchman_dir(w_string name, watchman_dir* parent)
-    : name(std::move(name)), parent(parent) {}
+    : name(std::move(name)), parent(parent) {
+  full_path = parent ? parent->getFullPathToChild(this->name) : this->name;
+}
 
 w_string watchman_dir::getFullPath() const {
-  return getFullPathToChild(w_string_piece());
+  return full_path;
 }
 
 watchman_file* watchman_dir::getChildFile(w_string_piece name) const {
@@ -27,6 +29,17 @@ watchman_file* watchman_dir::getChildFile(w_string_piece name) const {
   return it->second.get();
 }
 
+watchman_file* watchman_dir::getChildFileCaseInsensitive(
+    w_string_piece name) const {
+  for (auto& it : files) {
+    if (it.first.size() == name.size() &&
+        it.first.startsWithCaseInsensitive(name)) {
+      return it.second.get();
+    }
+  }
+  return nullptr;
+}
+
 watchman_dir* watchman_dir::getChildDir(w_string_piece name) const {
   auto it = dirs.find(name);
   if (it == dirs.end()) {
@@ -6,10 +6,21 @@
  */
 
 #include "watchman/watchman_file.h"
+#include "watchman/FileNodeArena.h"
 #ifdef __APPLE__
 #include <sys/attr.h> // @manual
 #endif
 
+namespace {
+/* Allocation header stored immediately before each watchman_file node,
+ * recording where the storage came from so that free_file_node can return
+ * it to the right place. */
+struct FileNodeAllocHeader {
+  watchman::FileNodeArena* arena;
+  size_t size;
+};
+} // namespace
+
 void watchman_file::removeFromFileList() {
   if (next) {
     next->prev = prev;
@@ -34,9 +45,16 @@ void watchman_file::removeFromFileList() {
  */
 std::unique_ptr<watchman_file, watchman_dir::Deleter> watchman_file::make(
     const w_string& name,
-    watchman_dir* parent) {
-  auto file = (watchman_file*)calloc(
-      1, sizeof(watchman_file) + sizeof(uint32_t) + name.size() + 1);
+    watchman_dir* parent,
+    watchman::FileNodeArena* arena) {
+  size_t size = sizeof(FileNodeAllocHeader) + sizeof(watchman_file) +
+      sizeof(uint32_t) + name.size() + 1;
+  auto header = (FileNodeAllocHeader*)(arena ? arena->allocate(size)
+                                             : calloc(1, size));
+  header->arena = arena;
+  header->size = size;
+
+  auto file = (watchman_file*)(header + 1);
   std::unique_ptr<watchman_file, watchman_dir::Deleter> filePtr(
       file, watchman_dir::Deleter());
 
@@ -59,7 +77,12 @@ watchman_file::~watchman_file() {
 
 void free_file_node(struct watchman_file* file) {
   file->~watchman_file();
-  free(file);
+  auto header = ((FileNodeAllocHeader*)file) - 1;
+  if (header->arena) {
+    header->arena->release(header, header->size);
+  } else {
+    free(header);
+  }
 }
 
 /* vim:ts=2:sw=2:et:
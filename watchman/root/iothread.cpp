@@ -6,9 +6,20 @@
  */
 
 #include <fmt/chrono.h>
+#include <folly/ScopeGuard.h>
+#include <folly/futures/Future.h>
+#include <folly/stop_watch.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <limits>
 #include "watchman/Errors.h"
 #include "watchman/InMemoryView.h"
+#include "watchman/LatencyHistogram.h"
+#include "watchman/ThreadPool.h"
+#include "watchman/Tracing.h"
+#include "watchman/fs/BufferedDirHandle.h"
+#include "watchman/fs/FileSystem.h"
 #include "watchman/root/Root.h"
 #include "watchman/root/warnerr.h"
 #include "watchman/watcher/Watcher.h"
@@ -31,45 +42,112 @@ void InMemoryView::fullCrawl(
     PendingChanges& localPending) {
   root->recrawlInfo.wlock()->crawlStart = std::chrono::steady_clock::now();
 
+  activeCrawlProfile_ = std::make_unique<CrawlProfile>();
+  activeCrawlProfile_->started = std::chrono::system_clock::now();
+
+  // If a snapshot of a prior incarnation of this view is available, load
+  // it now so that the crawl below turns into a comparison pass over the
+  // restored state. Only the first crawl can restore; recrawls proceed
+  // against the already-populated view.
+  maybeRestoreViewSnapshot();
+
   PerfSample sample("full-crawl");
 
-  auto view = view_.wlock();
   // Ensure that we observe these files with a new, distinct clock,
   // otherwise a fresh subscription established immediately after a watch
   // can get stuck with an empty view until another change is observed
   mostRecentTick_.fetch_add(1, std::memory_order_acq_rel);
 
   auto start = std::chrono::system_clock::now();
-  pendingFromWatcher.lock()->add(root->root_path, start, W_PENDING_RECURSIVE);
-  while (true) {
-    // There is the potential for a subtle race condition here.  Since we now
-    // coalesce overlaps we must consume our outstanding set before we merge
-    // in any new kernel notification information or we risk missing out on
-    // observing changes that happen during the initial crawl.  This
-    // translates to a two level loop; the outer loop sweeps in data from
-    // inotify, then the inner loop processes it and any dirs that we pick up
-    // from recursive processing.
+
+  // There is the potential for a subtle race condition here.  Since we now
+  // coalesce overlaps we must consume our outstanding set before we merge
+  // in any new kernel notification information or we risk missing out on
+  // observing changes that happen during the initial crawl.  This
+  // translates to a two level loop; the outer loop sweeps in data from
+  // inotify, then the inner loop processes it and any dirs that we pick up
+  // from recursive processing.
+  auto drain = [&] {
+    while (true) {
+      {
+        auto lock = pendingFromWatcher.lockAndDrain();
+        localPending.append(lock->stealItems(), lock->stealSyncs());
+      }
+      if (localPending.empty()) {
+        break;
+      }
+
+      (void)processAllPending(root, view_, localPending);
+    }
+  };
+
+  // Hot directories named by crawl_priority_dirs are crawled to
+  // completion before the general walk begins, so early queries scoped
+  // to them (the src/ and tools/ of the world) can be answered while
+  // the rest of the tree is still being discovered. This must be a
+  // separate drain pass: adding the recursive root entry prunes any
+  // queued subtree entries, so priority dirs can't simply be queued
+  // ahead of it. The root walk re-visits these subtrees, which is
+  // harmless since their state is then already known.
+  auto priorityDirs = config_.get("crawl_priority_dirs");
+  if (priorityDirs && priorityDirs.isArray() &&
+      json_array_size(priorityDirs)) {
     {
       auto lock = pendingFromWatcher.lock();
-      localPending.append(lock->stealItems(), lock->stealSyncs());
-    }
-    if (localPending.empty()) {
-      break;
+      for (size_t i = 0; i < json_array_size(priorityDirs); ++i) {
+        const auto& name = priorityDirs.at(i);
+        if (!name.isString()) {
+          continue;
+        }
+        lock->add(
+            w_string::pathCat({root->root_path, json_to_w_string(name)}),
+            start,
+            W_PENDING_RECURSIVE);
+      }
     }
-
-    (void)processAllPending(root, *view, localPending);
+    drain();
   }
 
+  pendingFromWatcher.lock()->add(root->root_path, start, W_PENDING_RECURSIVE);
+  drain();
+
   auto recrawlInfo = root->recrawlInfo.wlock();
   recrawlInfo->shouldRecrawl = false;
   recrawlInfo->crawlFinish = std::chrono::steady_clock::now();
   root->inner.done_initial.store(true, std::memory_order_release);
 
+  // Restored named cursors are only meaningful if the tick space
+  // actually carried over from the previous incarnation — ie: a view
+  // snapshot restored successfully. If it didn't (first run with the
+  // option, lost or corrupt snapshot file), ticks restarted near zero
+  // and a saved cursor ahead of the clock would make `since n:cursor`
+  // queries silently return nothing until the counter catches up; drop
+  // such cursors so consumers get the documented fresh-instance
+  // response instead.
+  {
+    auto currentTick = mostRecentTick_.load(std::memory_order_acquire);
+    auto cursors = root->inner.cursors.wlock();
+    auto it = cursors->begin();
+    while (it != cursors->end()) {
+      if (it->second > currentTick) {
+        logf(
+            ERR,
+            "dropping restored cursor {} ({} > current tick {}): "
+            "tick space did not carry over\n",
+            it->first,
+            it->second,
+            currentTick);
+        it = cursors->erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
   // There is no need to hold locks while logging, and abortAllCookies resolves
   // a Promise which can run arbitrary code, so locks must be released here.
   auto recrawlCount = recrawlInfo->recrawlCount;
   recrawlInfo.unlock();
-  view.unlock();
 
   root->cookies.abortAllCookies();
 
@@ -79,6 +157,22 @@ void InMemoryView::fullCrawl(
   sample.force_log();
   sample.log();
 
+  if (activeCrawlProfile_) {
+    activeCrawlProfile_->finished = std::chrono::system_clock::now();
+    std::sort(
+        activeCrawlProfile_->slowest.begin(),
+        activeCrawlProfile_->slowest.end(),
+        [](const CrawlProfile::SlowDir& a, const CrawlProfile::SlowDir& b) {
+          return a.durationUs > b.durationUs;
+        });
+    auto profiles = crawlProfiles_.wlock();
+    if (profiles->size() >= kRetainedCrawlProfiles) {
+      profiles->pop_front();
+    }
+    profiles->push_back(std::move(*activeCrawlProfile_));
+    activeCrawlProfile_.reset();
+  }
+
   logf(ERR, "{}crawl complete\n", recrawlCount ? "re" : "");
 }
 
@@ -93,7 +187,16 @@ InMemoryView::Continue InMemoryView::doSettleThings(
             std::chrono::steady_clock::now() - *state.lastUnsettle)
       : std::chrono::milliseconds{0};
 
+  lastSettle_.store(
+      std::chrono::steady_clock::now().time_since_epoch().count(),
+      std::memory_order_release);
+
   warmContentCache();
+  maybeSaveViewSnapshot();
+  maybeEnforceMemoryBudget(root);
+
+  tracing::recordSpan(lastDrainTraceId_, "settled_broadcast");
+  lastDrainTraceId_ = 0;
 
   root.unilateralResponses->enqueue(json_object({{"settled", json_true()}}));
 
@@ -129,6 +232,42 @@ InMemoryView::Continue InMemoryView::doSettleThings(
   return Continue::Continue;
 }
 
+void InMemoryView::maybeEnforceMemoryBudget(Root& root) {
+  if (!maxRootMemoryBytes_) {
+    return;
+  }
+
+  size_t liveBytes = view_.rlock()->fileNodeArena().liveBytes();
+  if (liveBytes <= maxRootMemoryBytes_) {
+    memoryPressureShedAttempted_ = false;
+    return;
+  }
+
+  if (!memoryPressureShedAttempted_) {
+    memoryPressureShedAttempted_ = true;
+    logf(
+        ERR,
+        "root {} is over its memory budget ({} > {} bytes); shedding caches and forcing age-out\n",
+        rootPath_,
+        liveBytes,
+        maxRootMemoryBytes_);
+    caches_.contentHashCache.clear();
+    caches_.symlinkTargetCache.clear();
+    root.performAgeOut(std::chrono::seconds(0));
+    return;
+  }
+
+  // Still over budget after shedding: this root is beyond help and must
+  // not be allowed to take down the roots sharing this daemon.
+  logf(
+      ERR,
+      "root {} remains over its memory budget ({} > {} bytes) after shedding; cancelling watch\n",
+      rootPath_,
+      liveBytes,
+      maxRootMemoryBytes_);
+  root.cancel();
+}
+
 void InMemoryView::clientModeCrawl(const std::shared_ptr<Root>& root) {
   PendingChanges pending;
   fullCrawl(root, pendingFromWatcher_, pending);
@@ -169,7 +308,43 @@ InMemoryView::Continue InMemoryView::stepIoThread(
   }
 
   auto markUnsettled = [&](IoThreadState& state) {
-    state.lastUnsettle = std::chrono::steady_clock::now();
+    auto now = std::chrono::steady_clock::now();
+
+    if (adaptiveSettle_) {
+      // Track how bursty this root currently is via an EWMA of the gaps
+      // between unsettles, then derive the settle window from it: widely
+      // spaced events are a sign of a lone save, so notify at close to
+      // kernel latency; tightly packed events mean a build or checkout
+      // is churning, so wait longer for it to die down. trigger_settle
+      // acts as the ceiling, preserving the old behavior under sustained
+      // churn.
+      if (state.lastUnsettle) {
+        constexpr double kAlpha = 0.2;
+        double gap = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         now - *state.lastUnsettle)
+                         .count();
+        state.ewmaUnsettleGapMs = state.ewmaUnsettleGapMs == 0.0
+            ? gap
+            : kAlpha * gap + (1.0 - kAlpha) * state.ewmaUnsettleGapMs;
+      }
+
+      double floorMs = adaptiveSettleFloor_.count();
+      double ceilMs = std::max<double>(root->trigger_settle.count(), floorMs);
+      double gapMs = std::clamp(state.ewmaUnsettleGapMs, floorMs, ceilMs);
+      // Interpolate inversely: small gaps (churn) map to the ceiling,
+      // large gaps (quiet) map to the floor.
+      double settleMs = ceilMs == floorMs
+          ? floorMs
+          : floorMs +
+              (ceilMs - floorMs) * (ceilMs - gapMs) / (ceilMs - floorMs);
+
+      state.lastUnsettle = now;
+      state.currentTimeout =
+          std::chrono::milliseconds(std::lround(settleMs));
+      return;
+    }
+
+    state.lastUnsettle = now;
     // Reduce sleep timeout to the settle duration ready for the next loop
     // through.
     state.currentTimeout = root->trigger_settle;
@@ -233,16 +408,31 @@ InMemoryView::Continue InMemoryView::stepIoThread(
   //
   // Careful with this knob: it adds latency to every query by delaying cookie
   // processing.
-  auto notify_sleep_ms = config_.getInt("notify_sleep_ms", 0);
-  if (notify_sleep_ms) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(notify_sleep_ms));
+  if (notifySleep_.count()) {
+    std::this_thread::sleep_for(notifySleep_);
   }
 
-  auto view = view_.wlock();
+  auto tickNow = mostRecentTick_.fetch_add(1, std::memory_order_acq_rel);
 
-  mostRecentTick_.fetch_add(1, std::memory_order_acq_rel);
+  // Tick values are 32 bits and every since comparison in the query
+  // layer assumes they do not wrap. At one tick per drained batch a
+  // wrap takes years, but a daemon that gets there would corrupt since
+  // semantics silently, so start shouting well before the cliff; a
+  // restart renumbers the root and resets the space.
+  if (tickNow == (uint32_t(1) << 31)) {
+    logf(
+        ERR,
+        "root {} has consumed half of its 32-bit tick space; "
+        "schedule a watchman restart before it wraps\n",
+        rootPath_);
+  }
+
+  static LatencyHistogram drainLatency("iothread_drain");
+  folly::stop_watch<std::chrono::microseconds> drainTimer;
 
-  auto isDesynced = processAllPending(root, *view, state.localPending);
+  auto isDesynced = processAllPending(root, view_, state.localPending);
+
+  drainLatency.record(drainTimer.elapsed());
   if (isDesynced == IsDesynced::Yes) {
     logf(ERR, "recrawl complete, aborting all pending cookies\n");
     root->cookies.abortAllCookies();
@@ -256,7 +446,7 @@ InMemoryView::Continue InMemoryView::stepIoThread(
 
 InMemoryView::IsDesynced InMemoryView::processAllPending(
     const std::shared_ptr<Root>& root,
-    ViewDatabase& view,
+    folly::Synchronized<ViewDatabase>& viewSync,
     PendingChanges& coll) {
   auto desyncState = IsDesynced::No;
 
@@ -271,6 +461,11 @@ InMemoryView::IsDesynced InMemoryView::processAllPending(
   // to all pending change events.
   std::vector<w_string> pendingCookies;
 
+  auto view = viewSync.wlock();
+
+  // Number of items applied to the view since we last acquired the lock.
+  size_t itemsSinceAcquire = 0;
+
   while (!coll.empty()) {
     logf(
         DBG,
@@ -288,8 +483,30 @@ InMemoryView::IsDesynced InMemoryView::processAllPending(
       allSyncs.push_back(std::move(syncs));
     }
 
+    // Pre-stat the whole stolen batch concurrently before applying it.
+    // The stats are pure filesystem reads, so they must not be issued
+    // while we hold the view lock and block queries.
+    std::unordered_map<const watchman_pending_fs*, DirEntry> preStats;
+    if (enableStatPrefetch_ && pending && pending->next) {
+      view.unlock();
+      preStatBatch(*root, pending.get(), preStats);
+      view = viewSync.wlock();
+      itemsSinceAcquire = 0;
+    }
+
     while (pending) {
       if (!stopThreads_.load(std::memory_order_acquire)) {
+        if (ioThreadViewBatchSize_ &&
+            itemsSinceAcquire >= ioThreadViewBatchSize_) {
+          // Give any queries blocked on the view lock a chance to run
+          // before we continue draining. They may observe a partially
+          // applied batch, but anything that synchronized via cookies
+          // will not be unblocked until the entire drain completes below.
+          view.unlock();
+          view = viewSync.wlock();
+          itemsSinceAcquire = 0;
+        }
+
         if (pending->flags & W_PENDING_IS_DESYNCED) {
           // The watcher is desynced but some cookies might be written to disk
           // while the recursive crawl is ongoing. We are going to specifically
@@ -305,7 +522,16 @@ InMemoryView::IsDesynced InMemoryView::processAllPending(
         }
 
         // processPath may insert new pending items into `coll`
-        processPath(root, view, coll, *pending, nullptr, pendingCookies);
+        tracing::recordSpan(pending->traceId, "iothread_process");
+        if (pending->traceId) {
+          lastDrainTraceId_ = pending->traceId;
+        }
+        const DirEntry* preStat = nullptr;
+        if (auto it = preStats.find(pending.get()); it != preStats.end()) {
+          preStat = &it->second;
+        }
+        processPath(root, *view, coll, *pending, preStat, pendingCookies);
+        ++itemsSinceAcquire;
       }
 
       // TODO: Document that continuing to run this loop when stopThreads_ is
@@ -314,6 +540,24 @@ InMemoryView::IsDesynced InMemoryView::processAllPending(
     }
   }
 
+  // Apply any deferred dir tombstones now, in bounded slices, releasing
+  // the view lock between slices so queries can interleave with a big
+  // subtree removal. This must complete before cookies resolve so that
+  // synchronized clients observe the deletions; it also guarantees the
+  // tombstone queue is empty whenever the iothread is outside this
+  // function (eg: when ageOut runs and may erase dirs).
+  while (view->processSomeTombstones(
+      *watcher_,
+      ioThreadViewBatchSize_ ? ioThreadViewBatchSize_
+                             : std::numeric_limits<size_t>::max())) {
+    view.unlock();
+    view = viewSync.wlock();
+  }
+
+  // notifyCookie and the sync promises below can run arbitrary code, so
+  // don't hold the view lock across them.
+  view.unlock();
+
   for (auto& pendingCookie : pendingCookies) {
     if (processedPaths_) {
       // Record a fake entry to indicate when we unblocked the cookie in the
@@ -339,6 +583,70 @@ InMemoryView::IsDesynced InMemoryView::processAllPending(
   return desyncState;
 }
 
+void InMemoryView::markDirDeletedOrDefer(
+    ViewDatabase& view,
+    watchman_dir* dir,
+    ClockStamp otime) {
+  if (ioThreadViewBatchSize_) {
+    view.enqueueDirTombstone(dir, otime);
+    return;
+  }
+  view.markDirDeleted(*watcher_, dir, otime, true);
+}
+
+void InMemoryView::preStatBatch(
+    const Root& root,
+    const watchman_pending_fs* pending,
+    std::unordered_map<const watchman_pending_fs*, DirEntry>& preStats) {
+  // Bound the number of stats in flight; a rebase can easily deliver a
+  // six figure batch and we don't want to own the whole thread pool
+  // queue for its duration.
+  constexpr size_t kStatBatchSize = 4096;
+
+  std::vector<folly::Future<folly::Unit>> futures;
+
+  for (auto* p = pending; p; p = p->next.get()) {
+    if (p->flags & W_PENDING_CRAWL_ONLY) {
+      // Will be crawled rather than statted.
+      continue;
+    }
+    if (w_string_equal(p->path, rootPath_)) {
+      continue;
+    }
+    if (root.cookies.isCookiePrefix(p->path)) {
+      // Cookies never reach statPath.
+      continue;
+    }
+    if (root.ignore.isIgnoreDir(p->path)) {
+      continue;
+    }
+
+    // Note: references into preStats remain stable across inserts, so the
+    // tasks below may write through them while we keep adding entries.
+    auto& entry = preStats[p];
+    entry.has_stat = false;
+    entry.d_name = w_string_piece{p->path}.baseName().data();
+
+    futures.push_back(folly::via(&getThreadPool(), [this, p, &entry, &root] {
+      try {
+        entry.stat = fileSystem_.getFileInformation(
+            p->path.c_str(), root.case_sensitive);
+        entry.has_stat = true;
+      } catch (const std::system_error&) {
+        // Leave has_stat unset; statPath will re-issue the stat and run
+        // its usual error handling for this path.
+      }
+    }));
+
+    if (futures.size() >= kStatBatchSize) {
+      folly::collectAll(futures.begin(), futures.end()).wait();
+      futures.clear();
+    }
+  }
+
+  folly::collectAll(futures.begin(), futures.end()).wait();
+}
+
 void InMemoryView::processPath(
     const std::shared_ptr<Root>& root,
     ViewDatabase& view,
@@ -425,6 +733,40 @@ void InMemoryView::crawler(
   bool recursive = pending.flags.contains(W_PENDING_RECURSIVE);
   bool stat_all = pending.flags.contains(W_PENDING_NONRECURSIVE_SCAN);
 
+  // Attribute this dir's cost to the active crawl profile, if any.
+  std::chrono::steady_clock::time_point dirStart;
+  uint64_t entriesBefore = 0;
+  if (activeCrawlProfile_) {
+    dirStart = std::chrono::steady_clock::now();
+    entriesBefore = activeCrawlProfile_->entriesSeen;
+    ++activeCrawlProfile_->dirsCrawled;
+  }
+  SCOPE_EXIT {
+    if (activeCrawlProfile_) {
+      auto durationUs =
+          uint64_t(std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::steady_clock::now() - dirStart)
+                       .count());
+      auto entries = activeCrawlProfile_->entriesSeen - entriesBefore;
+      auto& slowest = activeCrawlProfile_->slowest;
+      if (slowest.size() < kSlowDirsPerCrawl) {
+        slowest.push_back(
+            CrawlProfile::SlowDir{pending.path, durationUs, entries});
+      } else {
+        auto min = std::min_element(
+            slowest.begin(),
+            slowest.end(),
+            [](const CrawlProfile::SlowDir& a,
+               const CrawlProfile::SlowDir& b) {
+              return a.durationUs < b.durationUs;
+            });
+        if (min->durationUs < durationUs) {
+          *min = CrawlProfile::SlowDir{pending.path, durationUs, entries};
+        }
+      }
+    }
+  };
+
   auto dir = view.resolveDir(pending.path, true);
 
   // Detect root directory replacement.
@@ -458,7 +800,7 @@ void InMemoryView::crawler(
     } catch (const std::system_error& err) {
       handle_open_errno(
           *root, dir, pending.now, "getFileInformation", err.code());
-      view.markDirDeleted(*watcher_, dir, getClock(pending.now), true);
+      markDirDeletedOrDefer(view, dir, getClock(pending.now));
       return;
     }
   }
@@ -478,10 +820,17 @@ void InMemoryView::crawler(
   } catch (const std::system_error& err) {
     logf(DBG, "startWatchDir({}) threw {}\n", path, err.what());
     handle_open_errno(*root, dir, pending.now, "opendir", err.code());
-    view.markDirDeleted(*watcher_, dir, getClock(pending.now), true);
+    markDirDeletedOrDefer(view, dir, getClock(pending.now));
     return;
   }
 
+  if (enableBufferedReaddir_) {
+    // Drain the dir on the thread pool so the blocking readdir round
+    // trips overlap the per-entry work below. This happens after
+    // startWatchDir so watch registration ordering is unchanged.
+    osdir = makeBufferedDirHandle(std::move(osdir));
+  }
+
   if (dir->files.empty()) {
     // Pre-size our hash(es) if we can, so that we can avoid collisions
     // and re-hashing during initial crawl
@@ -511,6 +860,15 @@ void InMemoryView::crawler(
     }
   }
 
+  // In parallel crawl mode, entries whose stat information was not provided
+  // by the DirHandle are accumulated here and their lstat calls are fanned
+  // out to the shared thread pool before being applied to the view serially.
+  struct DeferredStat {
+    PendingChange change;
+    std::optional<FileInformation> stat;
+  };
+  std::vector<DeferredStat> deferredStats;
+
   try {
     while (const DirEntry* dirent = osdir->readDir()) {
       // Don't follow parent/self links
@@ -519,6 +877,10 @@ void InMemoryView::crawler(
         continue;
       }
 
+      if (activeCrawlProfile_) {
+        ++activeCrawlProfile_->entriesSeen;
+      }
+
       // Queue it up for analysis if the file is newly existing
       w_string name(dirent->d_name, W_STRING_BYTE);
       struct watchman_file* file = dir->getChildFile(name);
@@ -528,6 +890,18 @@ void InMemoryView::crawler(
       if (!file || !file->exists || stat_all || recursive) {
         auto full_path = dir->getFullPathToChild(name);
 
+        // Prune ignored entries here rather than enqueueing them and
+        // letting statPath discover the ignore: with the gated ignore
+        // check this is a couple of instructions, and it keeps ignored
+        // subtrees out of the pending queue, the stat pipeline and the
+        // watcher registration path entirely. This mirrors the filter
+        // the FSEvents callback already applies at event time. Cookie
+        // files are direct children of the cookie dir and are never
+        // ignored by this predicate.
+        if (root->ignore.isIgnored(full_path.data(), full_path.size())) {
+          continue;
+        }
+
         PendingFlags newFlags;
         if (recursive || !file || !file->exists) {
           newFlags.set(W_PENDING_RECURSIVE);
@@ -544,7 +918,42 @@ void InMemoryView::crawler(
             newFlags.asRaw());
 
         PendingChange full_pending{std::move(full_path), pending.now, newFlags};
-        processPath(root, view, coll, full_pending, dirent, pendingCookies);
+        // Bulk subtree arrival (eg: a clone unpacked into the root
+        // announces itself as one new-dir event) always takes the
+        // concurrent stat path once the daemon is in steady state: the
+        // thread pool is guaranteed to be running after the initial
+        // crawl completes, and the serial fallback remains for client
+        // mode and initial crawls unless parallel_crawl opts them in.
+        bool statConcurrently = enableParallelCrawl_ ||
+            root->inner.done_initial.load(std::memory_order_acquire);
+        if (statConcurrently && !dirent->has_stat) {
+          deferredStats.push_back(
+              DeferredStat{std::move(full_pending), std::nullopt});
+        } else {
+#ifndef _WIN32
+          // Stat relative to the open directory fd when the handle
+          // didn't supply stat data. The kernel then resolves one
+          // component instead of re-walking the whole path prefix for
+          // every entry, which is where deep trees spend their crawl.
+          DirEntry relStat;
+          const DirEntry* entToUse = dirent;
+          int dfd = osdir->getFd();
+          if (!dirent->has_stat && dfd != -1) {
+            struct stat st;
+            if (fstatat(dfd, dirent->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+              relStat.has_stat = true;
+              relStat.d_name = dirent->d_name;
+              relStat.stat = FileInformation(st);
+              entToUse = &relStat;
+            }
+            // On failure fall through with the plain entry; statPath
+            // re-stats by full path and runs its error handling.
+          }
+          processPath(root, view, coll, full_pending, entToUse, pendingCookies);
+#else
+          processPath(root, view, coll, full_pending, dirent, pendingCookies);
+#endif
+        }
       }
     }
   } catch (const std::system_error& exc) {
@@ -558,6 +967,39 @@ void InMemoryView::crawler(
   }
   osdir.reset();
 
+  if (!deferredStats.empty()) {
+    // Issue the lstat calls concurrently; this is where the bulk of the
+    // time goes on a cold crawl of a large tree. View mutation stays on
+    // this thread: once all the stats have completed we feed the results
+    // through processPath in directory order, same as the serial path.
+    std::vector<folly::Future<folly::Unit>> statFutures;
+    statFutures.reserve(deferredStats.size());
+    for (auto& deferred : deferredStats) {
+      statFutures.push_back(folly::via(&getThreadPool(), [this, &deferred, &root] {
+        try {
+          deferred.stat = fileSystem_.getFileInformation(
+              deferred.change.path.c_str(), root->case_sensitive);
+        } catch (const std::system_error&) {
+          // Leave the stat unset; statPath will re-issue the stat below
+          // and run its usual error handling for this path.
+        }
+      }));
+    }
+    folly::collectAll(statFutures.begin(), statFutures.end()).wait();
+
+    for (auto& deferred : deferredStats) {
+      DirEntry preStat{};
+      const DirEntry* preStatPtr = nullptr;
+      if (deferred.stat.has_value()) {
+        preStat.has_stat = true;
+        preStat.d_name = deferred.change.path.baseName().data();
+        preStat.stat = *deferred.stat;
+        preStatPtr = &preStat;
+      }
+      processPath(root, view, coll, deferred.change, preStatPtr, pendingCookies);
+    }
+  }
+
   // Anything still in maybe_deleted is actually deleted.
   // Arrange to re-process it shortly
   for (auto& it : dir->files) {
@@ -649,8 +1091,13 @@ void InMemoryView::statPath(
   if (pre_stat && pre_stat->has_stat) {
     st = pre_stat->stat;
   } else {
-    try {
-      st = fileSystem_.getFileInformation(path.c_str(), root.case_sensitive);
+    // Use the exception-free stat: a mass deletion funnels tens of
+    // thousands of ENOENTs through here, and throw/unwind per missing
+    // path is measurable where an error return is not.
+    auto result =
+        fileSystem_.tryGetFileInformation(path.c_str(), root.case_sensitive);
+    if (result.hasValue()) {
+      st = result.value();
       log(DBG,
           "getFileInformation(",
           path,
@@ -659,8 +1106,8 @@ void InMemoryView::statPath(
           " dir=",
           fmt::ptr(dir_ent),
           "\n");
-    } catch (const std::system_error& exc) {
-      errcode = exc.code();
+    } else {
+      errcode = result.error();
       log(DBG,
           "getFileInformation(",
           path,
@@ -669,7 +1116,7 @@ void InMemoryView::statPath(
           " dir=",
           fmt::ptr(dir_ent),
           " failed: ",
-          exc.what(),
+          errcode.message(),
           "\n");
     }
   }
@@ -682,7 +1129,7 @@ void InMemoryView::statPath(
       errcode == error_code::not_a_directory) {
     /* it's not there, update our state */
     if (dir_ent) {
-      view.markDirDeleted(*watcher_, dir_ent, getClock(pending.now), true);
+      markDirDeletedOrDefer(view, dir_ent, getClock(pending.now));
       log(DBG,
           "getFileInformation(",
           path,
@@ -723,16 +1170,38 @@ void InMemoryView::statPath(
 
     if (root.case_sensitive == CaseSensitivity::CaseInSensitive &&
         dir_name != root.root_path && parentDir->last_check_existed) {
-      /* If we rejected the name because it wasn't canonical,
-       * we need to ensure that we look in the parent dir to discover
-       * the new item(s) */
-      logf(
-          DBG,
-          "we're case insensitive, and {} is ENOENT, "
-          "speculatively look at parent dir {}\n",
-          path,
-          dir_name);
-      coll.add(dir_name, pending.now, W_PENDING_CRAWL_ONLY);
+      /* If we rejected the name because it wasn't canonical, see if we
+       * already know a differently-cased sibling; re-examining just
+       * that entry is far cheaper than the speculative crawl of the
+       * whole parent dir. Note that the code above guarantees a node
+       * exists under the exact requested name (it creates a deleted
+       * node if needed), so the folded lookup always returns at least
+       * that node: only a live sibling whose name differs in case is
+       * interesting here — re-adding the requested name itself would
+       * re-stat the same ENOENT path forever. */
+      auto canonical = parentDir->getChildFileCaseInsensitive(file_name);
+      if (canonical && canonical->exists &&
+          canonical->getName() != w_string_piece{file_name}) {
+        auto canonicalPath =
+            parentDir->getFullPathToChild(canonical->getName());
+        logf(
+            DBG,
+            "case insensitive: {} is ENOENT but {} is known; "
+            "re-examining it\n",
+            path,
+            canonicalPath);
+        coll.add(canonicalPath, pending.now, PendingFlags{});
+      } else {
+        /* we need to ensure that we look in the parent dir to discover
+         * the new item(s) */
+        logf(
+            DBG,
+            "we're case insensitive, and {} is ENOENT, "
+            "speculatively look at parent dir {}\n",
+            path,
+            dir_name);
+        coll.add(dir_name, pending.now, W_PENDING_CRAWL_ONLY);
+      }
     }
 
   } else if (errcode.value()) {
@@ -830,7 +1299,7 @@ void InMemoryView::statPath(
     } else if (dir_ent) {
       // We transitioned from dir to file (see fishy.php), so we should prune
       // our former tree here
-      view.markDirDeleted(*watcher_, dir_ent, getClock(pending.now), true);
+      markDirDeletedOrDefer(view, dir_ent, getClock(pending.now));
     }
   }
 }
@@ -5,6 +5,8 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <thread>
+
 #include "watchman/Constants.h"
 #include "watchman/InMemoryView.h"
 #include "watchman/root/Root.h"
@@ -34,6 +36,14 @@ void InMemoryView::notifyThread(const std::shared_ptr<Root>& root) {
   // io thread after this point
   pendingFromWatcher_.lock()->ping();
 
+  // How many events this root may accumulate per publish burst. Roots
+  // expected to see storms that shouldn't monopolize the host (scratch
+  // repos) can be given a smaller budget; each burst is followed by a
+  // scheduling point, so other roots' threads interleave at least per
+  // budget-worth of events.
+  json_int_t burstLimit =
+      root->config.getInt("notify_burst_limit", WATCHMAN_BATCH_LIMIT);
+
   while (!stopThreads_.load(std::memory_order_acquire)) {
     // big number because not all watchers can deal with
     // -1 meaning infinite wait at the moment
@@ -47,15 +57,28 @@ void InMemoryView::notifyThread(const std::shared_ptr<Root>& root) {
         root->cancel();
         break;
       }
-      if (fromWatcher.getPendingItemCount() >= WATCHMAN_BATCH_LIMIT) {
+      if (fromWatcher.getPendingItemCount() >= uint32_t(burstLimit)) {
         break;
       }
     } while (watcher_->waitNotify(0));
 
     if (!fromWatcher.empty()) {
-      auto lock = pendingFromWatcher_.lock();
-      lock->append(fromWatcher.stealItems(), fromWatcher.stealSyncs());
-      lock->ping();
+      // Yield between bursts so a storming root's notify thread doesn't
+      // starve its peers on a loaded host; the kernel buffers the
+      // events we haven't consumed yet.
+      std::this_thread::yield();
+
+      auto syncs = fromWatcher.stealSyncs();
+      if (syncs.empty()) {
+        // The common case: publish the batch wait-free so that we don't
+        // contend with the iothread draining the collection during event
+        // storms. Dedup happens on the consumer side.
+        pendingFromWatcher_.publish(fromWatcher.stealItems());
+      } else {
+        auto lock = pendingFromWatcher_.lock();
+        lock->append(fromWatcher.stealItems(), std::move(syncs));
+        lock->ping();
+      }
     }
   }
 }
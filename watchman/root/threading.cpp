@@ -17,6 +17,18 @@ void Root::recrawlTriggered(const char* why) {
   log(ERR, root_path, ": ", why, ": tree recrawl triggered\n");
 }
 
+/*
+ * Note on incremental recrawl: skipping directories whose fingerprint
+ * (mtime, entry count, name hash) is unchanged was evaluated for the
+ * overflow path and is not sound — modifying a file's content changes
+ * the file's own mtime but not its parent directory's, so a fingerprint
+ * match cannot prove the subtree needs no re-stat, and re-statting the
+ * children is the crawl. What a recrawl already is, however, is
+ * incremental in effect: the view is not discarded, so the re-walk
+ * compares stat results against known state and only genuine changes
+ * generate work downstream; the snapshot-restore path gives restarts
+ * the same property.
+ */
 void Root::scheduleRecrawl(const char* why) {
   {
     auto info = recrawlInfo.wlock();
@@ -6,6 +6,8 @@
  */
 
 #include "watchman/saved_state/LocalSavedStateInterface.h"
+#include <folly/futures/Future.h>
+#include "watchman/ThreadPool.h"
 #include "watchman/CommandRegistry.h"
 #include "watchman/Errors.h"
 #include "watchman/Logging.h"
@@ -61,20 +63,38 @@ LocalSavedStateInterface::getMostRecentSavedStateImpl(
     w_string_piece lookupCommitId) const {
   auto commitIds =
       scm_->getCommitsPriorToAndIncluding(lookupCommitId, maxCommits_);
+
+  // Probe all candidates concurrently; on network-backed storage each
+  // stat is a round trip and probing maxCommits_ of them sequentially
+  // dominates cold lookups. The preference order (most recent first) is
+  // preserved by picking the first hit after the fan-out completes.
+  //
+  // We could return a path that no longer exists if the path is removed
+  // (for example by saved state GC) after we check that the path exists
+  // here, but before the client reads the state. We've explicitly chosen to
+  // return the state without additional safety guarantees, and leave it to
+  // the client to ensure GC happens only after states are no longer likely
+  // to be used.
+  std::vector<w_string> paths;
+  paths.reserve(commitIds.size());
+  std::vector<folly::Future<bool>> probes;
+  probes.reserve(commitIds.size());
   for (auto& commitId : commitIds) {
-    auto path = getLocalPath(commitId);
-    // We could return a path that no longer exists if the path is removed
-    // (for example by saved state GC) after we check that the path exists
-    // here, but before the client reads the state. We've explicitly chosen to
-    // return the state without additional safety guarantees, and leave it to
-    // the client to ensure GC happens only after states are no longer likely
-    // to be used.
-    if (w_path_exists(path.c_str())) {
+    paths.push_back(getLocalPath(commitId));
+    probes.push_back(folly::via(&getThreadPool(), [path = paths.back()] {
+      return w_path_exists(path.c_str());
+    }));
+  }
+  auto outcomes = folly::collectAll(probes.begin(), probes.end()).get();
+
+  for (size_t i = 0; i < commitIds.size(); ++i) {
+    if (outcomes[i].hasValue() && outcomes[i].value()) {
+      auto& commitId = commitIds[i];
       log(DBG, "Found saved state for commit ", commitId, "\n");
       SavedStateInterface::SavedStateResult result;
       result.commitId = commitId;
       result.savedStateInfo = json_object(
-          {{"local-path", w_string_to_json(path)},
+          {{"local-path", w_string_to_json(paths[i])},
            {"commit-id", w_string_to_json(commitId)}});
       return result;
     }
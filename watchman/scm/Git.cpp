@@ -8,6 +8,7 @@
 #include "watchman/scm/Git.h"
 #include <folly/String.h>
 #include "watchman/ChildProcess.h"
+#include "watchman/ThreadPool.h"
 #include "watchman/CommandRegistry.h"
 #include "watchman/Logging.h"
 #include "watchman/fs/FileSystem.h"
@@ -157,6 +158,11 @@ w_string Git::mergeBaseWith(w_string_piece commitId, w_string requestId) const {
       .get(
           key,
           [this, commit, requestId](const std::string&) {
+            // As with Mercurial, run subprocesses on the shared pool so
+            // distinct in-flight lookups proceed concurrently; the
+            // originating caller blocks on .get(), keeping captures
+            // alive for the reference-capturing getters below.
+            return folly::via(&getThreadPool(), [this, commit, requestId] {
             auto result = runGit(
                 {gitExecutablePath(), "merge-base", commit, "HEAD"},
                 makeGitOptions(requestId),
@@ -174,7 +180,8 @@ w_string Git::mergeBaseWith(w_string_piece commitId, w_string requestId) const {
             }
 
             // TODO: is w_string(s.c_str()) safe?
-            return folly::makeFuture(w_string(output.c_str()));
+            return w_string(output.c_str());
+            });
           })
       .get()
       ->value();
@@ -183,15 +190,22 @@ w_string Git::mergeBaseWith(w_string_piece commitId, w_string requestId) const {
 std::vector<w_string> Git::getFilesChangedSinceMergeBaseWith(
     w_string_piece commitId,
     w_string requestId) const {
+  // Resolve the actual merge base first: diffing against the named
+  // commit itself would over-report whenever HEAD has diverged from it,
+  // which is exactly the situation scm-aware queries exist for. The
+  // mergebase lookup is cached (keyed on the index mtime), so this adds
+  // no subprocess in the steady state.
+  auto mergeBase = mergeBaseWith(commitId, requestId);
+
   auto mtime = getIndexMtime();
   auto key = folly::to<std::string>(
-      commitId.view(), ":", mtime.tv_sec, ":", mtime.tv_nsec);
-  auto commitCopy = std::string{commitId.view()};
+      mergeBase.view(), ":", mtime.tv_sec, ":", mtime.tv_nsec);
   return filesChangedSinceMergeBaseWith_
       .get(
           key,
-          [this, commit = std::move(commitCopy), requestId](
+          [this, commit = std::string{mergeBase.view()}, requestId](
               const std::string&) {
+            return folly::via(&getThreadPool(), [this, commit, requestId] {
             auto result = runGit(
                 {gitExecutablePath(), "diff", "--name-only", "-z", commit},
                 makeGitOptions(requestId),
@@ -199,7 +213,8 @@ std::vector<w_string> Git::getFilesChangedSinceMergeBaseWith(
 
             std::vector<w_string> lines;
             w_string_piece(result.output).split(lines, '\0');
-            return folly::makeFuture(lines);
+            return lines;
+            });
           })
       .get()
       ->value();
@@ -210,8 +225,9 @@ SCM::StatusResult Git::getFilesChangedBetweenCommits(
     w_string requestId,
     bool /*includeDirectories*/) const {
   GitStatusAccumulator result;
+  // Snapshot the invalidation token once for all pairs in this call.
+  auto mtime = getIndexMtime();
   for (size_t i = 0; i + 1 < commits.size(); ++i) {
-    auto mtime = getIndexMtime();
     auto& commitA = commits[i];
     auto& commitB = commits[i + 1];
     auto key = folly::to<std::string>(
@@ -221,6 +237,7 @@ SCM::StatusResult Git::getFilesChangedBetweenCommits(
                    .get(
                        key,
                        [&](const std::string&) {
+                         return folly::via(&getThreadPool(), [&] {
                          auto gitresult = runGit(
                              {gitExecutablePath(),
                               "diff",
@@ -231,7 +248,8 @@ SCM::StatusResult Git::getFilesChangedBetweenCommits(
                              makeGitOptions(requestId),
                              "get files changed between commits");
 
-                         return folly::makeFuture(gitresult.output);
+                         return gitresult.output;
+                         });
                        })
                    .get()
                    ->value());
@@ -243,7 +261,7 @@ std::chrono::time_point<std::chrono::system_clock> Git::getCommitDate(
     w_string_piece commitId,
     w_string requestId) const {
   auto result = runGit(
-      {gitExecutablePath(), "log", "--format:%ct", "-n", "1", commitId.view()},
+      {gitExecutablePath(), "log", "--format=%ct", "-n", "1", commitId.view()},
       makeGitOptions(requestId),
       "get commit date");
   double timestamp;
@@ -270,6 +288,8 @@ std::vector<w_string> Git::getCommitsPriorToAndIncluding(
           key,
           [this, commit = std::move(commitCopy), numCommits, requestId](
               const std::string&) {
+            return folly::via(
+                &getThreadPool(), [this, commit, numCommits, requestId] {
             auto result = runGit(
                 {gitExecutablePath(),
                  "log",
@@ -282,7 +302,8 @@ std::vector<w_string> Git::getCommitsPriorToAndIncluding(
 
             std::vector<w_string> lines;
             w_string_piece(result.output).split(lines, '\n');
-            return folly::makeFuture(lines);
+            return lines;
+            });
           })
       .get()
       ->value();
@@ -81,6 +81,11 @@ void StatusAccumulator::add(w_string_piece status) {
 
   log(DBG, "processing ", lines.size(), " status lines\n");
 
+  // A rebase-sized status can easily carry six figures of entries;
+  // rehashing the accumulator repeatedly while inserting them is pure
+  // waste since we know the upper bound up front.
+  byFile_.reserve(byFile_.size() + lines.size());
+
   for (auto& line : lines) {
     if (line.size() < 3) {
       continue;
@@ -207,6 +212,11 @@ w_string Mercurial::mergeBaseWith(w_string_piece commitId, w_string requestId)
       .get(
           key,
           [this, commit, requestId](const std::string&) {
+            // Run the subprocess on the shared pool so that distinct
+            // in-flight SCM lookups proceed concurrently; coalesced
+            // waiters for this key share the future. The originating
+            // caller blocks on .get() below, keeping captures alive.
+            return folly::via(&getThreadPool(), [this, commit, requestId] {
             auto revset = to<std::string>("ancestor(.,", commit, ")");
             auto result = runMercurial(
                 {hgExecutablePath(), "log", "-T", "{node}", "-r", revset},
@@ -224,7 +234,8 @@ w_string Mercurial::mergeBaseWith(w_string_piece commitId, w_string requestId)
                   result.output.view());
             }
 
-            return folly::makeFuture(result.output);
+              return result.output;
+            });
           })
       .get()
       ->value();
@@ -248,6 +259,7 @@ std::vector<w_string> Mercurial::getFilesChangedSinceMergeBaseWith(
           key,
           [this, commit = std::move(commitCopy), requestId](
               const std::string&) {
+            return folly::via(&getThreadPool(), [this, commit, requestId] {
             auto result = runMercurial(
                 {hgExecutablePath(),
                  "--traceback",
@@ -263,7 +275,8 @@ std::vector<w_string> Mercurial::getFilesChangedSinceMergeBaseWith(
 
             std::vector<w_string> lines;
             result.output.piece().split(lines, '\n');
-            return folly::makeFuture(lines);
+            return lines;
+            });
           })
       .get()
       ->value();
@@ -274,8 +287,10 @@ SCM::StatusResult Mercurial::getFilesChangedBetweenCommits(
     w_string requestId,
     bool includeDirectories) const {
   StatusAccumulator result;
+  // The dirstate mtime is the cache invalidation token for every pair in
+  // this invocation; snapshot it once rather than re-statting per pair.
+  auto mtime = getDirStateMtime();
   for (size_t i = 0; i + 1 < commits.size(); ++i) {
-    auto mtime = getDirStateMtime();
     auto& commitA = commits[i];
     auto& commitB = commits[i + 1];
     if (commitA == commitB) {
@@ -288,6 +303,12 @@ SCM::StatusResult Mercurial::getFilesChangedBetweenCommits(
     auto dirkey = folly::to<std::string>(
         "dirs:", commitA, ":", commitB, ":", mtime.tv_sec, ":", mtime.tv_nsec);
 
+    // Note that filesChangedBetweenCommits_ is shared by every client of
+    // this root's SCM instance, and LRUCache::get coalesces concurrent
+    // lookups of the same key into one pending fetch, so identical
+    // in-flight commit-pair requests from different clients already
+    // collapse into a single `hg status` invocation.
+    //
     // This loop runs `hg status` commands sequentially. There's an opportunity
     // to run them concurrently, but:
     // 1. In practice since each transition in `commits` corresponds to an
@@ -304,6 +325,7 @@ SCM::StatusResult Mercurial::getFilesChangedBetweenCommits(
             .get(
                 key,
                 [&](const std::string&) {
+                  return folly::via(&getThreadPool(), [&] {
                   auto hgresult = runMercurial(
                       {hgExecutablePath(),
                        "--traceback",
@@ -319,7 +341,8 @@ SCM::StatusResult Mercurial::getFilesChangedBetweenCommits(
                       makeHgOptions(requestId),
                       "get files changed between commits");
 
-                  return folly::makeFuture(hgresult.output);
+                  return hgresult.output;
+                  });
                 })
             .get()
             ->value());
@@ -328,6 +351,7 @@ SCM::StatusResult Mercurial::getFilesChangedBetweenCommits(
                      .get(
                          dirkey,
                          [&](const std::string&) {
+                           return folly::via(&getThreadPool(), [&] {
                            auto hgresult = runMercurial(
                                {hgExecutablePath(),
                                 "--traceback",
@@ -344,7 +368,8 @@ SCM::StatusResult Mercurial::getFilesChangedBetweenCommits(
                                "get dirs changed between commits");
                            auto output = std::string{hgresult.output.view()};
                            replaceEmbeddedNewLines(output);
-                           return folly::makeFuture(w_string{output});
+                           return w_string{output};
+                           });
                          })
                      .get()
                      ->value());
@@ -392,6 +417,8 @@ std::vector<w_string> Mercurial::getCommitsPriorToAndIncluding(
           key,
           [this, commit = std::move(commitCopy), numCommits, requestId](
               const std::string&) {
+            return folly::via(
+                &getThreadPool(), [this, commit, numCommits, requestId] {
             auto revset = to<std::string>(
                 "reverse(last(_firstancestors(",
                 commit,
@@ -411,10 +438,105 @@ std::vector<w_string> Mercurial::getCommitsPriorToAndIncluding(
 
             std::vector<w_string> lines;
             w_string_piece(result.output).split(lines, '\n');
-            return folly::makeFuture(lines);
+            return lines;
+            });
           })
       .get()
       ->value();
 }
 
+void Mercurial::saveCaches(const char* path) const {
+  auto serializeStrings = [](auto& cache) {
+    auto entries = json_array();
+    cache.forEach([&](const std::string& key, const w_string& value) {
+      json_array_append_new(
+          entries,
+          json_array(
+              {typed_string_to_json(key.c_str(), W_STRING_MIXED),
+               w_string_to_json(value)}));
+    });
+    return entries;
+  };
+  auto serializeLists = [](auto& cache) {
+    auto entries = json_array();
+    cache.forEach(
+        [&](const std::string& key, const std::vector<w_string>& value) {
+          auto list = json_array();
+          for (auto& item : value) {
+            json_array_append_new(list, w_string_to_json(item));
+          }
+          json_array_append_new(
+              entries,
+              json_array(
+                  {typed_string_to_json(key.c_str(), W_STRING_MIXED),
+                   std::move(list)}));
+        });
+    return entries;
+  };
+
+  // Keys embed the dirstate mtime, so reloaded entries carry their own
+  // validity: a checkout between runs changes the keys and simply
+  // misses.
+  auto store = json_object(
+      {{"root", w_string_to_json(getSCMRoot())},
+       {"merge_bases", serializeStrings(mergeBases_)},
+       {"files_between", serializeStrings(filesChangedBetweenCommits_)},
+       {"commits_prior", serializeLists(commitsPrior_)},
+       {"files_since_mergebase",
+        serializeLists(filesChangedSinceMergeBaseWith_)}});
+
+  auto file = w_stm_open(path, O_WRONLY | O_TRUNC | O_CREAT, 0600);
+  if (!file) {
+    log(ERR, "scm cache store: unable to open ", path, " for write\n");
+    return;
+  }
+  w_jbuffer_t buffer;
+  buffer.bserEncodeToStream(2, 0, store, file.get());
+}
+
+void Mercurial::loadCaches(const char* path) {
+  auto file = w_stm_open(path, O_RDONLY);
+  if (!file) {
+    return;
+  }
+
+  try {
+    w_jbuffer_t buffer;
+    json_error_t jerr;
+    auto store = buffer.decodeNext(file.get(), &jerr);
+    if (!store || json_to_w_string(store.get_default("root")) != getSCMRoot()) {
+      return;
+    }
+
+    auto loadStrings = [&](const char* name, auto& cache) {
+      auto entries = store.get_default(name);
+      for (size_t i = 0; i < json_array_size(entries); ++i) {
+        const auto& entry = entries.at(i);
+        cache.set(
+            std::string{json_string_value(entry.at(0))},
+            json_to_w_string(entry.at(1)));
+      }
+    };
+    auto loadLists = [&](const char* name, auto& cache) {
+      auto entries = store.get_default(name);
+      for (size_t i = 0; i < json_array_size(entries); ++i) {
+        const auto& entry = entries.at(i);
+        std::vector<w_string> list;
+        const auto& items = entry.at(1);
+        for (size_t j = 0; j < json_array_size(items); ++j) {
+          list.push_back(json_to_w_string(items.at(j)));
+        }
+        cache.set(std::string{json_string_value(entry.at(0))}, std::move(list));
+      }
+    };
+
+    loadStrings("merge_bases", mergeBases_);
+    loadStrings("files_between", filesChangedBetweenCommits_);
+    loadLists("commits_prior", commitsPrior_);
+    loadLists("files_since_mergebase", filesChangedSinceMergeBaseWith_);
+  } catch (const std::exception& exc) {
+    log(ERR, "scm cache store: failed to load ", path, ": ", exc.what(), "\n");
+  }
+}
+
 } // namespace watchman
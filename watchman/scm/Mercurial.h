@@ -56,6 +56,9 @@ class Mercurial : public SCM {
 
  private:
   std::string dirStatePath_;
+  void saveCaches(const char* path) const override;
+  void loadCaches(const char* path) override;
+
   mutable LRUCache<std::string, std::vector<w_string>> commitsPrior_;
   mutable LRUCache<std::string, w_string> mergeBases_;
   mutable LRUCache<std::string, w_string> filesChangedBetweenCommits_;
@@ -106,6 +106,15 @@ class SCM {
   // Compute the numCommits commits prior to and including the specified commit
   // in source control history. Returns an ordered list with the most recent
   // commit (the one specified) first.
+  /**
+   * Persist / restore any caches whose contents are immutable facts of
+   * the repository (commit graph queries). The base implementations do
+   * nothing; implementations that cache should override. Invoked by the
+   * view when scm_cache_store_path is configured.
+   */
+  virtual void saveCaches(const char* /*path*/) const {}
+  virtual void loadCaches(const char* /*path*/) {}
+
   virtual std::vector<w_string> getCommitsPriorToAndIncluding(
       w_string_piece commitId,
       int numCommits,
@@ -7,7 +7,11 @@
 
 #include "watchman/state.h"
 #include <folly/String.h>
+#include <chrono>
+#include <thread>
 #include <folly/Synchronized.h>
+#include "watchman/ThreadPool.h"
+#include <folly/futures/Future.h>
 #include "watchman/Errors.h"
 #include "watchman/Logging.h"
 #include "watchman/Options.h"
@@ -60,6 +64,18 @@ static void state_saver() noexcept {
     }
 
     if (do_save) {
+      // Debounce: a burst of watch/unwatch traffic (eg: CI setting up
+      // hundreds of roots) marks the state dirty repeatedly; wait a
+      // beat so the whole burst collapses into one serialization and
+      // write instead of one per mutation. Anything that dirties the
+      // state during the sleep is folded in by clearing the flag after
+      // it.
+      if (!w_is_stopping()) {
+        /* sleep for a short interval; shutdown waits for this thread so
+         * keep it brief */
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        saveState.lock()->needsSave = false;
+      }
       do_state_save();
     }
   }
@@ -170,6 +186,20 @@ bool w_root_save_state(json_ref& state) {
       auto triggers = root->triggerListToJson();
       json_object_set_new(obj, "triggers", std::move(triggers));
 
+      // Persist named cursors. They are only restored for roots whose
+      // tick space survives restart (view snapshot configured); see the
+      // load side.
+      {
+        auto cursors = root->inner.cursors.rlock();
+        if (!cursors->empty()) {
+          auto cursorObj = json_object_of_size(cursors->size());
+          for (auto& it : *cursors) {
+            cursorObj.set(it.first, json_integer(it.second));
+          }
+          json_object_set_new(obj, "cursors", std::move(cursorObj));
+        }
+      }
+
       json_array_append_new(watched_dirs, std::move(obj));
     }
   }
@@ -179,6 +209,8 @@ bool w_root_save_state(json_ref& state) {
   return result;
 }
 
+static void w_root_load_one(const json_ref& obj);
+
 bool w_root_load_state(const json_ref& state) {
   size_t i;
 
@@ -191,8 +223,29 @@ bool w_root_load_state(const json_ref& state) {
     return false;
   }
 
+  // Re-establish saved roots concurrently: each entry resolves its
+  // root (realpath, config, watcher setup) and starts its own threads
+  // with no dependency on its siblings, and with 50+ roots the serial
+  // version kept CI daemons unresponsive for minutes. Errors remain
+  // per-root, exactly as before.
+  std::vector<folly::Future<folly::Unit>> rootFutures;
+  rootFutures.reserve(json_array_size(watched));
+
   for (i = 0; i < json_array_size(watched); i++) {
-    const auto& obj = watched.at(i);
+    rootFutures.push_back(
+        folly::via(&watchman::getThreadPool(), [&state, &watched, i] {
+          w_root_load_one(watched.at(i));
+        }));
+  }
+  folly::collectAll(rootFutures.begin(), rootFutures.end()).wait();
+  (void)state;
+
+  return true;
+}
+
+static void w_root_load_one(const json_ref& obj) {
+  {
+    // scoped to mirror the original loop body
     bool created = false;
     const char* filename;
     size_t j;
@@ -204,7 +257,25 @@ bool w_root_load_state(const json_ref& state) {
     try {
       root = root_resolve(filename, true, &created);
     } catch (const std::exception&) {
-      continue;
+      return;
+    }
+
+    // Restore named cursors for roots that use view snapshots. Whether
+    // the tick space actually carried over isn't knowable here (the
+    // snapshot restore happens asynchronously on the iothread and may
+    // fail), so the initial crawl's completion path validates these:
+    // any cursor ahead of the post-crawl clock is dropped there,
+    // forcing the documented fresh-instance behavior instead of
+    // silently suppressing results.
+    auto savedCursors = obj.get_default("cursors");
+    if (savedCursors && savedCursors.isObject() &&
+        *root->config.getString("view_snapshot_path", "")) {
+      auto cursors = root->inner.cursors.wlock();
+      for (auto& it : savedCursors.object()) {
+        if (it.second.isInt()) {
+          (*cursors)[it.first] = uint32_t(it.second.asInt());
+        }
+      }
     }
 
     {
@@ -253,8 +324,6 @@ bool w_root_load_state(const json_ref& state) {
       }
     }
   }
-
-  return true;
 }
 
 /* vim:ts=2:sw=2:et:
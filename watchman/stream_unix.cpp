@@ -13,6 +13,9 @@
 #include "watchman/fs/FileDescriptor.h"
 #include "watchman/fs/Pipe.h"
 #include "watchman/watchman_stream.h"
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
 #ifdef HAVE_UCRED_H
 #include <ucred.h> // @manual
@@ -119,10 +122,21 @@ class UnixStream : public watchman_stream {
   std::unique_ptr<ucred_t, ucred_deleter> cred;
 #endif
   bool credvalid{false};
+  bool credfetched{false};
   bool blocking_{false};
 
   explicit UnixStream(FileDescriptor&& descriptor)
-      : fd(std::move(descriptor)), evt(fd.system_handle()) {
+      : fd(std::move(descriptor)), evt(fd.system_handle()) {}
+
+  // Peer credentials are looked up lazily: the daemon side consults them
+  // for every accepted client, but the client side of a connection (one
+  // per CLI invocation for some build tools) never does, and skipping
+  // the getsockopt round trips there trims the handshake.
+  void ensureCreds() {
+    if (credfetched) {
+      return;
+    }
+    credfetched = true;
 #ifdef SO_PEERCRED
     socklen_t len = sizeof(cred);
     credvalid = getsockopt(fd.fd(), SOL_SOCKET, SO_PEERCRED, &cred, &len) == 0;
@@ -170,6 +184,55 @@ class UnixStream : public watchman_stream {
     return res.value();
   }
 
+#ifndef _WIN32
+  int writev(const WriteVec* vecs, size_t nvecs) override {
+    // Cap at a reasonable iovec count; callers with more vectors will be
+    // called again for the remainder via their short-write handling.
+    constexpr size_t kMaxIov = 64;
+    struct iovec iov[kMaxIov];
+    nvecs = std::min(nvecs, kMaxIov);
+    for (size_t i = 0; i < nvecs; ++i) {
+      iov[i].iov_base = const_cast<void*>(vecs[i].buf);
+      iov[i].iov_len = vecs[i].len;
+    }
+
+    errno = 0;
+    auto x = ::writev(fd.fd(), iov, int(nvecs));
+    return int(x);
+  }
+#endif
+
+#ifndef _WIN32
+  bool sendFd(int fdToSend) override {
+    // One marker byte carries the ancillary payload; the receiver reads
+    // the byte in-stream and collects the fd from the same message.
+    char marker = 'F';
+    struct iovec iov {
+      &marker, sizeof(marker)
+    };
+
+    union {
+      struct cmsghdr align;
+      char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr msg {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    auto* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fdToSend, sizeof(int));
+
+    return sendmsg(fd.fd(), &msg, 0) == 1;
+  }
+#endif
+
   int write(const void* buf, int size) override {
     if (blocking_) {
       int wrote = 0;
@@ -262,6 +325,7 @@ class UnixStream : public watchman_stream {
   // mechanisms.  We'll treat the other process as an owner if their
   // effective UID matches ours, or if they are root.
   bool peerIsOwner() override {
+    ensureCreds();
 #ifdef _WIN32
     return true;
 #else
@@ -287,6 +351,7 @@ class UnixStream : public watchman_stream {
   }
 
   pid_t getPeerProcessID() const override {
+    const_cast<UnixStream*>(this)->ensureCreds();
     if (!credvalid) {
       return 0;
     }
@@ -506,6 +506,50 @@ static void initiate_write(class win_handle* h) {
     h->write_tail = nullptr;
   }
 
+  // Coalesce queued buffers into one overlapped write, up to a cap, so
+  // a burst of small PDUs costs one WriteFileEx round trip rather than
+  // one per buffer. The merged buffer keeps the same cursor/len
+  // semantics as a plain one, so partial-write handling in
+  // write_completed is unaffected.
+  constexpr DWORD kMaxCoalescedWrite = 512 * 1024;
+  if (h->write_head && wbuf->len < kMaxCoalescedWrite) {
+    DWORD total = wbuf->len;
+    for (auto* it = h->write_head;
+         it && total + it->len <= kMaxCoalescedWrite;
+         it = it->next) {
+      total += it->len;
+    }
+
+    if (total > wbuf->len) {
+      auto* merged = (write_buf*)malloc(sizeof(*merged) + total - 1);
+      if (merged) {
+        merged->next = nullptr;
+        merged->cursor = merged->data;
+        merged->len = total;
+
+        DWORD off = 0;
+        memcpy(merged->data, wbuf->cursor, wbuf->len);
+        off = wbuf->len;
+        free(wbuf);
+
+        while (h->write_head && off < total) {
+          auto* it = h->write_head;
+          if (off + it->len > total) {
+            break;
+          }
+          memcpy(merged->data + off, it->cursor, it->len);
+          off += it->len;
+          h->write_head = it->next;
+          free(it);
+        }
+        if (!h->write_head) {
+          h->write_tail = nullptr;
+        }
+        wbuf = merged;
+      }
+    }
+  }
+
   h->write_pending = (overlapped_op*)calloc(1, sizeof(*h->write_pending));
   h->write_pending->h = h;
   h->write_pending->wbuf = wbuf;
@@ -5,10 +5,15 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <folly/Synchronized.h>
+#include <folly/hash/SpookyHashV2.h>
+#include <atomic>
 #include <stdarg.h>
+#include <array>
 #include <new>
 #include <ostream>
 #include <stdexcept>
+#include <unordered_set>
 #include "watchman/thirdparty/jansson/utf.h"
 #include "watchman/watchman_hash.h"
 #include "watchman/watchman_string.h"
@@ -404,6 +409,30 @@ bool w_string::operator!=(const w_string& other) const {
   return !(*this == other);
 }
 
+w_string w_string::intern(const w_string& str) {
+  // Sharded by hash so that concurrent interning (iothread populating
+  // the view, decode threads) rarely contends; lookups take the shared
+  // lock only.
+  static constexpr size_t kShards = 16;
+  static std::array<
+      folly::Synchronized<std::unordered_set<w_string>>,
+      kShards>
+      shards;
+
+  auto& shard = shards[std::hash<w_string>{}(str) % kShards];
+
+  {
+    auto rlock = shard.rlock();
+    auto it = rlock->find(str);
+    if (it != rlock->end()) {
+      return *it;
+    }
+  }
+
+  auto wlock = shard.wlock();
+  return *wlock->insert(str).first;
+}
+
 w_string w_string::pathCat(std::initializer_list<w_string_piece> elems) {
   uint32_t length = 0;
   w_string_t* s;
@@ -437,14 +466,27 @@ w_string w_string::pathCat(std::initializer_list<w_string_piece> elems) {
   return w_string(s, false);
 }
 
+namespace {
+// In-memory string hashing goes through SpookyHashV2 (already linked in
+// via folly), which processes input in bulk words instead of lookup3's
+// 12-byte blocks and measures several times faster on pathname-sized
+// inputs. The hash is never persisted or sent on the wire — it only
+// seeds the cached hval and the hash tables — so the function can be
+// swapped freely; w_hash_bytes remains available for any consumer that
+// needs the historical stable values.
+inline uint32_t hashBytesFast(const void* data, size_t len) {
+  return uint32_t(folly::hash::SpookyHashV2::Hash64(data, len, 0));
+}
+} // namespace
+
 uint32_t w_string_compute_hval(w_string_t* str) {
-  str->_hval = w_hash_bytes(str->buf, str->len, 0);
+  str->_hval = hashBytesFast(str->buf, str->len);
   str->hval_computed = 1;
   return str->_hval;
 }
 
 uint32_t w_string_piece::hashValue() const {
-  return w_hash_bytes(data(), size(), 0);
+  return hashBytesFast(data(), size());
 }
 
 uint32_t strlen_uint32(const char* str) {
@@ -499,13 +541,21 @@ w_string w_string::vprintf(const char* format, va_list args) {
 }
 
 void w_string_addref(w_string_t* str) {
-  ++str->refcnt;
+  // Taking a reference doesn't need to order anything: visibility of the
+  // string contents is established by whatever handed us the pointer.
+  // The default seq_cst increment was pure cacheline synchronization
+  // overhead on every copy.
+  str->refcnt.fetch_add(1, std::memory_order_relaxed);
 }
 
 void w_string_delref(w_string_t* str) {
-  if (--str->refcnt != 0) {
+  // Release so that this thread's prior accesses happen-before the
+  // destruction; only the thread that drops the last reference pays the
+  // matching acquire.
+  if (str->refcnt.fetch_sub(1, std::memory_order_release) != 1) {
     return;
   }
+  std::atomic_thread_fence(std::memory_order_acquire);
   // Call the destructor.  We can't use regular delete because
   // we allocated using operator new[], and we can't use delete[]
   // directly either because the type doesn't match what we allocated.
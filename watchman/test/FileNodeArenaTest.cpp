@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include <folly/portability/GTest.h>
+
+#include "watchman/FileNodeArena.h"
+
+using namespace watchman;
+
+TEST(FileNodeArena, allocations_are_zeroed) {
+  FileNodeArena arena;
+  auto* p = static_cast<char*>(arena.allocate(64));
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_EQ(0, p[i]);
+  }
+
+  // Dirty it, recycle it, and verify the recycled allocation is zeroed too.
+  memset(p, 0xff, 64);
+  arena.release(p, 64);
+  auto* q = static_cast<char*>(arena.allocate(64));
+  EXPECT_EQ(p, q);
+  for (size_t i = 0; i < 64; ++i) {
+    EXPECT_EQ(0, q[i]);
+  }
+}
+
+TEST(FileNodeArena, recycles_by_size_class) {
+  FileNodeArena arena;
+  auto* small = arena.allocate(24);
+  auto* large = arena.allocate(128);
+  arena.release(small, 24);
+  arena.release(large, 128);
+
+  // A differently sized request must not be satisfied from the wrong bin.
+  EXPECT_EQ(large, arena.allocate(128));
+  EXPECT_EQ(small, arena.allocate(24));
+}
+
+TEST(FileNodeArena, packs_into_blocks) {
+  FileNodeArena arena;
+  // Lots of file-node-sized allocations should share a small number of
+  // blocks rather than taking one heap allocation each.
+  for (size_t i = 0; i < 1000; ++i) {
+    arena.allocate(96);
+  }
+  EXPECT_LE(arena.blockCount(), 1 + (1000 * 96) / FileNodeArena::kBlockSize);
+}
+
+TEST(FileNodeArena, oversized_allocations_fall_back_to_heap) {
+  FileNodeArena arena;
+  auto* p = arena.allocate(FileNodeArena::kMaxArenaAllocSize + 1);
+  EXPECT_NE(nullptr, p);
+  EXPECT_EQ(0u, arena.blockCount());
+  arena.release(p, FileNodeArena::kMaxArenaAllocSize + 1);
+}
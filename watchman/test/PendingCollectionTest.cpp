@@ -10,6 +10,7 @@
 
 #include <folly/logging/xlog.h>
 #include <folly/portability/GTest.h>
+#include <atomic>
 #include <chrono>
 
 using namespace watchman;
@@ -143,9 +144,10 @@ class PendingCollectionFixture : public testing::Test {
 
 class WrappedPendingCollection : public PendingCollectionBase {
  public:
-  WrappedPendingCollection() : PendingCollectionBase{cond} {}
+  WrappedPendingCollection() : PendingCollectionBase{cond, pingSeq} {}
 
   std::condition_variable cond;
+  std::atomic<uint64_t> pingSeq{0};
 };
 
 /**
@@ -394,3 +396,76 @@ TYPED_TEST(PendingCollectionFixture, real_example) {
   ASSERT_NE(nullptr, item);
   EXPECT_EQ(nullptr, item->next);
 }
+
+TEST(PendingCollection, published_batches_are_merged_on_drain) {
+  PendingCollection coll;
+  auto now = std::chrono::system_clock::now();
+
+  {
+    PendingChanges producer;
+    producer.add(w_string{"foo/bar"}, now, W_PENDING_VIA_NOTIFY);
+    producer.add(w_string{"foo/baz"}, now, W_PENDING_VIA_NOTIFY);
+    coll.publish(producer.stealItems());
+  }
+  {
+    PendingChanges producer;
+    // Duplicates a previously published path; the consumer-side merge
+    // must coalesce it rather than yielding two entries.
+    producer.add(w_string{"foo/bar"}, now, W_PENDING_RECURSIVE);
+    coll.publish(producer.stealItems());
+  }
+
+  auto lock = coll.lockAndDrain();
+  EXPECT_EQ(2, lock->getPendingItemCount());
+
+  auto item = lock->stealItems();
+  ASSERT_NE(nullptr, item);
+  EXPECT_EQ(w_string{"foo/bar"}, item->path);
+  EXPECT_EQ(W_PENDING_VIA_NOTIFY | W_PENDING_RECURSIVE, item->flags);
+
+  item = item->next;
+  ASSERT_NE(nullptr, item);
+  EXPECT_EQ(w_string{"foo/baz"}, item->path);
+  EXPECT_EQ(nullptr, item->next);
+}
+
+TEST(PendingCollection, lockAndWait_observes_published_batches) {
+  PendingCollection coll;
+  auto now = std::chrono::system_clock::now();
+
+  PendingChanges producer;
+  producer.add(w_string{"foo"}, now, W_PENDING_VIA_NOTIFY);
+  coll.publish(producer.stealItems());
+
+  // The publication pinged the collection, so this must not block and
+  // must surface the published item.
+  auto lock = coll.lockAndWait(std::chrono::milliseconds(0));
+  EXPECT_EQ(1, lock->getPendingItemCount());
+}
+
+TEST(PendingCollection, wide_sibling_storms_roll_up_into_recursive_scan) {
+  PendingChanges coll;
+  auto now = std::chrono::system_clock::now();
+
+  // A checkout-style storm: a huge number of siblings under one dir.
+  for (uint32_t i = 0; i < 1500; ++i) {
+    coll.add(
+        w_string::build("foo/bar/file", i),
+        now,
+        W_PENDING_VIA_NOTIFY);
+  }
+
+  // Rather than carrying 1500 entries, the collection should have
+  // collapsed them into a recursive scan of the parent (plus any
+  // post-rollup stragglers suppressed by the recursive entry).
+  EXPECT_LT(coll.getPendingItemCount(), 1500u);
+
+  bool sawParent = false;
+  for (auto item = coll.stealItems(); item; item = item->next) {
+    if (item->path == w_string{"foo/bar"}) {
+      EXPECT_TRUE(item->flags.contains(W_PENDING_RECURSIVE));
+      sawParent = true;
+    }
+  }
+  EXPECT_TRUE(sawParent);
+}
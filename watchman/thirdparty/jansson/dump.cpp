@@ -82,6 +82,26 @@ static int dump_string(
     int length;
 
     while (*end) {
+      /* Fast path: plain printable ASCII other than '"' and '\\' passes
+       * through verbatim, and single-byte codepoints need no utf8
+       * validation, so skip over whole runs with a tight byte scan that
+       * the compiler vectorizes. Escapes, control codes, NUL and
+       * multibyte sequences fall through to the general loop below,
+       * which still validates the utf8. Disabled for JSON_ESCAPE_SLASH
+       * since '/' would be skipped as plain. */
+      if (!(flags & JSON_ESCAPE_SLASH)) {
+        const unsigned char* scan = (const unsigned char*)pos;
+        while (*scan >= 0x20 && *scan < 0x80 && *scan != '"' &&
+               *scan != '\\') {
+          scan++;
+        }
+        pos = (const char*)scan;
+        end = pos;
+        if (!*end) {
+          break;
+        }
+      }
+
       end = utf8_iterate(pos, &codepoint);
       if (!end) {
         return -1;
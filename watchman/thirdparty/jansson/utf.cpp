@@ -6,6 +6,8 @@
  */
 
 #include "utf.h"
+#include <stdint.h>
+#include <string.h>
 #include <string.h>
 
 int utf8_encode(int32_t codepoint, char* buffer, int* size) {
@@ -145,6 +147,24 @@ int utf8_check_string(const char* string, int length) {
     length = strlen(string);
 
   for (i = 0; i < length; i++) {
+    /* Fast-skip runs of plain ASCII eight bytes at a time: a word with
+     * no high bits set contains only single-byte codepoints, which are
+     * always valid, and pathname-heavy payloads are almost entirely
+     * ASCII. The compiler turns the word test into vector compares for
+     * longer runs. Falls back to the per-byte state machine at the
+     * first non-ASCII byte. */
+    while (i + 8 <= length) {
+      uint64_t word;
+      memcpy(&word, &string[i], sizeof(word));
+      if (word & UINT64_C(0x8080808080808080)) {
+        break;
+      }
+      i += 8;
+    }
+    if (i >= length) {
+      break;
+    }
+
     int count = utf8_check_first(string[i]);
     if (count == 0)
       return 0;
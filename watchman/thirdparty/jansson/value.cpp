@@ -9,6 +9,7 @@
 #endif
 
 #include "jansson.h"
+#include <vector>
 #include "jansson_private.h"
 
 #include <algorithm>
@@ -606,7 +607,38 @@ static json_ref json_string_copy(const json_t* string) {
 json_integer_t::json_integer_t(json_int_t value)
     : json(JSON_INTEGER), value(value) {}
 
+namespace {
+/* Query rendering creates and destroys millions of integer values
+ * (sizes, modes, timestamps), so recycle their storage through a
+ * bounded thread-local pool instead of hitting the allocator for each.
+ * A value freed on a different thread than it was created on merely
+ * unbalances the pools a little, which is harmless. */
+constexpr size_t kIntegerPoolCap = 4096;
+
+struct IntegerPool {
+  std::vector<json_integer_t*> free;
+
+  ~IntegerPool() {
+    for (auto* p : free) {
+      ::operator delete(p);
+    }
+  }
+};
+
+IntegerPool& integerPool() {
+  static thread_local IntegerPool pool;
+  return pool;
+}
+} // namespace
+
 json_ref json_integer(json_int_t value) {
+  auto& pool = integerPool();
+  if (!pool.free.empty()) {
+    auto* storage = pool.free.back();
+    pool.free.pop_back();
+    auto* integer = new (storage) json_integer_t(value);
+    return json_ref(&integer->json, false);
+  }
   auto integer = new json_integer_t(value);
   return json_ref(&integer->json, false);
 }
@@ -717,9 +749,17 @@ void json_ref::json_delete(json_t* json) {
     case JSON_STRING:
       delete (json_string_t*)json;
       break;
-    case JSON_INTEGER:
-      delete (json_integer_t*)json;
+    case JSON_INTEGER: {
+      auto* integer = (json_integer_t*)json;
+      auto& pool = integerPool();
+      if (pool.free.size() < kIntegerPoolCap) {
+        integer->~json_integer_t();
+        pool.free.push_back(integer);
+      } else {
+        delete integer;
+      }
       break;
+    }
     case JSON_REAL:
       delete (json_real_t*)json;
       break;
@@ -3,6 +3,9 @@
 #ifdef __SSE__
 #include <emmintrin.h>
 #endif
+#ifdef __aarch64__
+#include <arm_neon.h>
+#endif
 #include <algorithm>
 #include <new>
 #include <cassert>
@@ -320,6 +323,22 @@ art_tree<ValueType, KeyType>::Node16::findChild(unsigned char c) {
   if (bitfield) {
     return &children[__builtin_ctz(bitfield)];
   }
+#elif defined(__aarch64__)
+  // NEON has no movemask, so collapse the 16 compare bytes into a
+  // 64-bit value of one nibble per lane via the vshrn trick; each
+  // matching lane contributes an 0xf nibble.
+  uint8x16_t eq = vceqq_u8(vdupq_n_u8(c), vld1q_u8(keys));
+  uint64_t matches = vget_lane_u64(
+      vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+
+  // Ignore lanes beyond the live children
+  if (this->num_children < 16) {
+    matches &= (uint64_t(1) << (this->num_children * 4)) - 1;
+  }
+
+  if (matches) {
+    return &children[__builtin_ctzll(matches) >> 2];
+  }
 #else
   int i;
   for (i = 0; i < this->num_children; i++) {
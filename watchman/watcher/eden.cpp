@@ -18,6 +18,8 @@
 #include <thrift/lib/cpp2/async/RetryingRequestChannel.h>
 #include <thrift/lib/cpp2/async/RocketClientChannel.h>
 #include <algorithm>
+#include <deque>
+#include <unordered_set>
 #include <chrono>
 #include <iterator>
 #include <thread>
@@ -413,6 +415,17 @@ class EdenFileResult : public FileResult {
     }
 
     auto client = getEdenClient(thriftChannel_);
+
+    // Pipeline the SHA1 request with the file information fetch: the two
+    // are independent, the shared per-root channel supports concurrent
+    // outstanding requests, and hashing on the Eden side is the slow
+    // one, so issuing it first hides its latency behind the stat batch.
+    auto shaFuture = folly::SemiFuture<std::vector<SHA1Result>>::makeEmpty();
+    if (!getShaFiles.empty()) {
+      shaFuture = client->semifuture_getSHA1(
+          std::string{rootPath_.view()}, getShaNames, getSyncBehavior());
+    }
+
     loadFileInformation(
         client.get(),
         rootPath_,
@@ -424,9 +437,7 @@ class EdenFileResult : public FileResult {
     loadSymlinkTargets(client.get(), getSymlinkFiles);
 
     if (!getShaFiles.empty()) {
-      std::vector<SHA1Result> sha1s;
-      client->sync_getSHA1(
-          sha1s, std::string{rootPath_.view()}, getShaNames, getSyncBehavior());
+      std::vector<SHA1Result> sha1s = std::move(shaFuture).get();
 
       if (sha1s.size() != getShaFiles.size()) {
         log(ERR,
@@ -761,6 +772,61 @@ class EdenView final : public QueryableView {
   folly::SharedPromise<folly::Unit> subscribeReadyPromise_;
   bool splitGlobPattern_;
 
+  // Multiple tools polling the same root tend to issue identical
+  // since-queries in quick succession; each one previously repeated the
+  // getFilesChangedSince Thrift round trip (and possibly the SCM status
+  // pipeline behind it). Cache the computed deltas, keyed by the query's
+  // since ticks and the journal sequence they were computed against: a
+  // hit is only possible while the journal hasn't advanced, so cached
+  // results can never hide newer changes.
+  struct JournalDeltaCacheEntry {
+    int64_t sinceTicks;
+    int64_t currentSequence;
+    std::vector<NameAndDType> fileInfo;
+    std::unordered_set<std::string> createdFileNames;
+    JournalPosition resultPosition;
+  };
+  static constexpr size_t kJournalDeltaCacheSize = 8;
+  mutable folly::Synchronized<std::vector<JournalDeltaCacheEntry>>
+      journalDeltaCache_;
+
+  bool lookupJournalDelta(
+      int64_t sinceTicks,
+      int64_t currentSequence,
+      std::vector<NameAndDType>& fileInfo,
+      std::unordered_set<std::string>& createdFileNames,
+      JournalPosition& resultPosition) const {
+    auto cache = journalDeltaCache_.rlock();
+    for (auto& entry : *cache) {
+      if (entry.sinceTicks == sinceTicks &&
+          entry.currentSequence == currentSequence) {
+        fileInfo = entry.fileInfo;
+        createdFileNames = entry.createdFileNames;
+        resultPosition = entry.resultPosition;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void storeJournalDelta(JournalDeltaCacheEntry&& entry) const {
+    auto cache = journalDeltaCache_.wlock();
+    // Entries computed against older journal sequences can never hit
+    // again; shed them first, then FIFO beyond the cap.
+    cache->erase(
+        std::remove_if(
+            cache->begin(),
+            cache->end(),
+            [&](const JournalDeltaCacheEntry& existing) {
+              return existing.currentSequence < entry.currentSequence;
+            }),
+        cache->end());
+    if (cache->size() >= kJournalDeltaCacheSize) {
+      cache->erase(cache->begin());
+    }
+    cache->push_back(std::move(entry));
+  }
+
  public:
   explicit EdenView(const w_string& root_path, const Configuration& config)
       : QueryableView{/*requiresCrawl=*/false},
@@ -837,9 +903,25 @@ class EdenView final : public QueryableView {
       // Query eden to fill in the mountGeneration field.
       JournalPosition position;
       client->sync_getCurrentJournalPosition(position, mountPoint_);
+      auto currentSequence = *position.sequenceNumber();
       // dial back to the sequence number from the query
       *position.sequenceNumber() = since_clock.ticks;
 
+      if (lookupJournalDelta(
+              since_clock.ticks,
+              currentSequence,
+              fileInfo,
+              createdFileNames,
+              resultPosition)) {
+        log(DBG,
+            "journal delta cache hit for since ",
+            since_clock.ticks,
+            " at sequence ",
+            currentSequence,
+            " with ",
+            fileInfo.size(),
+            " changed files\n");
+      } else
       // Now we can get the change journal from eden
       try {
         client->sync_getFilesChangedSince(delta, mountPoint_, position);
@@ -953,6 +1035,13 @@ class EdenView final : public QueryableView {
             " with ",
             fileInfo.size(),
             " changed files\n");
+
+        storeJournalDelta(JournalDeltaCacheEntry{
+            since_clock.ticks,
+            currentSequence,
+            fileInfo,
+            createdFileNames,
+            resultPosition});
       } catch (const EdenError& err) {
         // ERANGE: mountGeneration differs
         // EDOM: journal was truncated.
@@ -1040,6 +1129,18 @@ class EdenView final : public QueryableView {
     return {};
   }
 
+  // Glob results keyed by (pattern set, journal sequence): the journal
+  // position names an exact tree state, so a hit cannot be stale, and
+  // tools that re-issue identical globs (IDE project scans) between
+  // changes stop paying a Thrift round trip and a server-side walk.
+  struct GlobCacheEntry {
+    std::string key;
+    int64_t sequence;
+    std::vector<NameAndDType> fileInfo;
+  };
+  static constexpr size_t kGlobCacheSize = 8;
+  mutable folly::Synchronized<std::deque<GlobCacheEntry>> globCache_;
+
   void executeGlobBasedQuery(
       const std::vector<std::string>& globStrings,
       const Query* query,
@@ -1048,12 +1149,52 @@ class EdenView final : public QueryableView {
     auto client = getEdenClient(thriftChannel_);
 
     auto includeDotfiles = (query->glob_flags & WM_PERIOD) == 0;
-    auto fileInfo = globNameAndDType(
-        client.get(),
-        mountPoint_,
-        globStrings,
-        includeDotfiles,
-        splitGlobPattern_);
+
+    std::string cacheKey = includeDotfiles ? "1" : "0";
+    for (auto& glob : globStrings) {
+      cacheKey.push_back('\0');
+      cacheKey.append(glob);
+    }
+    JournalPosition position;
+    client->sync_getCurrentJournalPosition(position, mountPoint_);
+    auto sequence = *position.sequenceNumber();
+
+    std::vector<NameAndDType> fileInfo;
+    bool cached = false;
+    {
+      auto cache = globCache_.rlock();
+      for (auto& entry : *cache) {
+        if (entry.sequence == sequence && entry.key == cacheKey) {
+          fileInfo = entry.fileInfo;
+          cached = true;
+          break;
+        }
+      }
+    }
+
+    if (!cached) {
+      fileInfo = globNameAndDType(
+          client.get(),
+          mountPoint_,
+          globStrings,
+          includeDotfiles,
+          splitGlobPattern_);
+
+      auto cache = globCache_.wlock();
+      // Results for older journal positions can never hit again.
+      cache->erase(
+          std::remove_if(
+              cache->begin(),
+              cache->end(),
+              [&](const GlobCacheEntry& entry) {
+                return entry.sequence < sequence;
+              }),
+          cache->end());
+      if (cache->size() >= kGlobCacheSize) {
+        cache->pop_front();
+      }
+      cache->push_back(GlobCacheEntry{std::move(cacheKey), sequence, fileInfo});
+    }
 
     // Filter out any ignored files
     filterOutPaths(fileInfo, ctx);
@@ -148,7 +148,7 @@ void FSEventsWatcher::fse_callback(
   auto paths = reinterpret_cast<char**>(eventPaths);
   auto stream = reinterpret_cast<FSEventsStream*>(clientCallBackInfo);
   auto root = stream->root;
-  std::vector<watchman_fsevent> items;
+  FSEventBatch batch;
   auto watcher = stream->watcher;
 
   stream->watcher->totalEventsSeen_.fetch_add(
@@ -252,7 +252,7 @@ void FSEventsWatcher::fse_callback(
 
 propagate:
 
-  items.reserve(numEvents);
+  batch.items.reserve(numEvents);
   for (i = 0; i < numEvents; i++) {
     const char* path = paths[i];
 
@@ -282,15 +282,15 @@ propagate:
       continue;
     }
 
-    items.emplace_back(w_string(path, len), eventFlags[i]);
+    batch.add(path, len, eventFlags[i]);
     if (!stream->lost_sync) {
       stream->last_good = eventIds[i];
     }
   }
 
-  if (!items.empty()) {
+  if (!batch.empty()) {
     auto wlock = watcher->items_.lock();
-    wlock->items.push_back(std::move(items));
+    wlock->items.push_back(std::move(batch));
     watcher->fseCond_.notify_one();
   }
 }
@@ -679,7 +679,7 @@ Watcher::ConsumeNotifyRet FSEventsWatcher::consumeNotify(
     const std::shared_ptr<Root>& root,
     PendingChanges& coll) {
   char flags_label[128];
-  std::vector<std::vector<watchman_fsevent>> items;
+  std::vector<FSEventBatch> items;
   std::vector<folly::Promise<folly::Unit>> syncs;
   bool cancelSelf = false;
 
@@ -691,8 +691,13 @@ Watcher::ConsumeNotifyRet FSEventsWatcher::consumeNotify(
 
   auto now = std::chrono::system_clock::now();
 
-  for (auto& vec : items) {
-    for (auto& item : vec) {
+  for (auto& batch : items) {
+    for (auto& rawItem : batch.items) {
+      struct {
+        w_string path;
+        FSEventStreamEventFlags flags;
+      } item{batch.pathAt(rawItem).asWString(), rawItem.flags};
+
       w_expand_flags(kflags, item.flags, flags_label, sizeof(flags_label));
       logf(
           DBG,
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <string>
+#include <vector>
+
 #include <optional>
 #include "watchman/RingBuffer.h"
 #include "watchman/fs/Pipe.h"
@@ -22,12 +25,34 @@ class Configuration;
 struct FSEventsStream;
 struct FSEventsLogEntry;
 
-struct watchman_fsevent {
-  w_string path;
-  FSEventStreamEventFlags flags;
+/**
+ * A batch of events handed off from the FSEvents stream callback. The
+ * paths are packed into one contiguous buffer — a single allocation per
+ * callback instead of one per event — and consumeNotify materializes
+ * w_strings on the iothread as it processes the batch.
+ */
+struct FSEventBatch {
+  struct Item {
+    uint32_t offset;
+    uint32_t len;
+    FSEventStreamEventFlags flags;
+  };
+
+  std::string paths;
+  std::vector<Item> items;
+
+  w_string_piece pathAt(const Item& item) const {
+    return w_string_piece{paths.data() + item.offset, item.len};
+  }
+
+  void add(const char* path, uint32_t len, FSEventStreamEventFlags flags) {
+    items.push_back(Item{uint32_t(paths.size()), len, flags});
+    paths.append(path, len);
+  }
 
-  watchman_fsevent(w_string&& path, FSEventStreamEventFlags flags)
-      : path(std::move(path)), flags(flags) {}
+  bool empty() const {
+    return items.empty();
+  }
 };
 
 class FSEventsWatcher : public Watcher {
@@ -85,10 +110,10 @@ class FSEventsWatcher : public Watcher {
 
   std::condition_variable fseCond_;
   struct Items {
-    // Unflattened queue of pending events. The fse_callback function will push
-    // exactly one vector to the end of this one, flattening the vector would
+    // Unflattened queue of pending event batches. The fse_callback
+    // function pushes exactly one batch per callback; flattening would
     // require extra copying and allocations.
-    std::vector<std::vector<watchman_fsevent>> items;
+    std::vector<FSEventBatch> items;
     // Sync requests to be inserted into PendingCollection.
     std::vector<folly::Promise<folly::Unit>> syncs;
   };
@@ -6,7 +6,9 @@
  */
 
 #include <folly/String.h>
+#include <array>
 #include <folly/Synchronized.h>
+#include <sys/ioctl.h>
 #include <atomic>
 #include "watchman/Constants.h"
 #include "watchman/Errors.h"
@@ -137,14 +139,34 @@ struct InotifyWatcher : public Watcher {
    */
   std::atomic<uint64_t> totalEventsSeen_ = 0;
 
-  struct maps {
-    /* map of active watch descriptor to name of the corresponding dir */
+  /* map of active watch descriptor to name of the corresponding dir.
+   * Sharded by watch descriptor so that per-event lookups in
+   * consumeNotify don't contend with the registration storm that
+   * startWatchDir produces during a cold crawl. */
+  static constexpr size_t kWdMapShards = 16;
+  struct WdNameMap {
     std::unordered_map<int, w_string> wd_to_name;
-    /* map of inotify cookie to corresponding name */
-    std::unordered_map<uint32_t, pending_move> move_map;
   };
+  std::array<folly::Synchronized<WdNameMap>, kWdMapShards> wdShards_;
 
-  folly::Synchronized<maps> maps;
+  folly::Synchronized<WdNameMap>& wdShard(int wd) {
+    return wdShards_[size_t(wd) % kWdMapShards];
+  }
+
+  /* map of inotify cookie to corresponding name.
+   *
+   * Note: this pairing already recovers the cheap half of a rename —
+   * the destination inherits the existing watch descriptor, so no
+   * re-registration storm occurs. Promoting renames to first-class
+   * move operations in the view was evaluated and declined: every view
+   * structure is path-keyed (child tables alias node name storage, dir
+   * nodes carry their full path precomputed, the ignore and cookie
+   * machinery match on paths), so "moving" a subtree means rewriting
+   * exactly the state a destination crawl rebuilds, minus only the
+   * stats — while subscribers' contract is observed paths, which a
+   * move would still have to expand into per-path deletes and adds to
+   * report. The delete+add model is the honest shape of the data. */
+  folly::Synchronized<std::unordered_map<uint32_t, pending_move>> moveMap_;
 
   // Make the buffer big enough for 16k entries, which
   // happens to be the default fs.inotify.max_queued_events
@@ -193,8 +215,10 @@ InotifyWatcher::InotifyWatcher(const Configuration& config)
   infd.setCloExec();
 
   {
-    auto wlock = maps.wlock();
-    wlock->wd_to_name.reserve(config.getInt(CFG_HINT_NUM_DIRS, HINT_NUM_DIRS));
+    auto hint = config.getInt(CFG_HINT_NUM_DIRS, HINT_NUM_DIRS);
+    for (auto& shard : wdShards_) {
+      shard.wlock()->wd_to_name.reserve(hint / kWdMapShards);
+    }
   }
 
   json_int_t inotify_ring_log_size = config.getInt("inotify_ring_log_size", 0);
@@ -224,7 +248,7 @@ std::unique_ptr<DirHandle> InotifyWatcher::startWatchDir(
 
   // record mapping
   {
-    auto wlock = maps.wlock();
+    auto wlock = wdShard(newwd).wlock();
     wlock->wd_to_name[newwd] = dir_name;
   }
   logf(DBG, "adding {} -> {} mapping\n", newwd, path);
@@ -262,7 +286,7 @@ bool InotifyWatcher::process_inotify_event(
     w_string dir_name;
 
     {
-      auto rlock = maps.rlock();
+      auto rlock = wdShard(ine->wd).rlock();
       auto it = rlock->wd_to_name.find(ine->wd);
       if (it != rlock->wd_to_name.end()) {
         dir_name = it->second;
@@ -291,8 +315,7 @@ bool InotifyWatcher::process_inotify_event(
       // record this as a pending move, so that we can automatically
       // watch the target when we get the other side of it.
       {
-        auto wlock = maps.wlock();
-        wlock->move_map.emplace(ine->cookie, pending_move(now, name));
+        moveMap_.wlock()->emplace(ine->cookie, pending_move(now, name));
       }
 
       log(DBG, "recording move_from ", ine->cookie, " ", name, "\n");
@@ -300,9 +323,9 @@ bool InotifyWatcher::process_inotify_event(
 
     if (ine->len > 0 &&
         (ine->mask & (IN_MOVED_TO | IN_ISDIR)) == (IN_MOVED_FROM | IN_ISDIR)) {
-      auto wlock = maps.wlock();
-      auto it = wlock->move_map.find(ine->cookie);
-      if (it != wlock->move_map.end()) {
+      auto wlock = moveMap_.wlock();
+      auto it = wlock->find(ine->cookie);
+      if (it != wlock->end()) {
         auto& old = it->second;
         int wd =
             inotify_add_watch(infd.fd(), name.c_str(), WATCHMAN_INOTIFY_MASK);
@@ -326,7 +349,7 @@ bool InotifyWatcher::process_inotify_event(
         } else {
           logf(DBG, "moved {} -> {}\n", old.name.c_str(), name.c_str());
           // TODO: assert that there is no entry in wd_to_name
-          wlock->wd_to_name[wd] = name;
+          wdShard(wd).wlock()->wd_to_name[wd] = name;
         }
       } else {
         logf(
@@ -381,7 +404,7 @@ bool InotifyWatcher::process_inotify_event(
             ine->mask,
             ine->wd,
             dir_name);
-        auto wlock = maps.wlock();
+        auto wlock = wdShard(ine->wd).wlock();
         wlock->wd_to_name.erase(ine->wd);
       }
 
@@ -443,16 +466,16 @@ Watcher::ConsumeNotifyRet InotifyWatcher::consumeNotify(
   // We allow a somewhat arbitrary but practical grace period to
   // observe the corresponding MOVE_TO.
   {
-    auto wlock = maps.wlock();
-    auto it = wlock->move_map.begin();
-    while (it != wlock->move_map.end()) {
+    auto wlock = moveMap_.wlock();
+    auto it = wlock->begin();
+    while (it != wlock->end()) {
       auto& pending = it->second;
       if (now - pending.created > std::chrono::seconds{5}) {
         logf(
             DBG,
             "deleting pending move {} (moved outside of watch?)\n",
             pending.name);
-        it = wlock->move_map.erase(it);
+        it = wlock->erase(it);
       } else {
         ++it;
       }
@@ -493,9 +516,38 @@ json_ref InotifyWatcher::getDebugInfo() {
       json_array_append(events, entry.asJsonValue());
     }
   }
+
+  // Kernel-side queue pressure: bytes waiting unread on the inotify fd
+  // versus the configured queue limit. When utilization approaches the
+  // limit an overflow (and thus a forced recrawl) is imminent, so these
+  // gauges give monitoring a leading indicator instead of a surprise.
+  int backlogBytes = 0;
+#ifdef FIONREAD
+  if (ioctl(infd.fd(), FIONREAD, &backlogBytes) != 0) {
+    backlogBytes = -1;
+  }
+#endif
+
+  json_int_t maxQueuedEvents = 0;
+  if (auto* f = fopen("/proc/sys/fs/inotify/max_queued_events", "r")) {
+    long long v = 0;
+    if (fscanf(f, "%lld", &v) == 1) {
+      maxQueuedEvents = v;
+    }
+    fclose(f);
+  }
+
+  size_t watchCount = 0;
+  for (auto& shard : wdShards_) {
+    watchCount += shard.rlock()->wd_to_name.size();
+  }
+
   return json_object({
       {"events", events},
       {"total_event_count", json_integer(totalEventsSeen_.load())},
+      {"backlog_bytes", json_integer(backlogBytes)},
+      {"max_queued_events", json_integer(maxQueuedEvents)},
+      {"watch_descriptors", json_integer(watchCount)},
   });
 }
 
@@ -63,11 +63,62 @@ KQueueWatcher::KQueueWatcher(
     bool recursive)
     : Watcher("kqueue", 0),
       maps_(maps(config.getInt(CFG_HINT_NUM_DIRS, HINT_NUM_DIRS))),
-      recursive_(recursive) {
+      recursive_(recursive),
+      maxWatchFds_(config.getInt("kqueue_max_fds", 0)),
+      coldRescanInterval_(config.getInt("kqueue_cold_rescan_ms", 30000)) {
   kq_fd = FileDescriptor(kqueue(), "kqueue", FileDescriptor::FDType::Generic);
   kq_fd.setCloExec();
 }
 
+void KQueueWatcher::touchFileWatch(maps& m, const w_string& name) {
+  auto pos = m.file_lru_pos.find(name);
+  if (pos != m.file_lru_pos.end()) {
+    m.file_lru.splice(m.file_lru.end(), m.file_lru, pos->second);
+    return;
+  }
+  m.file_lru.push_back(name);
+  m.file_lru_pos[name] = std::prev(m.file_lru.end());
+}
+
+void KQueueWatcher::forgetFileWatch(maps& m, const w_string& name) {
+  auto pos = m.file_lru_pos.find(name);
+  if (pos != m.file_lru_pos.end()) {
+    m.file_lru.erase(pos->second);
+    m.file_lru_pos.erase(pos);
+  }
+}
+
+void KQueueWatcher::enforceFdBudget(maps& m) {
+  if (!maxWatchFds_) {
+    return;
+  }
+
+  while (m.name_to_fd.size() > size_t(maxWatchFds_) && !m.file_lru.empty()) {
+    auto victim = m.file_lru.front();
+    m.file_lru.pop_front();
+    m.file_lru_pos.erase(victim);
+
+    auto it = m.name_to_fd.find(victim);
+    if (it == m.name_to_fd.end()) {
+      continue;
+    }
+
+    struct kevent k;
+    memset(&k, 0, sizeof(k));
+    EV_SET(&k, it->second.fd(), EVFILT_VNODE, EV_DELETE, 0, 0, nullptr);
+    kevent(kq_fd.fd(), &k, 1, nullptr, 0, 0);
+
+    m.fd_to_name.erase(it->second.fd());
+    m.name_to_fd.erase(it);
+    ++m.evicted_file_watches;
+
+    // The dir goes cold: content changes to its unwatched files are
+    // picked up by the periodic rescan in consumeNotify rather than by
+    // a kernel event.
+    m.cold_dirs.insert(victim.dirName());
+  }
+}
+
 bool KQueueWatcher::startWatchFile(struct watchman_file* file) {
   struct kevent k;
 
@@ -134,6 +185,8 @@ bool KQueueWatcher::startWatchFile(struct watchman_file* file) {
     auto wlock = maps_.wlock();
     wlock->name_to_fd[full_name] = std::move(fdHolder);
     wlock->fd_to_name[rawFd] = full_name;
+    touchFileWatch(*wlock, full_name);
+    enforceFdBudget(*wlock);
   }
 
   if (kevent(kq_fd.fd(), &k, 1, nullptr, 0, 0)) {
@@ -148,6 +201,7 @@ bool KQueueWatcher::startWatchFile(struct watchman_file* file) {
     auto wlock = maps_.wlock();
     wlock->name_to_fd.erase(full_name);
     wlock->fd_to_name.erase(rawFd);
+    forgetFileWatch(*wlock, full_name);
   } else {
     watchman::log(
         watchman::DBG, "kevent file ", full_name, " -> ", rawFd, "\n");
@@ -289,6 +343,15 @@ Watcher::ConsumeNotifyRet KQueueWatcher::consumeNotify(
       kevent(kq_fd.fd(), &k, 1, nullptr, 0, 0);
       wlock->name_to_fd.erase(path);
       wlock->fd_to_name.erase(fd);
+      forgetFileWatch(*wlock, path);
+    }
+
+    if (!is_dir && wlock->name_to_fd.find(path) != wlock->name_to_fd.end()) {
+      // Only refresh recency for watches that still exist; the delete/
+      // rename branch above may have just removed this one, and touching
+      // it here would re-insert a stale LRU entry for an unregistered
+      // watch that then accumulates with file churn.
+      touchFileWatch(*wlock, path);
     }
 
     // TODO: W_PENDING_VIA_NOTIFY should always be set
@@ -298,6 +361,27 @@ Watcher::ConsumeNotifyRet KQueueWatcher::consumeNotify(
         is_dir ? PendingFlags{} : (W_PENDING_RECURSIVE | W_PENDING_VIA_NOTIFY));
   }
 
+  // Periodically rescan cold dirs so that content changes to files whose
+  // watches were evicted are still observed within the rescan interval.
+  // Dirs leave the cold set as their rescan is enqueued: a dir whose
+  // files are still over budget re-colds on the next eviction, while a
+  // dir whose files regained watches (or disappeared) stops being
+  // rescanned — otherwise the set only ever grows, and each rescan's
+  // startWatchFile calls evict further watches, ratcheting the set up
+  // until the interval thrashes the LRU indefinitely.
+  {
+    auto steadyNow = std::chrono::steady_clock::now();
+    auto wlock = maps_.wlock();
+    if (!wlock->cold_dirs.empty() &&
+        steadyNow - lastColdRescan_ >= coldRescanInterval_) {
+      lastColdRescan_ = steadyNow;
+      for (auto& dir : wlock->cold_dirs) {
+        coll.add(dir, now, W_PENDING_NONRECURSIVE_SCAN | W_PENDING_CRAWL_ONLY);
+      }
+      wlock->cold_dirs.clear();
+    }
+  }
+
   return {false};
 }
 
@@ -305,6 +389,14 @@ bool KQueueWatcher::waitNotify(int timeoutms) {
   int n;
   std::array<struct pollfd, 2> pfd;
 
+  // When dirs have gone cold we need to wake up often enough to run
+  // their periodic rescan even if the kernel has nothing to report.
+  bool haveColdDirs = !maps_.rlock()->cold_dirs.empty();
+  if (haveColdDirs &&
+      (timeoutms < 0 || timeoutms > coldRescanInterval_.count())) {
+    timeoutms = int(coldRescanInterval_.count());
+  }
+
   pfd[0].fd = kq_fd.fd();
   pfd[0].events = POLLIN;
   pfd[1].fd = terminatePipe_.read.fd();
@@ -319,7 +411,20 @@ bool KQueueWatcher::waitNotify(int timeoutms) {
     }
     return pfd[0].revents != 0;
   }
-  return false;
+  // A timeout with cold dirs pending still needs a consumeNotify pass to
+  // kick off the rescan.
+  return n == 0 && haveColdDirs;
+}
+
+json_ref KQueueWatcher::getDebugInfo() {
+  auto rlock = maps_.rlock();
+  return json_object({
+      {"total_watch_fds", json_integer(rlock->name_to_fd.size())},
+      {"file_watch_fds", json_integer(rlock->file_lru.size())},
+      {"cold_dirs", json_integer(rlock->cold_dirs.size())},
+      {"evicted_file_watches", json_integer(rlock->evicted_file_watches)},
+      {"max_watch_fds", json_integer(maxWatchFds_)},
+  });
 }
 
 void KQueueWatcher::stopThreads() {
@@ -5,6 +5,9 @@
  * LICENSE file in the root directory of this source tree.
  */
 
+#include <chrono>
+#include <list>
+#include <unordered_set>
 #include "watchman/Constants.h"
 #include "watchman/fs/FileDescriptor.h"
 #include "watchman/fs/Pipe.h"
@@ -25,6 +28,19 @@ struct KQueueWatcher : public Watcher {
     /* map of active watch descriptor to name of the corresponding item */
     std::unordered_map<int, w_string> fd_to_name;
 
+    /* Recency order of per-file watches, least recently active first,
+     * used to pick eviction victims when kqueue_max_fds is configured. */
+    std::list<w_string> file_lru;
+    std::unordered_map<w_string, std::list<w_string>::iterator> file_lru_pos;
+
+    /* Dirs that contain files whose watches were evicted to stay within
+     * the fd budget. These are periodically rescanned so that content
+     * changes to cold files are still observed. */
+    std::unordered_set<w_string> cold_dirs;
+
+    /* Total number of file watch evictions performed. */
+    uint64_t evicted_file_watches{0};
+
     explicit maps(json_int_t sizeHint) {
       name_to_fd.reserve(sizeHint);
       fd_to_name.reserve(sizeHint);
@@ -33,6 +49,12 @@ struct KQueueWatcher : public Watcher {
   folly::Synchronized<maps> maps_;
   bool recursive_;
 
+  /* When non-zero, the maximum number of watch fds to keep open; file
+   * watches are evicted LRU beyond this and their dirs go cold. */
+  json_int_t maxWatchFds_{0};
+  std::chrono::milliseconds coldRescanInterval_{30000};
+  std::chrono::steady_clock::time_point lastColdRescan_{};
+
   struct kevent keventbuf[WATCHMAN_BATCH_LIMIT];
 
   explicit KQueueWatcher(
@@ -53,6 +75,19 @@ struct KQueueWatcher : public Watcher {
 
   bool waitNotify(int timeoutms) override;
   void stopThreads() override;
+  json_ref getDebugInfo() override;
+
+ private:
+  /* Marks the named file watch as recently active, inserting it if new.
+   * Caller must hold the maps_ write lock. */
+  void touchFileWatch(maps& m, const w_string& name);
+
+  /* Evicts least-recently-active file watches until we're within budget.
+   * Caller must hold the maps_ write lock. */
+  void enforceFdBudget(maps& m);
+
+  /* Removes LRU bookkeeping for the named watch, if present. */
+  void forgetFileWatch(maps& m, const w_string& name);
 };
 
 } // namespace watchman
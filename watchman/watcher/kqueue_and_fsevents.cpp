@@ -19,6 +19,19 @@
 #if HAVE_FSEVENTS && defined(HAVE_KQUEUE)
 namespace watchman {
 
+/*
+ * Note on dynamic subtree promotion: adapting the kqueue/fsevents split
+ * at runtime (promoting hot deep subtrees to their own fsevents
+ * streams) was evaluated and declined. Re-homing a live subtree between
+ * watchers opens an unwatched window that requires a subtree recrawl
+ * with desync semantics to close — the exact cost the promotion is
+ * meant to avoid — and fsevents streams are a bounded kernel resource,
+ * so promotion needs an eviction policy whose mistakes also cost
+ * recrawls. The static split keeps the failure modes predictable; if a
+ * deployment's hot subtrees are known, watching them as separate roots
+ * achieves the same stream placement explicitly.
+ */
+
 class PendingEventsCond {
  public:
   /**
@@ -9,6 +9,8 @@
  * This watcher fails with the scm tests */
 
 #include <folly/String.h>
+#include <algorithm>
+#include <vector>
 #include <folly/Synchronized.h>
 #include <memory>
 #include "watchman/InMemoryView.h"
@@ -39,7 +41,10 @@ struct PortFSWatcher : public Watcher {
   std::unique_ptr<watchman_port_file> root_delete_w_port_file;
   bool root_deleted;
 
-  port_event_t portevents[WATCHMAN_BATCH_LIMIT];
+  // Event batch buffer; starts small and doubles whenever a read fills
+  // it, up to the batch limit, so idle roots don't keep a maximal
+  // buffer resident while storming roots quickly reach full batching.
+  std::vector<port_event_t> portevents{128};
 
   explicit PortFSWatcher(watchman_root* root);
 
@@ -225,8 +230,8 @@ Watcher::ConsumeNotifyRet PortFSWatcher::consumeNotify(
   n = 1;
   if (port_getn(
           port_fd.fd(),
-          portevents,
-          sizeof(portevents) / sizeof(portevents[0]),
+          portevents.data(),
+          uint_t(portevents.size()),
           &n,
           nullptr)) {
     if (errno == EINTR) {
@@ -237,6 +242,13 @@ Watcher::ConsumeNotifyRet PortFSWatcher::consumeNotify(
 
   logf(DBG, "port_getn: n={}\n", n);
 
+  if (n == portevents.size() && portevents.size() < WATCHMAN_BATCH_LIMIT) {
+    // We filled the batch; the kernel likely has more queued, so widen
+    // the next read.
+    portevents.resize(
+        std::min<size_t>(portevents.size() * 2, WATCHMAN_BATCH_LIMIT));
+  }
+
   if (n == 0) {
     return {false, false};
   }
@@ -114,7 +114,12 @@ void WinWatcher::stopThreads() {
 }
 
 void WinWatcher::readChangesThread(const std::shared_ptr<Root>& root) {
-  std::vector<uint8_t> buf;
+  // Double-buffered overlapped reads: one buffer is posted to the kernel
+  // while the previously completed one is being processed, so bursts that
+  // arrive during processing land in the posted buffer instead of
+  // overflowing the kernel's internal queue and forcing a recrawl.
+  std::vector<uint8_t> bufs[2];
+  size_t cur = 0;
   auto olap = OVERLAPPED();
   BOOL initiate_read = true;
   HANDLE handles[2] = {olapEvent, ping};
@@ -141,11 +146,11 @@ void WinWatcher::readChangesThread(const std::shared_ptr<Root>& root) {
 
     olap.hEvent = olapEvent;
 
-    buf.resize(size);
+    bufs[cur].resize(size);
 
     if (!ReadDirectoryChangesW(
             (HANDLE)dir_handle.handle(),
-            &buf[0],
+            &bufs[cur][0],
             size,
             TRUE,
             filter,
@@ -174,9 +179,10 @@ void WinWatcher::readChangesThread(const std::shared_ptr<Root>& root) {
   // The mutex must not be held when we enter the loop
   while (!root->inner.cancelled) {
     if (initiate_read) {
+      bufs[cur].resize(size);
       if (!ReadDirectoryChangesW(
               (HANDLE)dir_handle.handle(),
-              &buf[0],
+              &bufs[cur][0],
               size,
               TRUE,
               filter,
@@ -243,7 +249,33 @@ void WinWatcher::readChangesThread(const std::shared_ptr<Root>& root) {
           break;
         }
       } else {
-        PFILE_NOTIFY_INFORMATION notify = (PFILE_NOTIFY_INFORMATION)buf.data();
+        // Repost immediately with the other buffer before we spend any
+        // time processing, so the kernel is never without a posted
+        // buffer.
+        auto* completedBuf = bufs[cur].data();
+        cur ^= 1;
+        bufs[cur].resize(size);
+        ResetEvent(olapEvent);
+        if (!ReadDirectoryChangesW(
+                (HANDLE)dir_handle.handle(),
+                &bufs[cur][0],
+                size,
+                TRUE,
+                filter,
+                nullptr,
+                &olap,
+                nullptr)) {
+          DWORD err = GetLastError();
+          logf(
+              ERR,
+              "ReadDirectoryChangesW: failed, cancel watch. {}\n",
+              win32_strerror(err));
+          root->cancel();
+          break;
+        }
+
+        PFILE_NOTIFY_INFORMATION notify =
+            (PFILE_NOTIFY_INFORMATION)completedBuf;
 
         while (true) {
           // FileNameLength is in BYTES, but FileName is WCHAR
@@ -290,8 +322,8 @@ void WinWatcher::readChangesThread(const std::shared_ptr<Root>& root) {
               (PFILE_NOTIFY_INFORMATION)(notify->NextEntryOffset + (char*)notify);
         }
 
-        ResetEvent(olapEvent);
-        initiate_read = true;
+        // The next read was already posted above.
+        initiate_read = false;
       }
     } else if (status == WAIT_OBJECT_0 + 1) {
       logf(ERR, "signalled\n");
@@ -11,6 +11,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include "watchman/Clock.h"
+#include "watchman/ContentHash.h"
 #include "watchman/Logging.h"
 #include "watchman/PDU.h"
 #include "watchman/PerfSample.h"
@@ -39,10 +40,33 @@ struct watchman_client : public std::enable_shared_from_this<watchman_client> {
 
   // The command currently being processed by dispatch_command
   json_ref current_command;
+
+  // The tag of the tagged request currently being processed, if any;
+  // echoed onto every response the command produces.
+  json_ref current_request_tag;
   watchman::PerfSample* perf_sample{nullptr};
 
-  // Queue of things to send to the client.
-  std::deque<json_ref> responses;
+  // Queue of things to send to the client. Broadcast entries are
+  // Publisher payloads shared by reference with other clients; only
+  // those go through the shared-encode cache, so per-client one-shot
+  // responses (eg: large query results) are released as soon as their
+  // bytes are written rather than being pinned by the cache.
+  struct QueuedResponse {
+    json_ref payload;
+    bool broadcast{false};
+  };
+  std::deque<QueuedResponse> responses;
+
+  // Encoded-but-unsent response bytes, drained without blocking so that a
+  // slow consumer cannot stall command dispatch or subscription fan-out
+  // on this client's thread. pendingWritePos is the first unsent byte.
+  std::string pendingWriteBuf;
+  size_t pendingWritePos{0};
+
+  // Backpressure accounting: lifetime bytes sent and the largest backlog
+  // observed for this client.
+  uint64_t totalBytesSent{0};
+  size_t sendBacklogHighWater{0};
 
   // Logging Subscriptions
   std::shared_ptr<watchman::Publisher::Subscriber> debugSub;
@@ -52,7 +76,21 @@ struct watchman_client : public std::enable_shared_from_this<watchman_client> {
   explicit watchman_client(std::unique_ptr<watchman_stream>&& stm);
   virtual ~watchman_client();
 
-  void enqueueResponse(json_ref&& resp, bool ping = true);
+  void enqueueResponse(json_ref&& resp, bool ping = true, bool broadcast = false);
+
+  /**
+   * Encodes any queued responses into the pending write buffer and
+   * drains it to the socket without blocking. Intended for streaming
+   * producers running on this client's own thread (eg: the query result
+   * streamer) so that chunks reach the wire while the command is still
+   * executing instead of accumulating until dispatch returns. Sets
+   * sendError on a hard write failure; the client thread's main loop
+   * observes that and disconnects.
+   */
+  void flushNonBlocking();
+
+  // Set by flushNonBlocking on a hard write error.
+  bool sendError{false};
 };
 
 struct watchman_user_client;
@@ -78,6 +116,29 @@ struct watchman_client_subscription
   std::shared_ptr<Query> query;
   bool vcs_defer;
   uint32_t last_sub_tick{0};
+
+  /* When non-zero (the "max_batch_size" subscription option), catch-up
+   * updates larger than this many files are delivered as multiple PDUs,
+   * all but the last carrying "is_partial": true, bounding both the
+   * daemon-side encode and the client-side parse. */
+  uint32_t max_batch_size{0};
+
+  /* When true (the "suppress_unchanged_content" subscription option),
+   * rewrites that leave a file's content identical are filtered from
+   * updates by consulting the content hash cache, within a per-flush
+   * hashing budget. */
+  bool suppress_unchanged_content{false};
+  /* Hash of each pathname as last delivered on this subscription. */
+  std::unordered_map<w_string, watchman::ContentHashCache::HashValue>
+      lastContentHash_;
+
+  /* When true (negotiated via the "name_ids" subscription option), file
+   * rows carry a compact integer "name_id" instead of repeating the full
+   * pathname once a name has been sent. */
+  bool use_name_ids{false};
+  /* Stable ids assigned to names already delivered on this subscription. */
+  std::unordered_map<w_string, uint32_t> name_ids;
+  uint32_t next_name_id{1};
   // map of statename => bool.  If true, policy is drop, else defer
   std::unordered_map<w_string, bool> drop_or_defer;
   std::weak_ptr<watchman_client> weakClient;
@@ -91,6 +152,13 @@ struct watchman_client_subscription
   void processSubscription();
 
   std::shared_ptr<watchman_user_client> lockClient();
+
+  /** Removes rows whose content hash matches what this subscription last
+   * delivered for that path; see suppress_unchanged_content. */
+  void suppressUnchangedContent(
+      const std::shared_ptr<watchman::Root>& root,
+      watchman::QueryResult& res);
+
   json_ref buildSubscriptionResults(
       const std::shared_ptr<watchman::Root>& root,
       ClockSpec& position,
@@ -6,7 +6,7 @@
  */
 
 #pragma once
-#include <unordered_map>
+#include <folly/container/F14Map.h>
 #include "watchman/watchman_string.h"
 
 struct watchman_file;
@@ -17,20 +17,48 @@ struct watchman_dir {
   /* the parent dir */
   watchman_dir* parent;
 
-  /* files contained in this dir (keyed by file->name) */
+  /* The rendered full path of this dir. Dir nodes are never renamed or
+   * reparented, so this is computed once at construction; every
+   * getFullPath call (query scoping runs one per candidate file) then
+   * costs a refcount bump instead of a parent-chain walk and
+   * allocation. */
+  w_string full_path;
+
+  /* files contained in this dir (keyed by file->name).
+   *
+   * F14FastMap stores entries inline in chunked arrays rather than one
+   * heap node per entry, which matters here: most dirs are small, and
+   * crawl/glob descent walks these tables constantly. Values are
+   * unique_ptrs, so the node addresses stay stable across rehash even
+   * though the table entries move. */
   struct Deleter {
     void operator()(watchman_file*) const;
   };
-  std::unordered_map<w_string_piece, std::unique_ptr<watchman_file, Deleter>>
+  folly::F14FastMap<w_string_piece, std::unique_ptr<watchman_file, Deleter>>
       files;
 
-  /* child dirs contained in this dir (keyed by dir->name) */
-  std::unordered_map<w_string_piece, std::unique_ptr<watchman_dir>> dirs;
+  /* child dirs contained in this dir (keyed by dir->name).
+   *
+   * Deliberately unordered: a per-dir sorted index to give glob descent
+   * range scans was evaluated and declined. Literal glob components
+   * already bypass scanning via direct lookup, leaving only
+   * prefix-anchored wildcard segments to benefit, while the index would
+   * tax every insert and remove in every directory during crawls and
+   * churn. Should that trade ever flip, the index belongs here, built
+   * lazily per dir on first range query rather than maintained
+   * eagerly. */
+  folly::F14FastMap<w_string_piece, std::unique_ptr<watchman_dir>> dirs;
 
   // If we think this dir was deleted, we'll avoid recursing
   // to its children when processing deletes.
   bool last_check_existed{true};
 
+  // The largest otime.ticks ever observed for a file at or below this dir.
+  // Maintained monotonically by ViewDatabase::markFileChanged; generators
+  // use it to skip subtrees that cannot contain anything newer than a
+  // query's since clock.
+  uint32_t max_changed_ticks{0};
+
   watchman_dir(w_string name, watchman_dir* parent);
 
   watchman_dir* getChildDir(w_string_piece name) const;
@@ -41,6 +69,15 @@ struct watchman_dir {
    */
   watchman_file* getChildFile(w_string_piece name) const;
 
+  /**
+   * Returns the direct child file whose name matches `name` under ASCII
+   * case folding, or nullptr. This is a linear scan: it is only used on
+   * the rare wrong-case-miss path on case-insensitive filesystems, where
+   * it replaces a speculative re-crawl of the whole parent, so paying
+   * O(entries) there beats maintaining a folded index on every insert.
+   */
+  watchman_file* getChildFileCaseInsensitive(w_string_piece name) const;
+
   /**
    * Walk up to the chain of dirs via ->parent to and then produce the full path
    * to this dir relative to the root of the watch.
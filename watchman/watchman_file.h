@@ -11,10 +11,15 @@
 #include "watchman/fs/FileInformation.h"
 #include "watchman/watchman_dir.h"
 
-struct watchman_file {
-  /* the parent dir */
-  watchman_dir* parent;
+namespace watchman {
+class FileNodeArena;
+}
 
+/* Field order matters here: the recency-index walks in the query
+ * generators touch next, otime, exists and parent on every node, so those
+ * are grouped at the front of the struct to keep the walk within the
+ * leading cache line. The colder fields follow. */
+struct watchman_file {
   /* linkage to files ordered by changed time.
    * prev points to the address of `next` in the
    * previous file node, or the head of the list. */
@@ -22,20 +27,35 @@ struct watchman_file {
 
   /* the time we last observed a change to this file */
   watchman::ClockStamp otime;
-  /* the time we first observed this file OR the time
-   * that this file switched from !exists to exists.
-   * This is thus the "created time" */
-  watchman::ClockStamp ctime;
 
   /* whether we believe that this file still exists */
   bool exists;
   /* whether we think this file might not exist */
   bool maybe_deleted;
 
+  /* the parent dir */
+  watchman_dir* parent;
+
+  /* the time we first observed this file OR the time
+   * that this file switched from !exists to exists.
+   * This is thus the "created time" */
+  watchman::ClockStamp ctime;
+
   /* cache stat results so we can tell if an entry
    * changed */
   watchman::FileInformation stat;
 
+  /* Hint that we're about to walk to the next node in the recency list.
+   * The list chases pointers all over the arena, so an explicit prefetch
+   * hides a good fraction of the cache misses in linear scans. */
+  inline void prefetchNext() const {
+#if defined(__GNUC__) || defined(__clang__)
+    if (next) {
+      __builtin_prefetch(next);
+    }
+#endif
+  }
+
   inline w_string_piece getName() const {
     uint32_t len;
     memcpy(&len, this + 1, 4);
@@ -49,9 +69,15 @@ struct watchman_file {
   watchman_file& operator=(const watchman_file&) = delete;
   ~watchman_file();
 
+  /**
+   * When arena is provided, the node's storage is carved out of it and
+   * returned to it on free; the arena must outlive the node. Otherwise the
+   * node is allocated from the general purpose heap.
+   */
   static std::unique_ptr<watchman_file, watchman_dir::Deleter> make(
       const w_string& name,
-      watchman_dir* parent);
+      watchman_dir* parent,
+      watchman::FileNodeArena* arena = nullptr);
 };
 
 void free_file_node(struct watchman_file* file);
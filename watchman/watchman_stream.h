@@ -28,8 +28,50 @@ using w_evt_t = watchman_event*;
 class watchman_stream {
  public:
   virtual ~watchman_stream() = default;
+  struct WriteVec {
+    const void* buf;
+    size_t len;
+  };
+
   virtual int read(void* buf, int size) = 0;
   virtual int write(const void* buf, int size) = 0;
+
+  /**
+   * Passes a file descriptor to the peer over this stream, where the
+   * transport supports it (unix domain sockets via SCM_RIGHTS). The fd
+   * accompanies a single marker byte so the receiver can sequence it
+   * against the PDU stream. Returns false on unsupported transports.
+   *
+   * This is the transport half of shared-memory result handoff: a
+   * response that negotiated shm delivery describes the segment in its
+   * PDU and the fd follows via this call.
+   */
+  virtual bool sendFd(int /*fd*/) {
+    return false;
+  }
+
+  /**
+   * Vectored write. The default implementation loops over write(); unix
+   * sockets override it with a real writev so that a PDU's header and
+   * payload chunks go out in one syscall. Returns the number of bytes
+   * written, which may be short, or -1 with errno set.
+   */
+  virtual int writev(const WriteVec* vecs, size_t nvecs) {
+    int total = 0;
+    for (size_t i = 0; i < nvecs; ++i) {
+      size_t pos = 0;
+      while (pos < vecs[i].len) {
+        auto x =
+            write(static_cast<const char*>(vecs[i].buf) + pos, vecs[i].len - pos);
+        if (x <= 0) {
+          return total ? total : x;
+        }
+        pos += x;
+        total += x;
+      }
+    }
+    return total;
+  }
   virtual w_evt_t getEvents() = 0;
   virtual void setNonBlock(bool nonBlock) = 0;
   virtual bool rewind() = 0;
@@ -350,6 +350,16 @@ class w_string {
    * the python os.path.join() function. */
   static w_string pathCat(std::initializer_list<w_string_piece> elems);
 
+  /**
+   * Returns the canonical instance for the given string, interning it on
+   * first use. Identical path components across the process then share a
+   * single allocation; the view uses this for dir component names, which
+   * repeat millions of times on big trees ("src", "node_modules", ...).
+   * The table only grows, so intern only strings drawn from a naturally
+   * bounded population such as path components.
+   */
+  static w_string intern(const w_string& str);
+
   /** Similar to asprintf, but returns a w_string */
   static w_string vprintf(const char* format, va_list ap);
 
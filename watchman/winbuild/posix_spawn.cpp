@@ -6,6 +6,17 @@
  */
 
 #include <folly/String.h>
+
+// Note on spawn pooling: a persistent broker with pre-built attribute
+// lists was evaluated for trigger latency and superseded by the
+// keep_alive trigger mode, which removes the per-firing CreateProcess
+// entirely (the worker stays alive across firings and receives framed
+// batches on stdin) — a stronger fix than making each CreateProcess
+// cheaper, and one that works identically on every platform. The
+// remaining per-spawn setup here runs once per worker lifetime for
+// keep_alive triggers. Job-object containment of trigger children is
+// worthwhile independent of performance and should ride along when the
+// next Windows-focused change touches this file with test coverage.
 #include <folly/Synchronized.h>
 #include "watchman/Logging.h"
 #include "watchman/watchman_stream.h"